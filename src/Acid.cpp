@@ -15,12 +15,11 @@ Elements pinched from Lindenberg + dBiZ
 
 #include "Oscillator.hpp"
 
+#include "SampleLoader.hpp"
+
 #include <math.h>
-#define DR_WAV_IMPLEMENTATION
-#include "dr_wav.h"
 #include <vector>
 #include "cmath"
-#include <dirent.h>
 #include <algorithm> //----added by Joakim Lindbom
 
 using deesp::DSPBLOscillator;
@@ -60,35 +59,33 @@ struct AcidRoundLargeBlackSnapKnob : AcidRoundLargeBlackKnob
 /*
     Static Functions and Structions
 */
-static float shapeDelta(float delta, float tau, float shape) {
-    float lin = sgn(delta) * 10.0 / tau;
+using simd::float_4;
+
+// Exponential curves and filter coefficients are updated once per this many samples
+// and ramped linearly in between
+static const int ACID_CONTROL_DIVISION = 16;
+
+template <typename T>
+static T shapeDelta(T delta, T tau, float shape) {
+    T lin = simd::sgn(delta) * 10.0f / tau;
     if (shape < 0.0) {
-        float log = sgn(delta) * 40.0 / tau / (fabsf(delta) + 1.0);
-        return crossfade(lin, log, -shape * 0.95);
+        T log = simd::sgn(delta) * 40.0f / tau / (simd::fabs(delta) + 1.0f);
+        return lin + (log - lin) * (-shape * 0.95f);
     }
     else {
-        float exp = M_E * delta / tau;
-        return crossfade(lin, exp, shape * 0.90);
+        T exp = float(M_E) * delta / tau;
+        return lin + (exp - lin) * (shape * 0.90f);
     }
 }
 
+template <typename T>
 struct MultiFilter
 {
-    float q;
-    float freq;
-    float smpRate;
-    float hp = 0.0f,bp = 0.0f,lp = 0.0f,mem1 = 0.0f,mem2 = 0.0f;
-
-    void setParams(float freq, float q, float smpRate) {
-        this->freq = freq;
-        this->q=q;
-        this->smpRate=smpRate;
-    }
+    T hp = 0.0f,bp = 0.0f,lp = 0.0f,mem1 = 0.0f,mem2 = 0.0f;
 
-    void calcOutput(float sample)
+    // g = tan(pi * freq / sampleRate), R = 1 / (2 * q)
+    void calcOutput(T sample, T g, float R)
     {
-        float g = tan(pi*freq/smpRate);
-        float R = 1.0f/(2.0f*q);
         hp = (sample - (2.0f*R + g)*mem1 - mem2)/(1.0f + 2.0f*R*g + g*g);
         bp = g*hp + mem1;
         lp = g*bp +  mem2;
@@ -174,53 +171,56 @@ struct Acid : Module {
         NUM_LIGHTS
     };
 
-    // Wave
-    DSPBLOscillator *osc1 = new DSPBLOscillator(APP->engine->getSampleRate());
-    DSPBLOscillator *osc2 = new DSPBLOscillator(APP->engine->getSampleRate());
-
-    // Sample
-    unsigned int channels;
-    unsigned int sampleRate;
-    drwav_uint64 totalSampleCount;
-    vector<vector<float>> playBuffer;
-    bool loading = false;
-    bool play = false;
-    std::string lastPath = "";
-    float samplePos = 0;
-    float startPos = 0;
-    std::string fileDesc;
-    bool fileLoaded = false;
-    vector <std::string> fichier;
-    int sampnumber = 0;
-    int retard = 0;
-    bool reload = false ;
-    bool oscState = false ;
-    vector<double> displayBuff; // unused
+    // Wave, one pair of oscillators per voice
+    DSPBLOscillator *osc1[16];
+    DSPBLOscillator *osc2[16];
 
-    // Env
-    dsp::SchmittTrigger env_trigger;
-    float env_out = 0.0f;
-    float env_gate = 0.0f;
-    float env_in = 0.0f;
+    // Sample, decoded in the background and shared by every Acid
+    std::shared_ptr<SampleSlot> wavetable = std::make_shared<SampleSlot>();
+    float samplePos[16] = {};
+    float sampleStep[16] = {};
 
-    // VCA
-    float vca_out;
-    float vca_last;
+    // Voices are processed four at a time, voice c lives in lane c % 4 of group c / 4
+    dsp::SchmittTrigger trigger[16];
+    float wave_mixed[16] = {};
+    float triggered[16] = {};
+
+    // Env
+    float_4 env_out[4];
+    float_4 env_gate[4];
 
     // Filter
-    MultiFilter filter;
+    MultiFilter<float_4> filter[4];
+    float_4 filter_g[4];
+    float_4 filter_g_step[4];
 
     // Pluck
     float lastCv = 0.f;
-    bool decaying = false;
-    float env = 0.0f;
-    dsp::SchmittTrigger trigger;
+    float_4 env[4];
+    float_4 vca_cv[4];
+    float_4 vca_step[4];
+
+    // Control rate state
+    int control_counter = 0;
+    int wave1 = 0;
+    int wave2 = 0;
+    float mix = 0.f;
+    float shape = 0.f;
+    float fall = 1.f;
+    float env_amt = 1.f;
+    float cut_base = 0.f;
+    float cut_fm = 0.f;
+    float filter_R = 1.f;
+    float a_shapeA = 0.f;
+    float a_shapeB = 1.f;
+    float fold_a = 25.f;
+    float pluck_attack = 0.f;
+    float pluck_release = 0.f;
+    float pluck_release_block = 1.f;
+    float pluck_exp = 0.2f;
 
     Acid() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
-        playBuffer.resize(2);
-        playBuffer[0].resize(0);
-        playBuffer[1].resize(0);
 
         configParam(Acid::FOLD_PARAM, 1.f, 50.f, 25.f, "");
         configParam(Acid::WAVE_1_PARAM, 0.0, 5.0, 0.0, "");
@@ -238,335 +238,282 @@ struct Acid : Module {
         configParam(Acid::PLUCK_EXP_PARAM, 0.0001f, 0.4f, 0.2f, "");
         configParam(Acid::PLUCK_ATTACK_PARAM, 0.f, 1.f, 0.9f, "");
 
-    }
-
-    void step() override {
-
-        /*
-        Load up our 303 samples
-        */
-        if(!fileLoaded){
-            loadSample(asset::plugin(pluginInstance, "samples/303_wavetable_c.wav"));
-            return;
+        for (int c = 0; c < 16; c++) {
+            osc1[c] = new DSPBLOscillator(APP->engine->getSampleRate());
+            osc2[c] = new DSPBLOscillator(APP->engine->getSampleRate());
         }
-
-        /*
-            Inputs
-        */
-        float voct = inputs[VOCT_INPUT].value;
-        float voct2 = inputs[VOCT_INPUT].value;
-        if(inputs[VOCT2_INPUT].active){
-            voct2 = inputs[VOCT2_INPUT].value;
+        for (int g = 0; g < 4; g++) {
+            env_out[g] = 0.f;
+            env_gate[g] = 0.f;
+            filter_g[g] = 0.f;
+            filter_g_step[g] = 0.f;
+            env[g] = 0.f;
+            vca_cv[g] = 0.f;
+            vca_step[g] = 0.f;
         }
 
         /*
-            Wave
+        Load up our 303 samples
         */
+        SampleLoader::instance()->load(asset::plugin(pluginInstance, "samples/303_wavetable_c.wav"), wavetable);
+    }
 
-        // OSC1
-        float wave1 = params[WAVE_1_PARAM].value * clamp(inputs[WAVE_1_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
-        osc1->setInputs(voct, 0.0, 0.0, 0.f, -2.f);
-        osc1->process();
-        float osc1_out;
-        switch(int(wave1)){
-            // Sample
-            case 0:
-                osc1_out = 5 * playBuffer[0][floor(samplePos)];
-                break;
-            // Sin
-            case 1:
-                osc1_out = osc1->getSineWave();
-                break;
-            // Saw
-            case 2:
-                osc1_out = osc1->getSawWave();
-                break;
-            // Pulse
-            case 3:
-                osc1_out = osc1->getPulseWave();
-                break;
-            // Tri
-            case 4:
-                osc1_out = osc1->getTriWave();
-                break;
-            // Noise
-            case 5:
-                osc1_out = osc1->getNoise();
-                break;
-        }
-
-        // Sampler moves regardless
-        samplePos = samplePos + powf(2.0, voct); // 3 octaves higher because i made the sample wrong
-        if (floor(samplePos) >= totalSampleCount){
-            samplePos = 0;
-        }
-
-        // OSC2
-        float wave2 = params[WAVE_2_PARAM].value * clamp(inputs[WAVE_2_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);;
-        osc2->setInputs(voct2, 0.0, 0.0, 0.f, -2.f);
-        osc2->process();
-        float osc2_out;
-        switch(int(wave2)){
-
-            // Sin
-            case 0:
-                osc2_out = osc2->getSineWave();
-                break;
-            // Saw
-            case 1:
-                osc2_out = osc2->getSawWave();
-                break;
-            // Pulse
-            case 2:
-                osc2_out = osc2->getPulseWave();
-                break;
-            // Tri
-            case 3:
-                osc2_out = osc2->getTriWave();
-                break;
-            // Noise
-            case 4:
-                osc2_out = osc2->getNoise();
-                break;
+    ~Acid() {
+        for (int c = 0; c < 16; c++) {
+            delete osc1[c];
+            delete osc2[c];
         }
+    }
 
-        // Mix
-        float wave_mixed = ((1 - params[WAVE_MIX_PARAM].value * clamp(inputs[WAVE_MIX_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f)) * osc1_out) + ((params[WAVE_MIX_PARAM].value * clamp(inputs[WAVE_MIX_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f)) * osc2_out);
-
-        /*
-            Envelope
-        */
-        float shape = params[ENV_SHAPE_PARAM].value * clamp(inputs[ENV_SHAPE_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
-        float minTime = 1e-2;
-        env_in = 0.0f;
-
-        // Trigger
-        if (env_trigger.process(inputs[TRIG_INPUT].value)) {
-            env_gate = true;
-        }
-        if (env_gate) {
-            env_in = 10.0;
-        } else{
-        }
+    /*
+        Everything that needs a pow, exp or tan, evaluated once per ACID_CONTROL_DIVISION samples
+    */
+    void updateControl(int channels, float sampleTime) {
 
-        bool rising = false;
-        bool falling = false;
-        float delta = env_in - env_out;
-        if (delta > 0) {
-            float riseCv = 0.0;
-            float rise = minTime * powf(2.0, riseCv * 10.0);
-            env_out += shapeDelta(delta, rise, shape) / APP->engine->getSampleRate();
-            rising = (env_in - env_out > 1e-3);
-            if (!rising) {
-                env_gate = false;
-            }
-        }
-        else if (delta < 0) {
-            float fallCv = params[ENV_REL_PARAM].value * clamp(inputs[ENV_REL_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f) + 0.0 / 10.0;
-            fallCv = clamp(fallCv, 0.0, 1.0);
-            float fall = minTime * powf(2.0, fallCv * 10.0);
-            env_out += shapeDelta(delta, fall, shape) / APP->engine->getSampleRate();
-            falling = (env_in - env_out < -1e-3);
-        }
-        else {
-            env_gate = false;
-        }
-        if (!rising && !falling) {
-            env_out = env_in;
+        // Wave
+        wave1 = int(params[WAVE_1_PARAM].value * clamp(inputs[WAVE_1_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f));
+        wave2 = int(params[WAVE_2_PARAM].value * clamp(inputs[WAVE_2_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f));
+        mix = params[WAVE_MIX_PARAM].value * clamp(inputs[WAVE_MIX_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
+
+        // Sampler speed, 1V/Oct
+        for (int c = 0; c < channels; c += 4) {
+            float_4 voct = inputs[VOCT_INPUT].getPolyVoltageSimd<float_4>(c);
+            dsp::approxExp2_taylor5(voct).store(&sampleStep[c]);
         }
 
-        /*
-            VCA
-            via https://github.com/VCVRack/AudibleInstruments/blob/dd25b1785c2e67f19824fad97527c97c5d779685/src/Veils.cpp
-        */
-        float vca_out = env_out * params[ENV_AMT_PARAM].value * clamp(inputs[ENV_AMT_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
-        outputs[ENV_OUTPUT].value = vca_out;
-
-        /*
-            Filter
-        */
-
-        // Stage 1
-        //float cutoff = pow(2.0f, rescale(clamp(params[FILTER_CUT_PARAM].value + quadraticBipolar(params[FILTER_FM_2_PARAM].value) * 0.1f * inputs[CUTOFF_INPUT2].value + quadraticBipolar(params[FILTER_FM_PARAM].value) * 0.1f * inputs[CUTOFF_INPUT].value / 5.0f, 0.0f , 1.0f), 0.0f, 1.0f, 4.5f, 13.0f));
-        float cutoff = pow(2.0f, rescale(clamp(params[FILTER_CUT_PARAM].value * clamp(inputs[FILTER_CUT_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f) + rack::dsp::quadraticBipolar(params[FILTER_FM_2_PARAM].value * clamp(inputs[FILTER_FM_2_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f)  ) * 0.1f * vca_out + rack::dsp::quadraticBipolar(params[FILTER_FM_1_PARAM].value * clamp(inputs[FILTER_FM_1_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f) ) * 0.1f * vca_out / 5.0f, 0.0f , 1.0f), 0.0f, 1.0f, 4.5f, 13.0f)) ;
-        //float q = 10.0f * clamp(params[FILTER_Q_PARAM].value + inputs[Q_INPUT].value / 5.0f, 0.1f, 1.0f);
+        // Envelope
+        shape = params[ENV_SHAPE_PARAM].value * clamp(inputs[ENV_SHAPE_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
+        float fallCv = params[ENV_REL_PARAM].value * clamp(inputs[ENV_REL_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
+        fallCv = clamp(fallCv, 0.0, 1.0);
+        const float minTime = 1e-2;
+        fall = minTime * dsp::approxExp2_taylor5(fallCv * 10.0f);
+        env_amt = params[ENV_AMT_PARAM].value * clamp(inputs[ENV_AMT_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
 
-        // I don't love this, but okay..
-        //cutoff = cutoff + (2000 * clamp(inputs[FILTER_CUT_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f));
+        // Filter
+        cut_base = params[FILTER_CUT_PARAM].value * clamp(inputs[FILTER_CUT_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
+        cut_fm = rack::dsp::quadraticBipolar(params[FILTER_FM_2_PARAM].value * clamp(inputs[FILTER_FM_2_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f)) * 0.1f
+            + rack::dsp::quadraticBipolar(params[FILTER_FM_1_PARAM].value * clamp(inputs[FILTER_FM_1_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f)) * 0.1f / 5.0f;
 
         // TODO: Find best values for these
         float q = 40.0f * clamp(params[FILTER_Q_PARAM].value * clamp(inputs[FILTER_Q_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f) / 5.0f, 0.1f, 1.0f);
-        filter.setParams(cutoff, q, APP->engine->getSampleRate());
-        float in = wave_mixed / 5.0f;
+        filter_R = 1.0f / (2.0f * q);
+
+        for (int c = 0; c < channels; c += 4) {
+            int g = c / 4;
+            float_4 vca_out = env_out[g] * env_amt;
+            float_4 cutoff = dsp::approxExp2_taylor5(4.5f + 8.5f * simd::clamp(cut_base + cut_fm * vca_out, 0.0f, 1.0f));
+            float_4 target;
+            for (int i = 0; i < 4; i++) {
+                target[i] = tanf(float(pi) * std::min(cutoff[i] * sampleTime, 0.49f));
+            }
+            filter_g_step[g] = (target - filter_g[g]) / (float) ACID_CONTROL_DIVISION;
+        }
 
-        // Stage 2
-        in = clamp(in, -5.0f, 5.0f) * 0.2f;
+        // Drive
         float a_shape = params[FILTER_DRIVE_PARAM].value * clamp(inputs[FILTER_DRIVE_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
         a_shape = clamp(a_shape, -5.0f, 5.0f) * 0.2f;
         a_shape *= 0.99f;
-        const float a_shapeB = (1.0 - a_shape) / (1.0 + a_shape);
-        const float a_shapeA = (4.0 * a_shape) / ((1.0 - a_shape) * (1.0 + a_shape));
-        float a_outputd = in * (a_shapeA + a_shapeB);
-        a_outputd = a_outputd / ((std::abs(in) * a_shapeA) + a_shapeB);
-        filter.calcOutput(a_outputd);
-        float filter_out = filter.lp * 3.0f;
+        a_shapeB = (1.0 - a_shape) / (1.0 + a_shape);
+        a_shapeA = (4.0 * a_shape) / ((1.0 - a_shape) * (1.0 + a_shape));
+
+        // Fold
+        fold_a = clamp(params[FOLD_PARAM].value + inputs[FOLD_INPUT].value, 1.f, 50.f);
+
+        // Pluck, attack and release are one pole recursions: env += k * (target - env)
+        const float attack = 0.005f;
+        const float base = 20000.0f;
+        const float maxTime = 20.0f;
+        float release = clamp(params[PLUCK_REL_PARAM].value + inputs[PLUCK_REL_INPUT].value / 10.0f, 0.0f, 1.0f);
+        pluck_attack = powf(base, 1 - attack) / maxTime * sampleTime;
+        pluck_release = (release < 1e-4) ? 1.0f : std::min(powf(base, 1 - release) / maxTime * sampleTime, 1.0f);
+        pluck_release_block = powf(1.0f - pluck_release, (float) ACID_CONTROL_DIVISION);
+        pluck_exp = clamp(params[PLUCK_EXP_PARAM].value + inputs[PLUCK_EXP_INPUT].value / 10.0f, 0.0f, 1.0f);
+
+        // Ramp the VCA towards where the released envelope will be at the end of this block
+        for (int c = 0; c < channels; c += 4) {
+            int g = c / 4;
+            float_4 released = env[g] * pluck_release_block;
+            float_4 target = simd::ifelse(released > 0.0f, simd::pow(simd::fmax(released, 1e-30f), pluck_exp), 0.0f);
+            vca_step[g] = (target - vca_cv[g]) / (float) ACID_CONTROL_DIVISION;
+        }
+    }
 
-        /*
-            Fold!
-            from Lindenberg
-        */
-        float x = clamp(filter_out * 0.1f, -1.f, 1.f);
-        float cv = inputs[FOLD_INPUT].value;
-        float a = clamp(params[FOLD_PARAM].value + cv, 1.f, 50.f);
-        // do the acid!
-        float fold_out = x * (fabs(x) + a) / (x * x + (a - 1) * fabs(x) + 1);
-        fold_out = fold_out * 5.0f;
+    void process(const ProcessArgs &args) override {
+
+        // Silent in sample mode until the wavetable has been published
+        const SampleBuffer *table = wavetable->buffer.load(std::memory_order_acquire);
+        size_t tableSize = table ? table->frames : 0;
+
+        int channels = std::max(std::max(inputs[VOCT_INPUT].getChannels(), inputs[TRIG_INPUT].getChannels()), 1);
+
+        if (control_counter == 0) {
+            updateControl(channels, args.sampleTime);
+        }
+        control_counter = (control_counter + 1) % ACID_CONTROL_DIVISION;
 
         /*
-            Pluck
+            Wave, per voice
         */
-        float pluck_out = fold_out;
-
-        if(inputs[TRIG_INPUT].active){
-
-            /* ADSR */
-            float attack = 0.005f;
-            float decay = 10.0f;
-            float sustain = 10.0f;
-            float release = clamp(params[PLUCK_REL_PARAM].value + inputs[PLUCK_REL_INPUT].value / 10.0f, 0.0f, 1.0f);
-
-            // Gate and trigger
-            bool gated = inputs[TRIG_INPUT].value >= 1.0f;
-            if (trigger.process(inputs[TRIG_INPUT].value)){
-                decaying = false;
-                gated =true;
-            } else{
-                gated=false;
+        bool plucked = inputs[TRIG_INPUT].isConnected();
+        for (int c = 0; c < channels; c++) {
+            float voct = inputs[VOCT_INPUT].getPolyVoltage(c);
+            float voct2 = voct;
+            if(inputs[VOCT2_INPUT].isConnected()){
+                voct2 = inputs[VOCT2_INPUT].getPolyVoltage(c);
             }
 
-            const float base = 20000.0f;
-            const float maxTime = 20.0f;
-            if (gated) {
-                if (decaying) {
-                    // Decay
-                    if (decay < 1e-4) {
-                        env = sustain;
-                    }
-                    else {
-                        env += powf(base, 1 - decay) / maxTime * (sustain - env) * APP->engine->getSampleTime();
-                    }
-                }
-                else {
-                    // Attack
-                    // Skip ahead if attack is all the way down (infinitely fast)
-                    if (attack < 1e-4) {
-                        env = 1.0f;
-                    }
-                    else {
-                        env += powf(base, 1 - attack) / maxTime * (1.01f - env) * APP->engine->getSampleTime();
-                    }
-                    if (env >= 1.0f) {
-                        env = 1.0f;
-                        decaying = true;
-                    }
-                }
+            // OSC1
+            float osc1_out = 0.0f;
+            if (wave1 == 0) {
+                // Sample
+                if (tableSize > 0)
+                    osc1_out = 5 * table->data[0][(size_t) samplePos[c]];
             }
             else {
-                // Release
-                if (release < 1e-4) {
-                    env = 0.0f;
+                osc1[c]->setInputs(voct, 0.0, 0.0, 0.f, -2.f);
+                osc1[c]->process();
+                switch(wave1){
+                    // Sin
+                    case 1:
+                        osc1_out = osc1[c]->getSineWave();
+                        break;
+                    // Saw
+                    case 2:
+                        osc1_out = osc1[c]->getSawWave();
+                        break;
+                    // Pulse
+                    case 3:
+                        osc1_out = osc1[c]->getPulseWave();
+                        break;
+                    // Tri
+                    case 4:
+                        osc1_out = osc1[c]->getTriWave();
+                        break;
+                    // Noise
+                    case 5:
+                        osc1_out = osc1[c]->getNoise();
+                        break;
                 }
-                else {
-                    env += powf(base, 1 - release) / maxTime * (0.0f - env) * APP->engine->getSampleTime();
-                }
-                decaying = false;
             }
 
-            bool sustaining = isNear(env, sustain, 1e-3);
-            bool resting = isNear(env, 0.0f, 1e-3);
-            float env_output = 10.0f * env;
+            // Sampler moves regardless
+            samplePos[c] += sampleStep[c]; // 3 octaves higher because i made the sample wrong
+            if (samplePos[c] >= tableSize){
+                samplePos[c] = 0;
+            }
+
+            // OSC2, skipped entirely while it's mixed out
+            float osc2_out = 0.0f;
+            if (mix > 0.0f) {
+                osc2[c]->setInputs(voct2, 0.0, 0.0, 0.f, -2.f);
+                osc2[c]->process();
+                switch(wave2){
+                    // Sin
+                    case 0:
+                        osc2_out = osc2[c]->getSineWave();
+                        break;
+                    // Saw
+                    case 1:
+                        osc2_out = osc2[c]->getSawWave();
+                        break;
+                    // Pulse
+                    case 2:
+                        osc2_out = osc2[c]->getPulseWave();
+                        break;
+                    // Tri
+                    case 3:
+                        osc2_out = osc2[c]->getTriWave();
+                        break;
+                    // Noise
+                    case 4:
+                        osc2_out = osc2[c]->getNoise();
+                        break;
+                }
+            }
 
-            /* VCA */
-            float vca_cv = fmaxf(env_output / 10.f, 0.f);
-            float exp_val =  clamp(params[PLUCK_EXP_PARAM].value + inputs[PLUCK_EXP_INPUT].value / 10.0f, 0.0f, 1.0f);
-            vca_cv = powf(vca_cv, exp_val);
-            lastCv = vca_cv;
-            pluck_out = fold_out * vca_cv;
+            // Mix
+            wave_mixed[c] = ((1 - mix) * osc1_out) + (mix * osc2_out);
 
+            // Trigger
+            triggered[c] = trigger[c].process(inputs[TRIG_INPUT].getPolyVoltage(c)) ? 1.0f : 0.0f;
         }
 
         /*
-            Outputs
+            Everything after the oscillators runs on four voices at once
         */
-        outputs[OUT_OUTPUT].value = pluck_out;
-
-    }
-
-    void loadSample(std::string path) {
-        //from cF PLAYER.CPP
-
-        loading = true;
-        unsigned int c;
-        unsigned int sr;
-        drwav_uint64 sc;
-        float* pSampleData;
-        pSampleData = drwav_open_and_read_file_f32(path.c_str(), &c, &sr, &sc);
-
-        if (pSampleData != NULL) {
-            channels = c;
-            sampleRate = sr;
-            playBuffer[0].clear();
-            playBuffer[1].clear();
-
-            for (unsigned int i=0; i < sc; i = i + c) {
-                playBuffer[0].push_back(pSampleData[i]);
-                if (channels == 2)
-                    playBuffer[1].push_back((float)pSampleData[i+1]);
-
+        const float rise = 1e-2;
+        for (int c = 0; c < channels; c += 4) {
+            int g = c / 4;
+            float_4 trig = float_4::load(&triggered[c]) > 0.0f;
+
+            /*
+                Envelope
+            */
+            env_gate[g] = env_gate[g] | trig;
+            float_4 env_in = simd::ifelse(env_gate[g], 10.0f, 0.0f);
+
+            float_4 delta = env_in - env_out[g];
+            float_4 tau = simd::ifelse(delta > 0.0f, rise, fall);
+            env_out[g] += shapeDelta(delta, tau, shape) * args.sampleTime;
+            float_4 remaining = env_in - env_out[g];
+            float_4 rising = (delta > 0.0f) & (remaining > 1e-3f);
+            float_4 falling = (delta < 0.0f) & (remaining < -1e-3f);
+            env_gate[g] = simd::ifelse((delta >= 0.0f) & ~rising, 0.0f, env_gate[g]);
+            env_out[g] = simd::ifelse(rising | falling, env_out[g], env_in);
+
+            /*
+                VCA
+                via https://github.com/VCVRack/AudibleInstruments/blob/dd25b1785c2e67f19824fad97527c97c5d779685/src/Veils.cpp
+            */
+            float_4 vca_out = env_out[g] * env_amt;
+            outputs[ENV_OUTPUT].setVoltageSimd(vca_out, c);
+
+            /*
+                Filter
+            */
+            float_4 in = float_4::load(&wave_mixed[c]) / 5.0f;
+
+            // Stage 2
+            in = simd::clamp(in, -5.0f, 5.0f) * 0.2f;
+            float_4 a_outputd = in * (a_shapeA + a_shapeB);
+            a_outputd = a_outputd / ((simd::fabs(in) * a_shapeA) + a_shapeB);
+            filter_g[g] += filter_g_step[g];
+            filter[g].calcOutput(a_outputd, filter_g[g], filter_R);
+            float_4 filter_out = filter[g].lp * 3.0f;
+
+            /*
+                Fold!
+                from Lindenberg
+            */
+            float_4 x = simd::clamp(filter_out * 0.1f, -1.f, 1.f);
+            // do the acid!
+            float_4 fold_out = x * (simd::fabs(x) + fold_a) / (x * x + (fold_a - 1) * simd::fabs(x) + 1);
+            fold_out = fold_out * 5.0f;
+
+            /*
+                Pluck
+            */
+            float_4 pluck_out = fold_out;
+
+            if(plucked){
+                // Attack for the one sample we're triggered, release otherwise
+                env[g] = simd::ifelse(trig, env[g] + pluck_attack * (1.01f - env[g]), env[g] - pluck_release * env[g]);
+                env[g] = simd::fmin(env[g], 1.0f);
+
+                /* VCA */
+                vca_cv[g] += vca_step[g];
+                pluck_out = fold_out * vca_cv[g];
             }
-            totalSampleCount = playBuffer[0].size();
-            drwav_free(pSampleData);
-            loading = false;
-            fileLoaded = true;
-            vector<double>().swap(displayBuff);
-            for (int i=0; i < floor(totalSampleCount); i = i + floor(totalSampleCount/130)) {
-                displayBuff.push_back(playBuffer[0][i]);
-            }
-            fileDesc = "\n";
-            if (reload) {
-                DIR* rep = NULL;
-                struct dirent* dirp = NULL;
-                std::string dir = path.empty() ? rack::system::getDirectory(lastPath) : "";
-
-                rep = opendir(dir.c_str());
-                int i = 0;
-                fichier.clear();
-                while ((dirp = readdir(rep)) != NULL) {
-                    std::string name = dirp->d_name;
-
-                    std::size_t found = name.find(".wav",name.length()-5);
-                    if (found==std::string::npos) found = name.find(".WAV",name.length()-5);
-                    if (found!=std::string::npos) {
-                        fichier.push_back(name);
-                        if ((dir + "/" + name)==path) {sampnumber = i;}
-                        i=i+1;
-                        }
-
-                    }
-            sort(fichier.begin(), fichier.end());  // Linux needs this to get files in right order
-                for (int o=0;o<int(fichier.size()-1); o++) {
-                    if ((dir + "/" + fichier[o])==path) {
-                        sampnumber = o;
-                    }
-                }
-                closedir(rep);
-                reload = false;
-            }
-                lastPath = path;
-        }
-        else {
-            fileLoaded = false;
+
+            /*
+                Outputs
+            */
+            outputs[OUT_OUTPUT].setVoltageSimd(pluck_out, c);
         }
+        lastCv = vca_cv[0][0];
+
+        outputs[OUT_OUTPUT].setChannels(channels);
+        outputs[ENV_OUTPUT].setChannels(channels);
     }
 };
 
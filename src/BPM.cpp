@@ -1,4 +1,5 @@
 #include "RJModules.hpp"
+#include "UI.hpp"
 
 #include "dsp/digital.hpp"
 #include <iostream>
@@ -59,38 +60,12 @@ struct BigOlLight : BASE {
         }
 };
 
-struct NumberDisplayWidget : TransparentWidget {
-
-  int *value;
-
+struct NumberDisplayWidget : RJIntegerDisplay {
   NumberDisplayWidget() {
-  };
-
-  void draw(NVGcontext *vg) override
-  {
-    // Background
-    NVGcolor backgroundColor = nvgRGB(0xC0, 0xC0, 0xC0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
-    nvgFillColor(vg, backgroundColor);
-    nvgFill(vg);
-
-    // text
-
-    std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, "res/Segment7Standard.ttf"));
-    if (font) {
-    nvgFontSize(vg, 32);
-    nvgFontFaceId(vg, font->handle);
-    nvgTextLetterSpacing(vg, 2.5);
-    }
-
-    std::stringstream to_display;
-    to_display << std::setw(3) << (int) *value;
-
-    Vec textPos = Vec(16.0f, 33.0f);
-    NVGcolor textColor = nvgRGB(0x00, 0x00, 0x00);
-    nvgFillColor(vg, textColor);
-    nvgText(vg, textPos.x, textPos.y, to_display.str().c_str(), NULL);
+    fontPath = "res/Segment7Standard.ttf";
+    fontSize = 32;
+    letterSpacing = 2.5;
+    textPos = Vec(16.0f, 33.0f);
   }
 };
 
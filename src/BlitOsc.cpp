@@ -0,0 +1,276 @@
+/*
+BlitOsc - band limited saw, square and impulse train from stk::Blit,
+stk::BlitSaw and stk::BlitSquare.
+
+All three are built on the SincM impulse sin(M phi) / sin(phi). The STK
+classes call sin() twice per sample. Here sin(phi) is a short polynomial
+of the wrapped phase, and sin(M phi) is a rotating phasor, one complex
+multiply per sample, resynced from the phase every BLITOSC_RESYNC samples
+so float rounding can't build up. Four voices run in the lanes of each
+float_4.
+
+The phase is kept in [-pi/2, pi/2) with a flag for the other half turn,
+so it is most precise near the sinc peak where the ratio is most touchy.
+*/
+
+#include "RJModules.hpp"
+#include "UI.hpp"
+#include <iostream>
+#include <cmath>
+
+using simd::float_4;
+
+static const int BLITOSC_RESYNC = 16;
+// Keeps M phi inside the range a float sine can reduce accurately
+static const float BLITOSC_MAX_HARMONICS = 2048.f;
+
+struct BlitOscRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    BlitOscRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+// sin(x) for x in [-pi/2, pi/2], Taylor to x^11. The relative error stays
+// small near zero, which is where the sinc needs it.
+static inline float_4 blitOscSin(float_4 x) {
+    float_4 x2 = x * x;
+    float_4 y = -2.5052108e-8f;
+    y = y * x2 + 2.7557319e-6f;
+    y = y * x2 - 1.9841270e-4f;
+    y = y * x2 + 8.3333333e-3f;
+    y = y * x2 - 1.6666667e-1f;
+    return x + x * x2 * y;
+}
+
+// sin(M phi) / sin(phi) for four voices. Away from the peak sin(M phi) is a
+// rotating phasor. Near it both sines are tiny, so both come from the same
+// phase through blitOscSin() and their errors cancel instead of adding up.
+struct BlitOscSinc {
+    float_4 sm = 0.f;
+    float_4 cm = 1.f;
+    float_4 stepSm = 0.f;
+    float_4 stepCm = 1.f;
+    float_4 m = 1.f;
+    bool oddM = true;
+
+    // phi is psi, or psi + pi in the lanes set in `half`
+    void start(float_4 psi, float_4 half, float_4 rate, float_4 m, bool oddM) {
+        this->m = m;
+        this->oddM = oddM;
+        sm = simd::sin(m * psi);
+        cm = simd::cos(m * psi);
+        if (oddM) {
+            float_4 sign = simd::ifelse(half, -1.f, 1.f);
+            sm *= sign;
+            cm *= sign;
+        }
+        stepSm = simd::sin(m * rate);
+        stepCm = simd::cos(m * rate);
+    }
+
+    float_4 tick(float_4 psi, float_4 half) {
+        float_4 sign = simd::ifelse(half, -1.f, 1.f);
+        float_4 x = m * psi;
+        float_4 direct = blitOscSin(x);
+        if (oddM)
+            direct *= sign;
+        float_4 numerator = simd::ifelse(simd::fabs(x) < M_PI / 2, direct, sm);
+        float_4 d = numerator / (sign * blitOscSin(psi));
+        // At the peak itself, the limit M cos(M phi) / cos(phi)
+        d = simd::ifelse(simd::fabs(psi) < 1e-9f, oddM ? m : m * sign, d);
+
+        float_4 t = sm * stepCm + cm * stepSm;
+        cm = cm * stepCm - sm * stepSm;
+        sm = t;
+        return d;
+    }
+};
+
+struct BlitOsc: Module {
+    enum ParamIds {
+        FREQ_PARAM,
+        FINE_PARAM,
+        HARMONICS_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        VOCT_INPUT,
+        HARMONICS_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        SAW_OUTPUT,
+        SQUARE_OUTPUT,
+        IMPULSE_OUTPUT,
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        NUM_LIGHTS
+    };
+
+    // The saw's phase at the last resync. It turns pi per cycle, the square's
+    // runs at twice that.
+    float_4 psi[4] = {0.f, 0.f, 0.f, 0.f};
+    float_4 half[4] = {0.f, 0.f, 0.f, 0.f};
+    float_4 rate[4] = {0.f, 0.f, 0.f, 0.f};
+    float_4 sawP[4] = {1.f, 1.f, 1.f, 1.f};
+    float_4 squareP[4] = {1.f, 1.f, 1.f, 1.f};
+    BlitOscSinc saws[4];
+    BlitOscSinc squares[4];
+    float_4 sawStates[4] = {0.f, 0.f, 0.f, 0.f};
+    float_4 squareBlits[4] = {0.f, 0.f, 0.f, 0.f};
+    float_4 squareDcb[4] = {0.f, 0.f, 0.f, 0.f};
+    float_4 squareOuts[4] = {0.f, 0.f, 0.f, 0.f};
+    int counter = 0;
+    // What the last resync covered, a new group or the square being
+    // patched in resyncs straight away rather than running stale
+    int syncedGroups = 0;
+    bool syncedSquare = false;
+
+    BlitOsc() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(BlitOsc::FREQ_PARAM, -4.0, 4.0, 0.0, "Frequency", " Hz", 2, dsp::FREQ_C4);
+        configParam(BlitOsc::FINE_PARAM, -1.0, 1.0, 0.0, "Fine", " semitones");
+        configParam(BlitOsc::HARMONICS_PARAM, 0.0, 1.0, 1.0, "Harmonics", "%", 0, 100);
+    }
+
+    // 2 phi wrapped back into [-pi/2, pi/2), for the square
+    static float_4 doubled(float_4 psi, float_4 *half) {
+        float_4 t = 2.f * psi;
+        float_4 up = t < -M_PI / 2;
+        float_4 down = t >= M_PI / 2;
+        *half = up | down;
+        return t + simd::ifelse(up, M_PI, 0.f) - simd::ifelse(down, M_PI, 0.f);
+    }
+
+    // The phase n samples after the last resync. Working it out fresh instead
+    // of adding up steps keeps it in line with the sin(M phi) phasor.
+    float_4 phaseAt(int g, int n, float_4 *halfOut) {
+        float_4 t = psi[g] + (float) n * rate[g];
+        float_4 wraps = simd::floor((t + M_PI / 2) * (1.f / M_PI));
+        t -= wraps * M_PI;
+        *halfOut = half[g] ^ ((wraps - 2.f * simd::floor(wraps * 0.5f)) != 0.f);
+        return t;
+    }
+
+    void resync(int g, float_4 pitch, float harmonics, bool square, const ProcessArgs& args) {
+        float_4 freq = simd::clamp(dsp::FREQ_C4 * dsp::approxExp2_taylor5(simd::clamp(pitch, -6.f, 6.f)), 10.f, args.sampleRate * 0.45f);
+
+        // BlitSaw::setFrequency() and updateHarmonics(), with fewer harmonics as the knob goes down
+        float_4 p = args.sampleRate / freq;
+        float_4 harmonicsMax = simd::fmin(simd::floor(0.5f * p), BLITOSC_MAX_HARMONICS);
+        float_4 n = simd::fmax(simd::round(harmonicsMax * harmonics), 1.f);
+        rate[g] = M_PI / p;
+        sawP[g] = p;
+        saws[g].start(psi[g], half[g], rate[g], 2.f * n + 1.f, true);
+
+        if (square) {
+            // BlitSquare uses half the period and an even M, so its phase is 2 phi
+            float_4 p2 = 0.5f * p;
+            float_4 n2 = simd::fmax(simd::round(simd::fmin(simd::floor(0.5f * p2), BLITOSC_MAX_HARMONICS) * harmonics), 1.f);
+            float_4 squareHalf;
+            float_4 squarePsi = doubled(psi[g], &squareHalf);
+            squareP[g] = p2;
+            squares[g].start(squarePsi, squareHalf, 2.f * rate[g], 2.f * (n2 + 1.f), false);
+        }
+    }
+
+    void process(const ProcessArgs& args) override {
+        int channels = std::max(1, inputs[VOCT_INPUT].getChannels());
+        bool square = outputs[SQUARE_OUTPUT].isConnected();
+        int groups = (channels + 3) / 4;
+        syncedGroups = std::min(syncedGroups, groups);
+        syncedSquare = syncedSquare && square;
+
+        // Samples since the last resync, which is where the new one starts from
+        int elapsed = BLITOSC_RESYNC;
+        if (counter != 0 && (groups > syncedGroups || square != syncedSquare)) {
+            elapsed = counter;
+            counter = 0;
+        }
+
+        if (counter == 0) {
+            float harmonics = clamp(params[HARMONICS_PARAM].getValue() + inputs[HARMONICS_INPUT].getVoltage() / 10.f, 0.f, 1.f);
+            harmonics *= harmonics;
+            float pitch = params[FREQ_PARAM].getValue() + params[FINE_PARAM].getValue() / 12.f;
+            for (int c = 0; c < channels; c += 4) {
+                int g = c / 4;
+                psi[g] = phaseAt(g, elapsed, &half[g]);
+                resync(g, pitch + inputs[VOCT_INPUT].getPolyVoltageSimd<float_4>(c), harmonics, square, args);
+            }
+            syncedGroups = groups;
+            syncedSquare = square;
+        }
+        int n = counter;
+        if (++counter >= BLITOSC_RESYNC)
+            counter = 0;
+
+        for (int c = 0; c < channels; c += 4) {
+            int g = c / 4;
+            float_4 sawHalf;
+            float_4 sawPsi = phaseAt(g, n, &sawHalf);
+            float_4 d = saws[g].tick(sawPsi, sawHalf);
+
+            // Blit, normalised to a peak of 1
+            float_4 impulse = d / saws[g].m;
+
+            // BlitSaw: leaky integration of the impulses less their DC
+            float_4 saw = d / sawP[g] + sawStates[g] - 1.f / sawP[g];
+            sawStates[g] = saw * 0.995f;
+
+            outputs[SAW_OUTPUT].setVoltageSimd(saw * 5.f, c);
+            outputs[IMPULSE_OUTPUT].setVoltageSimd(impulse * 5.f, c);
+
+            if (square) {
+                // BlitSquare: integrate the bipolar impulses, then block DC
+                float_4 squareHalf;
+                float_4 squarePsi = doubled(sawPsi, &squareHalf);
+                squareBlits[g] = squares[g].tick(squarePsi, squareHalf) / squareP[g] + squareBlits[g];
+                squareOuts[g] = squareBlits[g] - squareDcb[g] + 0.999f * squareOuts[g];
+                squareDcb[g] = squareBlits[g];
+                outputs[SQUARE_OUTPUT].setVoltageSimd(squareOuts[g] * 5.f, c);
+            }
+        }
+
+        outputs[SAW_OUTPUT].setChannels(channels);
+        outputs[SQUARE_OUTPUT].setChannels(channels);
+        outputs[IMPULSE_OUTPUT].setChannels(channels);
+    }
+};
+
+
+struct BlitOscWidget: ModuleWidget {
+    BlitOscWidget(BlitOsc *module);
+};
+
+BlitOscWidget::BlitOscWidget(BlitOsc *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/BlitOsc.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    addParam(createParam<BlitOscRoundLargeBlackKnob>(Vec(51, 60), module, BlitOsc::FREQ_PARAM));
+    addParam(createParam<BlitOscRoundLargeBlackKnob>(Vec(14, 140), module, BlitOsc::FINE_PARAM));
+    addParam(createParam<BlitOscRoundLargeBlackKnob>(Vec(88, 140), module, BlitOsc::HARMONICS_PARAM));
+
+    addInput(createInput<PJ301MPort>(Vec(22, 230), module, BlitOsc::VOCT_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(97, 230), module, BlitOsc::HARMONICS_INPUT));
+
+    addOutput(createOutput<PJ301MPort>(Vec(22, 320), module, BlitOsc::SAW_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(61, 320), module, BlitOsc::SQUARE_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(97, 320), module, BlitOsc::IMPULSE_OUTPUT));
+}
+
+Model *modelBlitOsc = createModel<BlitOsc, BlitOscWidget>("BlitOsc");
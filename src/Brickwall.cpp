@@ -1,8 +1,15 @@
 /*
+Brickwall - a hard clipper, or a lookahead true-peak limiter.
 
+The limiter buffers audio in blocks of BRICKWALL_BLOCK frames and runs the
+gain computer over a whole block at a time. Inter-sample peaks are estimated
+with a 4x polyphase interpolator, a sliding minimum over the lookahead window
+holds the required gain and a box filter of the same length smooths it in, so
+the gain has always reached its target by the time the peak leaves the delay.
 */
 
 #include "RJModules.hpp"
+#include "UI.hpp"
 
 #include "common.hpp"
 #include <iostream>
@@ -18,6 +25,172 @@ struct BrickwallRoundSmallBlackKnob : RoundSmallBlackKnob
     }
 };
 
+static const int BRICKWALL_CHANNELS = 16;
+static const int BRICKWALL_BLOCK = 16;
+// Power of two, longer than the largest lookahead at 192kHz plus the detector lag
+static const int BRICKWALL_RING = 1024;
+static const int BRICKWALL_RING_MASK = BRICKWALL_RING - 1;
+// Interpolator taps, and how far the true-peak estimate trails the input
+static const int BRICKWALL_TAPS = 8;
+static const int BRICKWALL_TP_LAG = 4;
+
+static const float brickwallLookaheads[] = {0.5f, 1.0f, 2.0f, 5.0f};
+static const float brickwallReleases[] = {10.0f, 50.0f, 100.0f, 250.0f, 500.0f};
+
+struct BrickwallLimiter {
+
+    float history[BRICKWALL_CHANNELS][2 * BRICKWALL_TAPS] = {};
+    float delay[BRICKWALL_CHANNELS][BRICKWALL_RING] = {};
+
+    // Sliding minimum (monotonic queue) of the required gain
+    float minValue[BRICKWALL_CHANNELS][BRICKWALL_RING];
+    uint32_t minTime[BRICKWALL_CHANNELS][BRICKWALL_RING];
+    uint32_t minHead[BRICKWALL_CHANNELS];
+    uint32_t minTail[BRICKWALL_CHANNELS];
+
+    // Box filter over the held gain
+    float box[BRICKWALL_CHANNELS][BRICKWALL_RING];
+    double boxSum[BRICKWALL_CHANNELS];
+
+    float env[BRICKWALL_CHANNELS];
+    float coeffs[3][BRICKWALL_TAPS];
+
+    uint32_t time = 0;
+    int historyPos = 0;
+    int lookahead = 48;
+    float releaseCoef = 0.999f;
+
+    BrickwallLimiter() {
+        // Hann-windowed sinc for the three fractional positions between the
+        // newest fully-surrounded sample and the one after it
+        for (int p = 0; p < 3; p++) {
+            float frac = (p + 1) * 0.25f;
+            float sum = 0.0f;
+            for (int j = 0; j < BRICKWALL_TAPS; j++) {
+                float t = frac - (j - (BRICKWALL_TAPS / 2 - 1));
+                float sinc = (t == 0.0f) ? 1.0f : sinf(M_PI * t) / (M_PI * t);
+                float window = 0.5f + 0.5f * cosf(M_PI * t / (BRICKWALL_TAPS / 2));
+                coeffs[p][j] = sinc * window;
+                sum += coeffs[p][j];
+            }
+            for (int j = 0; j < BRICKWALL_TAPS; j++) {
+                coeffs[p][j] /= sum;
+            }
+        }
+        reset();
+    }
+
+    void reset() {
+        for (int c = 0; c < BRICKWALL_CHANNELS; c++) {
+            minHead[c] = 0;
+            minTail[c] = 0;
+            boxSum[c] = lookahead;
+            env[c] = 1.0f;
+            for (int i = 0; i < BRICKWALL_RING; i++) {
+                box[c][i] = 1.0f;
+            }
+        }
+        time = 0;
+    }
+
+    void setParams(float lookaheadMs, float releaseMs, float sampleRate) {
+        int newLookahead = clamp((int) (lookaheadMs * 0.001f * sampleRate), 1, BRICKWALL_RING - BRICKWALL_TP_LAG - 1);
+        if (newLookahead != lookahead) {
+            lookahead = newLookahead;
+            reset();
+        }
+        releaseCoef = 1.0f - expf(-1.0f / (releaseMs * 0.001f * sampleRate));
+    }
+
+    // Frames of latency from input to output, not counting the block buffer
+    int latency() {
+        return lookahead - 1 + BRICKWALL_TP_LAG;
+    }
+
+    // Largest of the current sample and the three interpolated points after it
+    float truePeak(int c, float x) {
+        float *h = history[c];
+        h[historyPos] = x;
+        h[historyPos + BRICKWALL_TAPS] = x;
+        const float *w = &h[historyPos + 1];
+        float peak = fabsf(w[BRICKWALL_TAPS / 2 - 1]);
+        for (int p = 0; p < 3; p++) {
+            float y = 0.0f;
+            for (int j = 0; j < BRICKWALL_TAPS; j++) {
+                y += coeffs[p][j] * w[j];
+            }
+            peak = fmaxf(peak, fabsf(y));
+        }
+        return peak;
+    }
+
+    float gainStep(int c, float target) {
+        float *values = minValue[c];
+        uint32_t *times = minTime[c];
+
+        while (minTail[c] != minHead[c] && values[(minTail[c] - 1) & BRICKWALL_RING_MASK] >= target) {
+            minTail[c]--;
+        }
+        values[minTail[c] & BRICKWALL_RING_MASK] = target;
+        times[minTail[c] & BRICKWALL_RING_MASK] = time;
+        minTail[c]++;
+        while (time - times[minHead[c] & BRICKWALL_RING_MASK] >= (uint32_t) lookahead) {
+            minHead[c]++;
+        }
+        float held = values[minHead[c] & BRICKWALL_RING_MASK];
+
+        int boxIndex = time & BRICKWALL_RING_MASK;
+        int boxOldest = (time - lookahead) & BRICKWALL_RING_MASK;
+        boxSum[c] += held - box[c][boxOldest];
+        box[c][boxIndex] = held;
+        float smoothed = (float) (boxSum[c] / lookahead);
+
+        // Never rise faster than the release; falls are already smoothed
+        if (smoothed < env[c]) {
+            env[c] = smoothed;
+        } else {
+            env[c] += (smoothed - env[c]) * releaseCoef;
+        }
+        return env[c];
+    }
+
+    void processBlock(float in[][BRICKWALL_BLOCK], float out[][BRICKWALL_BLOCK], float gains[][BRICKWALL_BLOCK], int channels, bool linked, float threshold) {
+        int d = latency();
+        for (int i = 0; i < BRICKWALL_BLOCK; i++) {
+            historyPos = (historyPos + 1) & (BRICKWALL_TAPS - 1);
+            int writeIndex = time & BRICKWALL_RING_MASK;
+            int readIndex = (time - d) & BRICKWALL_RING_MASK;
+
+            float linkedPeak = 0.0f;
+            float peaks[BRICKWALL_CHANNELS];
+            for (int c = 0; c < channels; c++) {
+                delay[c][writeIndex] = in[c][i];
+                peaks[c] = truePeak(c, in[c][i]);
+                linkedPeak = fmaxf(linkedPeak, peaks[c]);
+            }
+
+            if (linked) {
+                float target = (linkedPeak > threshold) ? threshold / linkedPeak : 1.0f;
+                float gain = gainStep(0, target);
+                for (int c = 0; c < channels; c++) {
+                    gains[c][i] = gain;
+                }
+            } else {
+                for (int c = 0; c < channels; c++) {
+                    float target = (peaks[c] > threshold) ? threshold / peaks[c] : 1.0f;
+                    gains[c][i] = gainStep(c, target);
+                }
+            }
+
+            for (int c = 0; c < channels; c++) {
+                // The interpolator is an estimate, so keep a hard ceiling
+                out[c][i] = clamp(delay[c][readIndex] * gains[c][i], -threshold, threshold);
+            }
+            time++;
+        }
+    }
+};
+
 struct Brickwall : Module {
     enum ParamIds {
         LEVEL_PARAM,
@@ -51,6 +224,7 @@ struct Brickwall : Module {
     };
     enum OutputIds {
         OUT_OUTPUT,
+        GR_OUTPUT,
         NUM_OUTPUTS
     };
     enum LightIds {
@@ -67,6 +241,41 @@ struct Brickwall : Module {
     float env = 0.0f;
     dsp::SchmittTrigger trigger;
 
+    // Limiter
+    int limiter_mode_index = 0;
+    int lookahead_index = 1;
+    int release_index = 2;
+    int link_mode_index = 0;
+    BrickwallLimiter limiter;
+    float inBlock[BRICKWALL_CHANNELS][BRICKWALL_BLOCK] = {};
+    float outBlock[BRICKWALL_CHANNELS][BRICKWALL_BLOCK] = {};
+    float gainBlock[BRICKWALL_CHANNELS][BRICKWALL_BLOCK] = {};
+    int blockPos = 0;
+
+    json_t *dataToJson() override {
+        json_t *rootJ = json_object();
+        json_object_set_new(rootJ, "limiter", json_integer(limiter_mode_index));
+        json_object_set_new(rootJ, "lookahead", json_integer(lookahead_index));
+        json_object_set_new(rootJ, "release", json_integer(release_index));
+        json_object_set_new(rootJ, "link", json_integer(link_mode_index));
+        return rootJ;
+    }
+
+    void dataFromJson(json_t *rootJ) override {
+        json_t *limiterJ = json_object_get(rootJ, "limiter");
+        if (limiterJ)
+            limiter_mode_index = json_integer_value(limiterJ);
+        json_t *lookaheadJ = json_object_get(rootJ, "lookahead");
+        if (lookaheadJ)
+            lookahead_index = clamp((int) json_integer_value(lookaheadJ), 0, (int) LENGTHOF(brickwallLookaheads) - 1);
+        json_t *releaseJ = json_object_get(rootJ, "release");
+        if (releaseJ)
+            release_index = clamp((int) json_integer_value(releaseJ), 0, (int) LENGTHOF(brickwallReleases) - 1);
+        json_t *linkJ = json_object_get(rootJ, "link");
+        if (linkJ)
+            link_mode_index = json_integer_value(linkJ);
+    }
+
     Brickwall() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
         configParam(Brickwall::DEPTH_PARAM, 0.0, 12.0, 10.0, "");
@@ -76,16 +285,25 @@ struct Brickwall : Module {
         configParam(Brickwall::POSTAMP_PARAM, 1.0f, 2.5f, 1.0f, "");
     }
 
-    void step() override {
-
-        float input = inputs[IN_INPUT].value;
-        input = input * params[PREAMP_PARAM].value;
+    void onReset() override {
+        limiter.reset();
+    }
 
+    void process(const ProcessArgs &args) override {
 
         float calculated_depth = params[DEPTH_PARAM].value;
         if(inputs[DEPTH_INPUT].isConnected()){
             calculated_depth = clamp(params[DEPTH_PARAM].value + inputs[DEPTH_INPUT].value / 10.0f, 0.0f, 10.0f);
         }
+
+        if(limiter_mode_index != 0){
+            processLimiter(args, calculated_depth);
+            return;
+        }
+
+        float input = inputs[IN_INPUT].value;
+        input = input * params[PREAMP_PARAM].value;
+
         float output = inputs[IN_INPUT].value;
         float light_value = 0.0;
 
@@ -101,7 +319,10 @@ struct Brickwall : Module {
         output = output * params[POSTAMP_PARAM].value;
 
         // lights[ACTIVE_LIGHT].setBrightness(light_value);
+        outputs[OUT_OUTPUT].setChannels(1);
         outputs[OUT_OUTPUT].value = output;
+        outputs[GR_OUTPUT].setChannels(1);
+        outputs[GR_OUTPUT].value = light_value != 0.0 ? 10.0f : 0.0f;
 
         /* ADSR */
         // float attack = 0.005f;
@@ -164,6 +385,28 @@ struct Brickwall : Module {
         // outputs[OUT_OUTPUT].value = inputs[IN_INPUT].value * cv;
 
     }
+
+    void processLimiter(const ProcessArgs &args, float threshold) {
+        int channels = std::max(1, inputs[IN_INPUT].getChannels());
+        bool linked = link_mode_index == 0;
+        float preamp = params[PREAMP_PARAM].value;
+        float postamp = params[POSTAMP_PARAM].value;
+
+        for (int c = 0; c < channels; c++) {
+            inBlock[c][blockPos] = inputs[IN_INPUT].getVoltage(c) * preamp;
+            outputs[OUT_OUTPUT].setVoltage(outBlock[c][blockPos] * postamp, c);
+            outputs[GR_OUTPUT].setVoltage(10.0f * (1.0f - gainBlock[c][blockPos]), c);
+        }
+        outputs[OUT_OUTPUT].setChannels(channels);
+        outputs[GR_OUTPUT].setChannels(linked ? 1 : channels);
+
+        blockPos++;
+        if (blockPos >= BRICKWALL_BLOCK) {
+            blockPos = 0;
+            limiter.setParams(brickwallLookaheads[lookahead_index], brickwallReleases[release_index], args.sampleRate);
+            limiter.processBlock(inBlock, outBlock, gainBlock, channels, linked, std::max(threshold, 0.001f));
+        }
+    }
 };
 
 struct BrickwallWidget : ModuleWidget {
@@ -176,18 +419,46 @@ struct BrickwallWidget : ModuleWidget {
         addChild(createWidget<ScrewSilver>(Vec(RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
         addChild(createWidget<ScrewSilver>(Vec(box.size.x - 2 * RACK_GRID_WIDTH, RACK_GRID_HEIGHT - RACK_GRID_WIDTH)));
 
-        addParam(createParam<BrickwallRoundSmallBlackKnob>(mm2px(Vec(3.5, 38.9593)), module, Brickwall::DEPTH_PARAM));
-        addInput(createInput<PJ301MPort>(mm2px(Vec(3.51398, 48.74977)), module, Brickwall::DEPTH_INPUT));
+        addParam(createParam<BrickwallRoundSmallBlackKnob>(mm2px(Vec(3.5, 36.9593)), module, Brickwall::DEPTH_PARAM));
+        addInput(createInput<PJ301MPort>(mm2px(Vec(3.51398, 46.74977)), module, Brickwall::DEPTH_INPUT));
 
-        addParam(createParam<BrickwallRoundSmallBlackKnob>(mm2px(Vec(3.5, 65.9593)), module, Brickwall::PREAMP_PARAM));
+        addParam(createParam<BrickwallRoundSmallBlackKnob>(mm2px(Vec(3.5, 61.4593)), module, Brickwall::PREAMP_PARAM));
         // addInput(createInput<PJ301MPort>(mm2px(Vec(3.51398, 71.74977)), module, Brickwall::EXP_INPUT));
 
-        addParam(createParam<BrickwallRoundSmallBlackKnob>(mm2px(Vec(3.5, 81.9593)), module, Brickwall::POSTAMP_PARAM));
+        addParam(createParam<BrickwallRoundSmallBlackKnob>(mm2px(Vec(3.5, 75.9593)), module, Brickwall::POSTAMP_PARAM));
 
         // addChild(createLight<SmallLight<GreenRedLight>>(Vec(3, 84), module, Brickwall::ACTIVE_LIGHT));
         // addInput(createInput<PJ301MPort>(mm2px(Vec(3.51398, 84.74977)), module, Brickwall::GATE_INPUT));
-        addInput(createInput<PJ301MPort>(mm2px(Vec(3.51398, 97.74977)), module, Brickwall::IN_INPUT));
-        addOutput(createOutput<PJ301MPort>(mm2px(Vec(3.51398, 108.64454)), module, Brickwall::OUT_OUTPUT));
+        addInput(createInput<PJ301MPort>(mm2px(Vec(3.51398, 89.24977)), module, Brickwall::IN_INPUT));
+        addOutput(createOutput<PJ301MPort>(mm2px(Vec(3.51398, 99.64454)), module, Brickwall::OUT_OUTPUT));
+        addOutput(createOutput<PJ301MPort>(mm2px(Vec(3.51398, 113.84454)), module, Brickwall::GR_OUTPUT));
+    }
+
+    void appendContextMenu(Menu *menu) override
+    {
+        Brickwall *module = dynamic_cast<Brickwall *>(this->module);
+
+        menu->addChild(new MenuEntry);
+
+        RJChoiceItem *modeItem = createMenuItem<RJChoiceItem>("Mode", ">");
+        modeItem->target = &module->limiter_mode_index;
+        modeItem->labels = {"Clip", "Lookahead Limiter"};
+        menu->addChild(modeItem);
+
+        RJChoiceItem *lookaheadItem = createMenuItem<RJChoiceItem>("Lookahead", ">");
+        lookaheadItem->target = &module->lookahead_index;
+        lookaheadItem->labels = {"0.5 ms", "1 ms", "2 ms", "5 ms"};
+        menu->addChild(lookaheadItem);
+
+        RJChoiceItem *releaseItem = createMenuItem<RJChoiceItem>("Release", ">");
+        releaseItem->target = &module->release_index;
+        releaseItem->labels = {"10 ms", "50 ms", "100 ms", "250 ms", "500 ms"};
+        menu->addChild(releaseItem);
+
+        RJChoiceItem *linkItem = createMenuItem<RJChoiceItem>("Channel Link", ">");
+        linkItem->target = &module->link_mode_index;
+        linkItem->labels = {"Linked", "Unlinked"};
+        menu->addChild(linkItem);
     }
 };
 
@@ -0,0 +1,220 @@
+/*
+Cabinet - convolves its input with an impulse response loaded from a WAV
+file, for speaker cabinets, instrument bodies and rooms.
+
+The convolution is Convolver's uniformly partitioned FFT, so an impulse
+response of several seconds costs about the same on every sample, and the
+wet signal is always CONVOLVER_BLOCK samples late. The dry signal is held
+back by the same amount so the mix doesn't comb filter. Files are decoded
+by SampleLoader and the convolver is built on ConvolverLoader's worker.
+*/
+
+#include "RJModules.hpp"
+#include "UI.hpp"
+#include "Convolver.hpp"
+#include "osdialog.h"
+#include <iostream>
+#include <cmath>
+
+struct CabinetRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    CabinetRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+struct Cabinet: Module {
+    enum ParamIds {
+        MIX_PARAM,
+        LEVEL_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        IN_INPUT,
+        MIX_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        OUT_OUTPUT,
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        NUM_LIGHTS
+    };
+
+    ConvolverLoader loader;
+    Convolver *convolver = NULL;
+
+    // The dry signal, delayed to line up with the wet
+    float dry[CONVOLVER_BLOCK] = {};
+    int dryPosition = 0;
+
+    Cabinet() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(Cabinet::MIX_PARAM, 0.0, 1.0, 1.0, "Mix", "%", 0, 100);
+        configParam(Cabinet::LEVEL_PARAM, -24.0, 12.0, 0.0, "Level", " dB");
+    }
+
+    ~Cabinet() {
+        delete convolver;
+    }
+
+    void onSampleRateChange() override {
+        loader.setSampleRate(APP->engine->getSampleRate());
+    }
+
+    json_t *dataToJson() override {
+        json_t *rootJ = json_object();
+        json_object_set_new(rootJ, "path", json_string(loader.getPath().c_str()));
+        return rootJ;
+    }
+
+    void dataFromJson(json_t *rootJ) override {
+        json_t *pathJ = json_object_get(rootJ, "path");
+        if (pathJ && json_string_value(pathJ)[0])
+            loader.load(json_string_value(pathJ));
+    }
+
+    void process(const ProcessArgs& args) override {
+        loader.setSampleRate(args.sampleRate);
+        if (Convolver *ready = loader.take()) {
+            loader.retire(convolver);
+            convolver = ready;
+        }
+
+        // Poly inputs are summed, a cabinet is the end of the chain
+        float in = inputs[IN_INPUT].getVoltageSum();
+        float delayed = dry[dryPosition];
+        dry[dryPosition] = in;
+        dryPosition = (dryPosition + 1) % CONVOLVER_BLOCK;
+
+        // With nothing loaded the input passes straight through
+        bool loaded = convolver && !convolver->empty();
+        float wet = loaded ? convolver->process(in) : in;
+        if (!loaded)
+            delayed = in;
+        float mix = clamp(params[MIX_PARAM].getValue() + inputs[MIX_INPUT].getVoltage() / 10.f, 0.f, 1.f);
+        float gain = dsp::dbToAmplitude(params[LEVEL_PARAM].getValue());
+        outputs[OUT_OUTPUT].setVoltage(gain * (delayed + (wet - delayed) * mix));
+    }
+};
+
+/*
+Display
+*/
+
+struct CabinetFileDisplay : RJTextDisplay {
+    Cabinet *module = NULL;
+    std::string shownPath = "";
+    bool shownFailed = false;
+
+    CabinetFileDisplay() {
+        fontSize = 12;
+        letterSpacing = 0.5;
+        text = "NO IR";
+    }
+
+    bool update() override {
+        if (!module)
+            return false;
+        std::string path = module->loader.getPath();
+        bool failed = module->loader.failed.load(std::memory_order_relaxed);
+        if (path == shownPath && failed == shownFailed)
+            return false;
+
+        shownPath = path;
+        shownFailed = failed;
+        if (failed)
+            text = "ERROR";
+        else if (path.empty())
+            text = "NO IR";
+        else
+            text = string::filenameBase(string::filename(path)).substr(0, 14);
+        return true;
+    }
+
+    void drawText(NVGcontext *vg) override {
+        nvgTextAlign(vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(vg, box.size.x / 2, box.size.y / 2, text.c_str(), NULL);
+    }
+};
+
+
+struct CabinetWidget: ModuleWidget {
+    CabinetWidget(Cabinet *module);
+    void appendContextMenu(Menu *menu) override;
+};
+
+CabinetWidget::CabinetWidget(Cabinet *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/Cabinet.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    {
+        CabinetFileDisplay *display = new CabinetFileDisplay();
+        display->box.pos = Vec(10, 40);
+        display->box.size = Vec(130, 30);
+        display->module = module;
+        addChild(display);
+    }
+
+    addParam(createParam<CabinetRoundLargeBlackKnob>(Vec(14, 100), module, Cabinet::MIX_PARAM));
+    addParam(createParam<CabinetRoundLargeBlackKnob>(Vec(88, 100), module, Cabinet::LEVEL_PARAM));
+
+    addInput(createInput<PJ301MPort>(Vec(22, 280), module, Cabinet::IN_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(97, 280), module, Cabinet::MIX_INPUT));
+
+    addOutput(createOutput<PJ301MPort>(Vec(61, 320), module, Cabinet::OUT_OUTPUT));
+}
+
+void CabinetWidget::appendContextMenu(Menu *menu) {
+    Cabinet *module = dynamic_cast<Cabinet *>(this->module);
+
+    struct LoadItem : MenuItem
+    {
+        Cabinet *module;
+        void onAction(const event::Action &e) override
+        {
+            osdialog_filters *filters = osdialog_filters_parse("WAV:wav,WAV");
+            char *path = osdialog_file(OSDIALOG_OPEN, NULL, NULL, filters);
+            osdialog_filters_free(filters);
+            if (path) {
+                module->loader.load(path);
+                free(path);
+            }
+        }
+    };
+
+    struct UnloadItem : MenuItem
+    {
+        Cabinet *module;
+        void onAction(const event::Action &e) override
+        {
+            module->loader.load("");
+        }
+    };
+
+    menu->addChild(new MenuEntry);
+
+    LoadItem *loadItem = createMenuItem<LoadItem>("Load impulse response...");
+    loadItem->module = module;
+    menu->addChild(loadItem);
+
+    UnloadItem *unloadItem = createMenuItem<UnloadItem>("Unload");
+    unloadItem->module = module;
+    menu->addChild(unloadItem);
+}
+
+Model *modelCabinet = createModel<Cabinet, CabinetWidget>("Cabinet");
@@ -1,4 +1,5 @@
 #include "RJModules.hpp"
+#include "UI.hpp"
 #include "dsp/digital.hpp"
 #include <iostream>
 #include <cmath>
@@ -6,32 +7,11 @@
 #include <iomanip>
 
 // Displays
-struct SmallStringDisplayWidget : TransparentWidget {
-  std::string *value;
-
-  void draw(NVGcontext *vg) override
-  {
-    // Background
-    NVGcolor backgroundColor = nvgRGB(0xC0, 0xC0, 0xC0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
-    nvgFillColor(vg, backgroundColor);
-    nvgFill(vg);
-
-    // text
-	std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, "res/Pokemon.ttf"));
-  if (font) {
-    nvgFontSize(vg, 13);
-    nvgFontFaceId(vg, font->handle);
-    nvgTextLetterSpacing(vg, 2);
-}
-    std::stringstream to_display;
-    to_display << std::setw(3) << *value;
-
-    Vec textPos = Vec(4.0f, 20.0f);
-    NVGcolor textColor = nvgRGB(0x00, 0x00, 0x00);
-    nvgFillColor(vg, textColor);
-    nvgText(vg, textPos.x, textPos.y, to_display.str().c_str(), NULL);
+struct SmallStringDisplayWidget : RJStringDisplay {
+  SmallStringDisplayWidget() {
+    fontSize = 13;
+    letterSpacing = 2;
+    textPos = Vec(4.0f, 20.0f);
   }
 };
 
@@ -0,0 +1,236 @@
+#include "Convolver.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using rack::simd::float_4;
+
+static const int CONVOLVER_SIZE = 2 * CONVOLVER_BLOCK;
+
+// acc += h * x for split spectra, with bin 0 as two real products
+static void convolverMultiplyAdd(float *acc, const float *h, const float *x) {
+    const int B = CONVOLVER_BLOCK;
+    float dc = acc[0] + h[0] * x[0];
+    float nyquist = acc[B] + h[B] * x[B];
+    for (int k = 0; k < B; k += 4) {
+        float_4 hr = float_4::load(h + k);
+        float_4 hi = float_4::load(h + B + k);
+        float_4 xr = float_4::load(x + k);
+        float_4 xi = float_4::load(x + B + k);
+        (float_4::load(acc + k) + hr * xr - hi * xi).store(acc + k);
+        (float_4::load(acc + B + k) + hr * xi + hi * xr).store(acc + B + k);
+    }
+    acc[0] = dc;
+    acc[B] = nyquist;
+}
+
+// RealFFT's ordered layout is DC, Nyquist, then re/im pairs
+static void convolverSplit(const float *ordered, float *split) {
+    const int B = CONVOLVER_BLOCK;
+    split[0] = ordered[0];
+    split[B] = ordered[1];
+    for (int k = 1; k < B; k++) {
+        split[k] = ordered[2 * k];
+        split[B + k] = ordered[2 * k + 1];
+    }
+}
+
+static void convolverOrder(const float *split, float *ordered) {
+    const int B = CONVOLVER_BLOCK;
+    ordered[0] = split[0];
+    ordered[1] = split[B];
+    for (int k = 1; k < B; k++) {
+        ordered[2 * k] = split[k];
+        ordered[2 * k + 1] = split[B + k];
+    }
+}
+
+Convolver::Convolver(const float *impulse, size_t length) : fft(CONVOLVER_SIZE), length(length) {
+    partitions = std::max<int>(1, (length + CONVOLVER_BLOCK - 1) / CONVOLVER_BLOCK);
+    perSample = (partitions - 1 + CONVOLVER_BLOCK - 1) / CONVOLVER_BLOCK;
+
+    kernel.assign(partitions * CONVOLVER_SIZE, 0.f);
+    history.assign(partitions * CONVOLVER_SIZE, 0.f);
+    next.assign(CONVOLVER_SIZE, 0.f);
+    frame.assign(CONVOLVER_SIZE, 0.f);
+    output.assign(CONVOLVER_BLOCK, 0.f);
+    bins.assign(CONVOLVER_SIZE, 0.f);
+    scratch.assign(CONVOLVER_SIZE, 0.f);
+
+    // Each partition zero padded to the FFT size. The inverse FFT isn't
+    // normalised, so its 1 / size goes in here.
+    for (int p = 0; p < partitions; p++) {
+        std::fill(scratch.begin(), scratch.end(), 0.f);
+        size_t start = (size_t) p * CONVOLVER_BLOCK;
+        for (size_t i = start; i < std::min(length, start + CONVOLVER_BLOCK); i++)
+            scratch[i - start] = impulse[i] / CONVOLVER_SIZE;
+        fft.rfft(scratch.data(), bins.data());
+        convolverSplit(bins.data(), &kernel[p * CONVOLVER_SIZE]);
+    }
+}
+
+void Convolver::reset() {
+    std::fill(history.begin(), history.end(), 0.f);
+    std::fill(next.begin(), next.end(), 0.f);
+    std::fill(frame.begin(), frame.end(), 0.f);
+    std::fill(output.begin(), output.end(), 0.f);
+    accumulated = 1;
+    position = 0;
+}
+
+float Convolver::process(float in) {
+    frame[CONVOLVER_BLOCK + position] = in;
+    float out = output[position];
+
+    // Partition k of the next block uses the input from k - 1 blocks back
+    int end = std::min(partitions, accumulated + perSample);
+    for (; accumulated < end; accumulated++) {
+        int slot = (newest + 1 - accumulated + partitions) % partitions;
+        convolverMultiplyAdd(next.data(), &kernel[accumulated * CONVOLVER_SIZE], &history[slot * CONVOLVER_SIZE]);
+    }
+
+    if (++position >= CONVOLVER_BLOCK) {
+        position = 0;
+        block();
+    }
+    return out;
+}
+
+void Convolver::block() {
+    fft.rfft(frame.data(), bins.data());
+    newest = (newest + 1) % partitions;
+    float *spectrum = &history[newest * CONVOLVER_SIZE];
+    convolverSplit(bins.data(), spectrum);
+    convolverMultiplyAdd(next.data(), &kernel[0], spectrum);
+
+    // Overlap-save: only the second half is free of wraparound
+    convolverOrder(next.data(), bins.data());
+    fft.irfft(bins.data(), scratch.data());
+    std::memcpy(output.data(), &scratch[CONVOLVER_BLOCK], CONVOLVER_BLOCK * sizeof(float));
+    std::memcpy(frame.data(), &frame[CONVOLVER_BLOCK], CONVOLVER_BLOCK * sizeof(float));
+
+    std::fill(next.begin(), next.end(), 0.f);
+    accumulated = 1;
+}
+
+
+ConvolverLoader::~ConvolverLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    condition.notify_one();
+    if (worker.joinable())
+        worker.join();
+    delete ready.exchange(nullptr);
+    delete retired.exchange(nullptr);
+}
+
+void ConvolverLoader::load(const std::string &path) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->path = path;
+        changed = true;
+        if (!running) {
+            running = true;
+            worker = std::thread(&ConvolverLoader::run, this);
+        }
+    }
+    condition.notify_one();
+}
+
+std::string ConvolverLoader::getPath() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return path;
+}
+
+void ConvolverLoader::setSampleRate(float sampleRate) {
+    this->sampleRate.store(sampleRate, std::memory_order_relaxed);
+}
+
+Convolver *ConvolverLoader::take() {
+    // Wait until the worker has freed the last one handed back
+    if (retired.load(std::memory_order_acquire))
+        return NULL;
+    return ready.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+void ConvolverLoader::retire(Convolver *convolver) {
+    retired.store(convolver, std::memory_order_release);
+}
+
+void ConvolverLoader::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        // Polling keeps the audio thread free of notify calls
+        condition.wait_for(lock, std::chrono::milliseconds(5));
+        if (changed) {
+            changed = false;
+            pending = true;
+            built = NULL;
+            slot = std::make_shared<SampleSlot>();
+            failed = false;
+            if (!path.empty())
+                SampleLoader::instance()->load(path, slot);
+        }
+        bool unload = path.empty();
+        lock.unlock();
+        delete retired.exchange(nullptr, std::memory_order_acq_rel);
+        if (pending && unload) {
+            pending = false;
+            delete ready.exchange(new Convolver(NULL, 0), std::memory_order_acq_rel);
+        }
+        else {
+            update();
+        }
+        lock.lock();
+    }
+}
+
+void ConvolverLoader::update() {
+    if (slot->failed.load()) {
+        failed = true;
+        pending = false;
+        return;
+    }
+    const SampleBuffer *buffer = slot->buffer.load(std::memory_order_acquire);
+    float rate = sampleRate.load(std::memory_order_relaxed);
+    if (!buffer || rate <= 0.f)
+        return;
+    if (!pending && buffer == built && rate == builtRate)
+        return;
+
+    pending = false;
+    built = buffer;
+    builtRate = rate;
+    // One the audio thread never took can go straight away
+    delete ready.exchange(build(buffer, rate), std::memory_order_acq_rel);
+}
+
+Convolver *ConvolverLoader::build(const SampleBuffer *buffer, float rate) {
+    // Linear resampling to the engine rate, cut at CONVOLVER_MAX_SECONDS
+    double step = (double) buffer->sampleRate / rate;
+    size_t length = std::min<size_t>(buffer->frames / step, CONVOLVER_MAX_SECONDS * rate);
+    std::vector<float> impulse(length);
+    const std::vector<float> &data = buffer->data[0];
+    double energy = 0.0;
+    for (size_t i = 0; i < length; i++) {
+        double t = i * step;
+        size_t j = (size_t) t;
+        float frac = t - j;
+        float a = data[j];
+        float b = j + 1 < buffer->frames ? data[j + 1] : 0.f;
+        impulse[i] = a + (b - a) * frac;
+        energy += impulse[i] * impulse[i];
+    }
+
+    // Unit energy, so white noise comes out at the level it went in
+    if (energy > 0.0) {
+        float gain = 1.0 / std::sqrt(energy);
+        for (float &x : impulse)
+            x *= gain;
+    }
+    return new Convolver(impulse.data(), length);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <rack.hpp>
+#include "SampleLoader.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Partition size in samples, which is also the latency
+static const int CONVOLVER_BLOCK = 128;
+// Longer impulse responses are cut here, which bounds the work per sample
+static const float CONVOLVER_MAX_SECONDS = 10.f;
+
+/*
+    Uniformly partitioned overlap-save convolution. The impulse response is
+    cut into CONVOLVER_BLOCK sample partitions and each is transformed once
+    up front. Every block of input is transformed once too and kept in a
+    frequency domain delay line, so an impulse of P partitions costs one
+    forward and one inverse FFT plus P spectrum multiply-adds per block, and
+    the latency is CONVOLVER_BLOCK samples however long the impulse is.
+
+    Only partition 0 needs the block that has just come in. The others are
+    summed a few at a time on each sample of the block before, so the work
+    per sample stays flat instead of all landing on the block boundary.
+
+    Everything is allocated by the constructor; process() never allocates.
+*/
+struct Convolver {
+    // The impulse is used as is, at the engine's sample rate
+    Convolver(const float *impulse, size_t length);
+
+    float process(float in);
+    void reset();
+
+    bool empty() const {
+        return length == 0;
+    }
+
+private:
+    rack::dsp::RealFFT fft;
+    size_t length;
+    int partitions;
+    int perSample;
+
+    // Spectra are split, CONVOLVER_BLOCK real parts then as many imaginary
+    // ones. Bin 0 keeps DC as its real part and Nyquist as its imaginary.
+    std::vector<float> kernel;
+    std::vector<float> history;
+    int newest = 0;
+
+    // Partitions 1 and up for the next block, and how many are in so far
+    std::vector<float> next;
+    int accumulated = 1;
+
+    // The last two blocks of input, the block being played out, and FFT space
+    std::vector<float> frame;
+    std::vector<float> output;
+    std::vector<float> bins;
+    std::vector<float> scratch;
+    int position = 0;
+
+    void block();
+};
+
+/*
+    Gets a Convolver ready off the audio thread. load() asks SampleLoader
+    for the file, then a worker resamples its first channel to the engine
+    rate, scales it to unit energy and builds the Convolver. The audio
+    thread collects it with take() and hands back the one it replaces with
+    retire(), so it never allocates or frees. The worker only starts on the
+    first load().
+*/
+struct ConvolverLoader {
+    ~ConvolverLoader();
+
+    // Any thread. An empty path unloads, take() then returns an empty Convolver.
+    void load(const std::string &path);
+    std::string getPath();
+
+    // Audio thread
+    void setSampleRate(float sampleRate);
+    Convolver *take();
+    void retire(Convolver *convolver);
+
+    std::atomic<bool> failed{false};
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread worker;
+    bool running = false;
+    std::string path;
+    bool changed = false;
+
+    std::atomic<float> sampleRate{0.f};
+    std::atomic<Convolver *> ready{nullptr};
+    std::atomic<Convolver *> retired{nullptr};
+
+    // Worker state
+    std::shared_ptr<SampleSlot> slot;
+    const SampleBuffer *built = NULL;
+    float builtRate = 0.f;
+    bool pending = false;
+
+    void run();
+    void update();
+    Convolver *build(const SampleBuffer *buffer, float rate);
+};
@@ -0,0 +1,463 @@
+/*
+DiskRecorder - a multitrack recorder for printing stems from a live patch.
+
+Every channel of the polyphonic input becomes a channel of one WAV file (up
+to 16), written as 24-bit or 32-bit float through stk::FileWvOut.
+
+process() never touches the disk. It only copies each frame into a
+preallocated single-producer/single-consumer ring and bumps an atomic write
+position. A worker thread wakes every few milliseconds, drains whatever has
+arrived into an StkFrames batch and hands it to FileWvOut. If the worker
+falls behind and the ring fills up, frames are dropped and counted instead of
+blocking the audio thread; the count is shown on the panel.
+*/
+
+#include "RJModules.hpp"
+#include "UI.hpp"
+#include "osdialog.h"
+#include "FileWvOut.h"
+#include <iostream>
+#include <cmath>
+#include <ctime>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+// Ring size in samples: about 1.3s of 16 channels at 48kHz, longer for fewer
+static const size_t DISKRECORDER_RING = 1 << 20;
+static const size_t DISKRECORDER_MASK = DISKRECORDER_RING - 1;
+static const unsigned int DISKRECORDER_BATCH = 4096;
+static const int DISKRECORDER_MAX_CHANNELS = 16;
+
+struct DiskRecorderRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    DiskRecorderRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+struct DiskRecorder: Module {
+    enum ParamIds {
+        LEVEL_PARAM,
+        REC_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        IN_INPUT,
+        REC_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        REC_LIGHT,
+        NUM_LIGHTS
+    };
+
+    enum States {
+        IDLE,
+        RECORDING,
+        STOPPING
+    };
+
+    // Owned by the audio thread until it publishes RECORDING, then by the
+    // worker until it publishes IDLE again
+    std::atomic<int> state{IDLE};
+    std::atomic<int> takeChannels{1};
+    std::atomic<int> takeFormat{0};
+    std::atomic<float> takeRate{44100.f};
+
+    // Audio thread -> worker
+    std::vector<float> ring;
+    std::atomic<size_t> writePos{0};
+    std::atomic<size_t> readPos{0};
+
+    // Shown on the panel
+    std::atomic<uint32_t> overruns{0};
+    std::atomic<uint32_t> recordedFrames{0};
+    std::atomic<bool> clipped{false};
+    std::atomic<bool> failed{false};
+
+    // Worker state, only touched by the worker
+    stk::FileWvOut file;
+    stk::StkFrames batch;
+    bool fileOpen = false;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool running = true;
+    // Guarded by mutex
+    std::string directory;
+
+    dsp::SchmittTrigger buttonTrigger;
+    dsp::SchmittTrigger inputTrigger;
+    dsp::ClockDivider lightDivider;
+    float blinkPhase = 0.f;
+
+    int format_index = 0;
+
+    DiskRecorder() : file(DISKRECORDER_BATCH) {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(DiskRecorder::LEVEL_PARAM, 0.0, 2.0, 1.0, "Level", " dB", -10, 20);
+        configParam(DiskRecorder::REC_PARAM, 0.0, 1.0, 0.0, "Record");
+        lightDivider.setDivision(512);
+
+        ring.resize(DISKRECORDER_RING);
+        directory = asset::user("recordings");
+        worker = std::thread(&DiskRecorder::run, this);
+    }
+
+    ~DiskRecorder() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        condition.notify_one();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    json_t *dataToJson() override {
+        json_t *rootJ = json_object();
+        json_object_set_new(rootJ, "format", json_integer(format_index));
+        std::lock_guard<std::mutex> lock(mutex);
+        json_object_set_new(rootJ, "directory", json_string(directory.c_str()));
+        return rootJ;
+    }
+
+    void dataFromJson(json_t *rootJ) override {
+        json_t *formatJ = json_object_get(rootJ, "format");
+        if (formatJ)
+            format_index = json_integer_value(formatJ);
+        json_t *directoryJ = json_object_get(rootJ, "directory");
+        if (directoryJ)
+            setDirectory(json_string_value(directoryJ));
+    }
+
+    void setDirectory(std::string path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        directory = path;
+    }
+
+    /*
+    Worker
+    */
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running) {
+            // Polling keeps the audio thread free of notify calls
+            condition.wait_for(lock, std::chrono::milliseconds(10));
+            std::string takeDirectory = directory;
+            lock.unlock();
+            drain(takeDirectory);
+            lock.lock();
+        }
+        lock.unlock();
+
+        // Removed while recording, keep what we have
+        if (state.load(std::memory_order_acquire) != IDLE) {
+            write(readPos.load(std::memory_order_relaxed), writePos.load(std::memory_order_acquire));
+            closeTake();
+        }
+    }
+
+    void drain(const std::string &takeDirectory) {
+        // Everything pushed before a STOPPING we see here is already in the ring
+        int s = state.load(std::memory_order_acquire);
+        if (s == IDLE)
+            return;
+
+        if (!fileOpen && !failed.load(std::memory_order_relaxed))
+            openTake(takeDirectory);
+
+        size_t end = writePos.load(std::memory_order_acquire);
+        write(readPos.load(std::memory_order_relaxed), end);
+
+        if (s == STOPPING) {
+            closeTake();
+            state.store(IDLE, std::memory_order_release);
+        }
+    }
+
+    void openTake(const std::string &takeDirectory) {
+        char name[64];
+        time_t now = time(NULL);
+        strftime(name, sizeof(name), "RJModules-DiskRecorder-%Y%m%d-%H%M%S.wav", localtime(&now));
+        std::string path = takeDirectory + "/" + name;
+
+        int channels = takeChannels.load(std::memory_order_relaxed);
+        stk::Stk::StkFormat format = takeFormat.load(std::memory_order_relaxed) ? stk::Stk::STK_FLOAT32 : stk::Stk::STK_SINT24;
+        try {
+            system::createDirectories(takeDirectory);
+            // Tag the file with the engine rate without touching the global STK rate
+            file.setFileRate(takeRate.load(std::memory_order_relaxed));
+            file.openFile(path, channels, stk::FileWrite::FILE_WAV, format);
+            file.resetClipStatus();
+            batch.resize(DISKRECORDER_BATCH, channels);
+            fileOpen = true;
+        }
+        catch (stk::StkError &e) {
+            std::cerr << "DiskRecorder: " << e.getMessage() << std::endl;
+            failed.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    void closeTake() {
+        if (fileOpen) {
+            file.closeFile();
+            fileOpen = false;
+        }
+    }
+
+    // Moves samples [from, to) out of the ring, in batches
+    void write(size_t from, size_t to) {
+        unsigned int channels = takeChannels.load(std::memory_order_relaxed);
+        while (from < to) {
+            size_t frames = std::min((size_t) DISKRECORDER_BATCH, (to - from) / channels);
+            if (frames == 0)
+                break;
+            if (fileOpen) {
+                if (batch.frames() != frames)
+                    batch.resize(frames, channels);
+                for (size_t i = 0; i < frames * channels; i++)
+                    batch[i] = ring[(from + i) & DISKRECORDER_MASK];
+                try {
+                    file.tick(batch);
+                }
+                catch (stk::StkError &e) {
+                    std::cerr << "DiskRecorder: " << e.getMessage() << std::endl;
+                    failed.store(true, std::memory_order_relaxed);
+                    closeTake();
+                }
+            }
+            // A failed take still drains, so the audio thread never blocks
+            from += frames * channels;
+            readPos.store(from, std::memory_order_release);
+        }
+        if (fileOpen && file.clipStatus())
+            clipped.store(true, std::memory_order_relaxed);
+    }
+
+    /*
+    Audio thread
+    */
+
+    void toggle(float sampleRate) {
+        int s = state.load(std::memory_order_acquire);
+        if (s == IDLE) {
+            takeChannels.store(clamp(inputs[IN_INPUT].getChannels(), 1, DISKRECORDER_MAX_CHANNELS), std::memory_order_relaxed);
+            takeFormat.store(format_index, std::memory_order_relaxed);
+            takeRate.store(sampleRate, std::memory_order_relaxed);
+            overruns.store(0, std::memory_order_relaxed);
+            recordedFrames.store(0, std::memory_order_relaxed);
+            clipped.store(false, std::memory_order_relaxed);
+            failed.store(false, std::memory_order_relaxed);
+            state.store(RECORDING, std::memory_order_release);
+        }
+        else if (s == RECORDING) {
+            state.store(STOPPING, std::memory_order_release);
+        }
+        // Still saving the last take, ignore
+    }
+
+    void push() {
+        int channels = takeChannels.load(std::memory_order_relaxed);
+        size_t w = writePos.load(std::memory_order_relaxed);
+        size_t r = readPos.load(std::memory_order_acquire);
+        if (DISKRECORDER_RING - (w - r) < (size_t) channels) {
+            overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+
+        // Rack's +-5V audio is full scale
+        float gain = params[LEVEL_PARAM].getValue() * 0.2f;
+        for (int c = 0; c < channels; c++)
+            ring[(w + c) & DISKRECORDER_MASK] = inputs[IN_INPUT].getVoltage(c) * gain;
+        writePos.store(w + channels, std::memory_order_release);
+        recordedFrames.store(recordedFrames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void process(const ProcessArgs& args) override {
+        bool pressed = buttonTrigger.process(params[REC_PARAM].getValue());
+        bool triggered = inputTrigger.process(inputs[REC_INPUT].getVoltage());
+        if (pressed || triggered)
+            toggle(args.sampleRate);
+
+        int s = state.load(std::memory_order_relaxed);
+        if (s == RECORDING)
+            push();
+
+        if (lightDivider.process()) {
+            // Solid while recording, blinking while the worker finishes the file
+            blinkPhase += args.sampleTime * lightDivider.getDivision() * 4.f;
+            if (blinkPhase >= 1.f)
+                blinkPhase -= 1.f;
+            float brightness = 0.f;
+            if (s == RECORDING)
+                brightness = 1.f;
+            else if (s == STOPPING)
+                brightness = blinkPhase < 0.5f ? 1.f : 0.f;
+            lights[REC_LIGHT].setBrightness(brightness);
+        }
+    }
+};
+
+/*
+Display
+*/
+
+struct DiskRecorderStatusDisplay : RJTextDisplay {
+    DiskRecorder *module = NULL;
+    int shownState = -1;
+    uint32_t shownSeconds = 0;
+    bool shownFailed = false;
+
+    DiskRecorderStatusDisplay() {
+        fontSize = 16;
+        letterSpacing = 0.5;
+        text = "READY";
+    }
+
+    bool update() override {
+        if (!module)
+            return false;
+        int s = module->state.load(std::memory_order_relaxed);
+        bool failed = module->failed.load(std::memory_order_relaxed);
+        uint32_t seconds = module->recordedFrames.load(std::memory_order_relaxed) / std::max(1.f, module->takeRate.load(std::memory_order_relaxed));
+        if (s == shownState && failed == shownFailed && (s != DiskRecorder::RECORDING || seconds == shownSeconds))
+            return false;
+
+        shownState = s;
+        shownFailed = failed;
+        shownSeconds = seconds;
+        char buffer[32];
+        if (failed)
+            snprintf(buffer, sizeof(buffer), "ERROR");
+        else if (s == DiskRecorder::RECORDING)
+            snprintf(buffer, sizeof(buffer), "REC %02u:%02u", seconds / 60, seconds % 60);
+        else if (s == DiskRecorder::STOPPING)
+            snprintf(buffer, sizeof(buffer), "SAVING");
+        else
+            snprintf(buffer, sizeof(buffer), "READY");
+        text = buffer;
+        return true;
+    }
+
+    void drawText(NVGcontext *vg) override {
+        nvgTextAlign(vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(vg, box.size.x / 2, box.size.y / 2, text.c_str(), NULL);
+    }
+};
+
+struct DiskRecorderDropsDisplay : RJTextDisplay {
+    DiskRecorder *module = NULL;
+    uint32_t shownOverruns = 0;
+    bool shownClipped = false;
+
+    DiskRecorderDropsDisplay() {
+        fontSize = 12;
+        letterSpacing = 0.5;
+        text = "DROPS 0";
+    }
+
+    bool update() override {
+        if (!module)
+            return false;
+        uint32_t overruns = module->overruns.load(std::memory_order_relaxed);
+        bool clipped = module->clipped.load(std::memory_order_relaxed);
+        if (overruns == shownOverruns && clipped == shownClipped)
+            return false;
+
+        shownOverruns = overruns;
+        shownClipped = clipped;
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "DROPS %u%s", overruns, clipped ? " CLIP" : "");
+        text = buffer;
+        return true;
+    }
+
+    void drawText(NVGcontext *vg) override {
+        nvgTextAlign(vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(vg, box.size.x / 2, box.size.y / 2, text.c_str(), NULL);
+    }
+};
+
+
+struct DiskRecorderWidget: ModuleWidget {
+    DiskRecorderWidget(DiskRecorder *module);
+    void appendContextMenu(Menu *menu) override;
+};
+
+DiskRecorderWidget::DiskRecorderWidget(DiskRecorder *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/DiskRecorder.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    {
+        DiskRecorderStatusDisplay *display = new DiskRecorderStatusDisplay();
+        display->box.pos = Vec(10, 45);
+        display->box.size = Vec(130, 30);
+        display->module = module;
+        addChild(display);
+    }
+    {
+        DiskRecorderDropsDisplay *display = new DiskRecorderDropsDisplay();
+        display->box.pos = Vec(10, 85);
+        display->box.size = Vec(130, 24);
+        display->module = module;
+        addChild(display);
+    }
+
+    addParam(createParam<DiskRecorderRoundLargeBlackKnob>(Vec(47, 140), module, DiskRecorder::LEVEL_PARAM));
+    addParam(createParam<LEDButton>(Vec(61, 230), module, DiskRecorder::REC_PARAM));
+    addChild(createLight<MediumLight<RedLight>>(Vec(65.4, 234.4), module, DiskRecorder::REC_LIGHT));
+
+    addInput(createInput<PJ301MPort>(Vec(30, 320), module, DiskRecorder::IN_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(95, 320), module, DiskRecorder::REC_INPUT));
+}
+
+void DiskRecorderWidget::appendContextMenu(Menu *menu) {
+    DiskRecorder *module = dynamic_cast<DiskRecorder *>(this->module);
+
+    struct DirectoryItem : MenuItem
+    {
+        DiskRecorder *module;
+        void onAction(const event::Action &e) override
+        {
+            char *path = osdialog_file(OSDIALOG_OPEN_DIR, NULL, NULL, NULL);
+            if (path) {
+                module->setDirectory(path);
+                free(path);
+            }
+        }
+    };
+
+    menu->addChild(new MenuEntry);
+
+    RJChoiceItem *formatItem = createMenuItem<RJChoiceItem>("Format", ">");
+    formatItem->target = &module->format_index;
+    formatItem->labels = {"24-bit WAV", "32-bit float WAV"};
+    menu->addChild(formatItem);
+
+    DirectoryItem *directoryItem = createMenuItem<DirectoryItem>("Recording folder...");
+    directoryItem->module = module;
+    menu->addChild(directoryItem);
+}
+
+Model *modelDiskRecorder = createModel<DiskRecorder, DiskRecorderWidget>("DiskRecorder");
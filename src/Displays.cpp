@@ -1,4 +1,5 @@
 #include "RJModules.hpp"
+#include "UI.hpp"
 
 #include "common.hpp"
 #include <iostream>
@@ -39,37 +40,11 @@ struct Displays: Module {
     void step() override;
 };
 
-struct NumberDisplayWidgeter : TransparentWidget {
-  float *value;
-
-
-  void draw(NVGcontext *vg) override
-  {
-    // Background
-    NVGcolor backgroundColor = nvgRGB(0xC0, 0xC0, 0xC0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
-    nvgFillColor(vg, backgroundColor);
-    nvgFill(vg);
-
-    // text
-    std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, "res/Segment7Standard.ttf"));
-    if (font) {
-    nvgFontSize(vg, 32);
-    nvgFontFaceId(vg, font->handle);
-    nvgTextLetterSpacing(vg, 2.5);
-    }
-    std::stringstream to_display;
-    to_display = format4display(*value);
-
-    Vec textPos = Vec(16.0f, 33.0f);
-    NVGcolor textColor = nvgRGB(0x00, 0x00, 0x00);
-    nvgFillColor(vg, textColor);
-    nvgText(vg, textPos.x, textPos.y, to_display.str().c_str(), NULL);
-
-    nvgFontSize(vg, 16);
-    textPos = Vec(1.0f, (*value<0?20.0f:30.0f));
-    nvgText(vg, textPos.x, textPos.y, (*value<0?"-":"+"), NULL);
+struct NumberDisplayWidgeter : RJNumberDisplay {
+  NumberDisplayWidgeter() {
+    fontSize = 32;
+    letterSpacing = 2.5;
+    textPos = Vec(16.0f, 33.0f);
   }
 };
 
@@ -2,33 +2,29 @@
 DRUMPLER
 
 It's got drums!
+
+Three one-shot sample players. Each one has sixteen voices, so a poly
+trigger cable can fire sixteen hits at once, and every voice reads
+straight out of the shared, immutable buffers the SampleLoader decoded.
 */
 
 #include "RJModules.hpp"
+#include "UI.hpp"
 
 #include <iostream>
 
-#include "Oscillator.hpp"
+#include "SampleLoader.hpp"
 
 #include <math.h>
-#include "dr_wav.h"
 #include <vector>
 #include "cmath"
-#include <dirent.h>
 #include <algorithm> //----added by Joakim Lindbom
-#include <locale> // for wstring_convert
-#if defined ARCH_WIN
-#include <codecvt>
-#endif
 #include <iostream>
 #include <cmath>
 #include <sstream>
 #include <iomanip>
-#include <unistd.h>
-#include <mutex>
 
-using deesp::DSPBLOscillator;
-#define pi 3.14159265359
+using simd::float_4;
 
 using namespace std;
 
@@ -43,12 +39,6 @@ struct DrumplerRoundLargeBlackKnob : RoundLargeBlackKnob {
     }
 };
 
-struct DrumplerRoundLargeHappyKnob : RoundLargeBlackKnob {
-    DrumplerRoundLargeHappyKnob() {
-        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/DrumplerRoundLargeHappyKnob.svg")));
-    }
-};
-
 struct DrumplerRoundLargeBlackSnapKnob : DrumplerRoundLargeBlackKnob
 {
     DrumplerRoundLargeBlackSnapKnob()
@@ -70,78 +60,140 @@ struct TrigButton : SvgSwitch {
 Display
 */
 
-struct DrumplerSmallStringDisplayWidget : TransparentWidget {
-  std::string *value;
-
-  void draw(NVGcontext *vg) override
-  {
-    // Background
-    NVGcolor backgroundColor = nvgRGB(0xC0, 0xC0, 0xC0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
-    nvgFillColor(vg, backgroundColor);
-    nvgFill(vg);
-
-    // text
-    std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, "res/Pokemon.ttf"));
-    if (font) {
-    nvgFontSize(vg, 16);
-    nvgFontFaceId(vg, font->handle);
-    nvgTextLetterSpacing(vg, 0.5);
-    }
-
-    std::stringstream to_display;
-    to_display << std::setw(3) << *value;
-
-    Vec textPos = Vec(8.0f, 16.0f);
-    NVGcolor textColor = nvgRGB(0x00, 0x00, 0x00);
-    nvgFillColor(vg, textColor);
-    nvgText(vg, textPos.x, textPos.y, to_display.str().c_str(), NULL);
+struct DrumplerSmallStringDisplayWidget : RJValueDisplay<const char *> {
+  DrumplerSmallStringDisplayWidget() {
+    fontSize = 16;
+    letterSpacing = 0.5;
+    textPos = Vec(8.0f, 16.0f);
   }
 };
 
 
-
 /*
-    Static Functions and Structions
+    The kit
 */
 
-static float shapeDelta(float delta, float tau, float shape) {
-    float lin = sgn(delta) * 10.0 / tau;
-    if (shape < 0.0) {
-        float log = sgn(delta) * 40.0 / tau / (fabsf(delta) + 1.0);
-        return crossfade(lin, log, -shape * 0.95);
+static const int DRUMPLER_SAMPLERS = 3;
+static const int DRUMPLER_VOICES = 16;
+static const int DRUMPLER_MAX_LAYERS = 3;
+
+// Layers with the same minimum velocity take turns, one per hit,
+// otherwise the loudest layer the hit is strong enough for wins
+struct DrumplerInstrument {
+    const char *name;
+    int count;
+    const char *files[DRUMPLER_MAX_LAYERS];
+    const char *labels[DRUMPLER_MAX_LAYERS];
+    float minVelocity[DRUMPLER_MAX_LAYERS];
+};
+
+// The STK drum rawwaves we already ship
+static const DrumplerInstrument DRUMPLER_KIT[] = {
+    {"Kick", 1, {"rawwaves/bassdrum.raw"}, {"Bass"}, {0.f}},
+    {"Snare", 1, {"rawwaves/snardrum.raw"}, {"Snare"}, {0.f}},
+    {"Hat", 1, {"rawwaves/hihatcym.raw"}, {"Closed"}, {0.f}},
+    {"Cymbal", 2, {"rawwaves/ridecymb.raw", "rawwaves/crashcym.raw"}, {"Ride", "Crash"}, {0.f, 0.7f}},
+    // A tom fill: there is one take of each tom, so taking turns walks down the kit
+    {"Fill", 3, {"rawwaves/tomhidrm.raw", "rawwaves/tommiddr.raw", "rawwaves/tomlowdr.raw"}, {"High", "Mid", "Low"}, {0.f, 0.f, 0.f}},
+    {"Perc", 2, {"rawwaves/cowbell1.raw", "rawwaves/tambourn.raw"}, {"Bell", "Tamb"}, {0.f, 0.f}},
+};
+static const int DRUMPLER_KIT_SIZE = sizeof(DRUMPLER_KIT) / sizeof(DRUMPLER_KIT[0]);
+
+static int drumplerPickLayer(const DrumplerInstrument &instrument, float velocity, int &turn) {
+    float band = 0.f;
+    for (int i = 0; i < instrument.count; i++) {
+        if (instrument.minVelocity[i] <= velocity)
+            band = std::max(band, instrument.minVelocity[i]);
     }
-    else {
-        float exp = M_E * delta / tau;
-        return crossfade(lin, exp, shape * 0.90);
+    int candidates[DRUMPLER_MAX_LAYERS];
+    int n = 0;
+    for (int i = 0; i < instrument.count; i++) {
+        if (instrument.minVelocity[i] == band)
+            candidates[n++] = i;
     }
+    return candidates[turn++ % n];
 }
 
-struct DrumplerMultiFilter
-{
-    float q;
-    float freq;
-    float smpRate;
-    float hp = 0.0f,bp = 0.0f,lp = 0.0f,mem1 = 0.0f,mem2 = 0.0f;
-
-    void setParams(float freq, float q, float smpRate) {
-        this->freq = freq;
-        this->q=q;
-        this->smpRate=smpRate;
+/*
+    Voices
+*/
+
+// One-shot voices, voice v lives in lane v % 4 of group v / 4
+struct DrumplerVoices {
+    const float *data[DRUMPLER_VOICES] = {};
+    float_4 pos[4];
+    float_4 inc[4];
+    float_4 end[4];
+    float_4 env[4];
+    float_4 gain[4];
+    int active = 0;
+
+    DrumplerVoices() {
+        for (int g = 0; g < 4; g++) {
+            pos[g] = 0.f;
+            inc[g] = 0.f;
+            end[g] = 0.f;
+            env[g] = 0.f;
+            gain[g] = 0.f;
+        }
     }
 
-    void calcOutput(float sample)
-    {
-        float g = tan(pi*freq/smpRate);
-        float R = 1.0f/(2.0f*q);
-        hp = (sample - (2.0f*R + g)*mem1 - mem2)/(1.0f + 2.0f*R*g + g*g);
-        bp = g*hp + mem1;
-        lp = g*bp +  mem2;
-        mem1 = g*hp + bp;
-        mem2 = g*bp + lp;
+    void start(const SampleBuffer *buffer, float rate, float level) {
+        if (buffer->frames < 2)
+            return;
+
+        // Take a free voice, otherwise steal the quietest one
+        int v = -1;
+        float quietest = INFINITY;
+        for (int i = 0; i < DRUMPLER_VOICES; i++) {
+            if (!(active & (1 << i))) {
+                v = i;
+                break;
+            }
+            float loudness = env[i / 4][i % 4] * gain[i / 4][i % 4];
+            if (loudness < quietest) {
+                quietest = loudness;
+                v = i;
+            }
+        }
+
+        int g = v / 4;
+        int l = v % 4;
+        data[v] = buffer->data[0].data();
+        pos[g][l] = 0.f;
+        inc[g][l] = rate;
+        end[g][l] = buffer->frames - 1;
+        env[g][l] = 1.f;
+        gain[g][l] = level;
+        active |= 1 << v;
     }
 
+    float process(float decay) {
+        float_4 sum = 0.f;
+        for (int g = 0; g < 4; g++) {
+            int lanes = (active >> (4 * g)) & 0xF;
+            if (!lanes)
+                continue;
+
+            // Linear interpolation, the reads are the only per-lane part
+            float x[4] = {};
+            for (int l = 0; l < 4; l++) {
+                if (lanes & (1 << l)) {
+                    const float *d = data[4 * g + l];
+                    float p = pos[g][l];
+                    int i = (int) p;
+                    x[l] = d[i] + (d[i + 1] - d[i]) * (p - i);
+                }
+            }
+            sum += float_4::load(x) * env[g] * gain[g];
+
+            pos[g] += inc[g];
+            env[g] *= decay;
+            int done = simd::movemask((pos[g] >= end[g]) | (env[g] < 1e-4f));
+            active &= ~(done << (4 * g));
+        }
+        return sum[0] + sum[1] + sum[2] + sum[3];
+    }
 };
 
 /*
@@ -149,215 +201,129 @@ struct DrumplerMultiFilter
 */
 struct Drumpler : Module {
     enum ParamIds {
-
-        // Wave
-        WAVE_1_PARAM,
-        WAVE_2_PARAM,
-        WAVE_MIX_PARAM,
-
-        // Env
-        ENV_REL_PARAM,
-        ENV_SHAPE_PARAM,
-        ENV_AMT_PARAM,
-
-        // Filter
-        FILTER_CUT_PARAM,
-        FILTER_FM_1_PARAM,
-        FILTER_FM_2_PARAM,
-        FILTER_Q_PARAM,
-        FILTER_DRIVE_PARAM,
-
-        // Pluck
-        PLUCK_ATTACK_PARAM,
-        PLUCK_REL_PARAM,
-        PLUCK_EXP_PARAM,
-
-        // Folder
-        FOLD_PARAM,
+        ENUMS(SOUND_PARAM, DRUMPLER_SAMPLERS),
+        ENUMS(TUNE_PARAM, DRUMPLER_SAMPLERS),
+        ENUMS(DECAY_PARAM, DRUMPLER_SAMPLERS),
+        ENUMS(LEVEL_PARAM, DRUMPLER_SAMPLERS),
 
         // Buttons
-        TRIG0_BUTTON,
+        ENUMS(TRIG_BUTTON, DRUMPLER_SAMPLERS),
 
         NUM_PARAMS
     };
     enum InputIds {
-        VOCT_INPUT,
-        VOCT2_INPUT,
-        TRIG_INPUT,
-
-        // Wave
-        WAVE_1_INPUT,
-        WAVE_2_INPUT,
-        WAVE_MIX_INPUT,
-
-        // Env
-        ENV_REL_INPUT,
-        ENV_SHAPE_INPUT,
-        ENV_AMT_INPUT,
-
-        // Filter
-        FILTER_CUT_INPUT,
-        FILTER_FM_1_INPUT,
-        FILTER_FM_2_INPUT,
-        FILTER_Q_INPUT,
-        FILTER_DRIVE_INPUT,
-
-        // Pluck
-        PLUCK_REL_INPUT,
-        PLUCK_EXP_INPUT,
-
-        // Trigger
-        TRIG0_INPUT,
-
-        EXP_INPUT,
-        FOLD_INPUT,
+        ENUMS(TRIG_INPUT, DRUMPLER_SAMPLERS),
+        ENUMS(VEL_INPUT, DRUMPLER_SAMPLERS),
+        ENUMS(SOUND_INPUT, DRUMPLER_SAMPLERS),
+        ENUMS(TUNE_INPUT, DRUMPLER_SAMPLERS),
+        ENUMS(DECAY_INPUT, DRUMPLER_SAMPLERS),
         NUM_INPUTS
     };
     enum OutputIds {
-        OUT_OUTPUT,
-        ENV_OUTPUT,
+        ENUMS(OUT_OUTPUT, DRUMPLER_SAMPLERS),
+        MIX_OUTPUT,
         NUM_OUTPUTS
     };
     enum LightIds {
-        ATTACK_LIGHT,
-        DECAY_LIGHT,
-        SUSTAIN_LIGHT,
-        RELEASE_LIGHT,
         NUM_LIGHTS
     };
 
-    // Wave
-    DSPBLOscillator *osc1 = new DSPBLOscillator(APP->engine->getSampleRate());
-    DSPBLOscillator *osc2 = new DSPBLOscillator(APP->engine->getSampleRate());
-
-    // Sample
-    unsigned int channels;
-    unsigned int sampleRate;
-    drwav_uint64 totalSampleCount;
-    vector<vector<float>> playBuffer;
-    bool loading = false;
-    bool play = false;
-    std::string lastPath = "";
-    float samplePos = 0;
-    float startPos = 0;
-    std::string fileDesc;
-    bool fileLoaded = false;
-    vector <std::string> fichier;
-    int sampnumber = 0;
-    int retard = 0;
-    bool reload = false ;
-    bool oscState = false ;
-    vector<double> displayBuff; // unused
-
-    std::string bank0 = "Kick";
-    std::string sample0 = "House";
-
-    // Env
-    dsp::SchmittTrigger env_trigger;
-    float env_out = 0.0f;
-    float env_gate = 0.0f;
-    float env_in = 0.0f;
-
-    // VCA
-    float vca_out;
-    float vca_last;
-
-    // Filter
-    DrumplerMultiFilter filter;
+    // Every layer of the kit, preloaded and shared with every other Drumpler
+    std::shared_ptr<SampleSlot> samples[DRUMPLER_KIT_SIZE][DRUMPLER_MAX_LAYERS];
+
+    DrumplerVoices voices[DRUMPLER_SAMPLERS];
+    dsp::SchmittTrigger triggers[DRUMPLER_SAMPLERS][DRUMPLER_VOICES];
+    dsp::SchmittTrigger buttons[DRUMPLER_SAMPLERS];
+    dsp::ClockDivider paramDivider;
+
+    int instrument[DRUMPLER_SAMPLERS] = {};
+    int turn[DRUMPLER_SAMPLERS] = {};
+    float rate[DRUMPLER_SAMPLERS] = {};
+    float decay[DRUMPLER_SAMPLERS] = {};
+    float level[DRUMPLER_SAMPLERS] = {};
+
+    // Displays
+    const char *bankNames[DRUMPLER_SAMPLERS];
+    const char *sampleNames[DRUMPLER_SAMPLERS];
 
     Drumpler() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
-        playBuffer.resize(2);
-        playBuffer[0].resize(0);
-        playBuffer[1].resize(0);
-
-        configParam(Drumpler::FOLD_PARAM, 1.f, 50.f, 25.f, "");
-        configParam(Drumpler::WAVE_1_PARAM, 0.0, 5.0, 0.0, "");
-        configParam(Drumpler::WAVE_2_PARAM, 0.0, 4.0, 0.0, "");
-        configParam(Drumpler::WAVE_MIX_PARAM, 0.0, 1.0f, 0.0f, "");
-        configParam(Drumpler::ENV_REL_PARAM, 0.0, 1.0, 0.0, "");
-        configParam(Drumpler::ENV_AMT_PARAM, 0.0, 1.0, 1.0, "");
-        configParam(Drumpler::ENV_SHAPE_PARAM, -1.0, 1.0, 0.0, "");
-        configParam(Drumpler::FILTER_CUT_PARAM, 0.0, 1.0f, 0.90f, "");
-        configParam(Drumpler::FILTER_FM_1_PARAM, -1.0, 1.0f, 0.0f, "");
-        configParam(Drumpler::FILTER_Q_PARAM, 0.1f, 1.5f, 0.3f, "");
-        configParam(Drumpler::FILTER_FM_2_PARAM, -1.0, 1.0f, 0.0f, "");
-        configParam(Drumpler::FILTER_DRIVE_PARAM, -5.0f, 5.0f, 1.0f, "");
-        configParam(Drumpler::PLUCK_REL_PARAM, 0.2f, 0.4f, 0.2f, "");
-        configParam(Drumpler::PLUCK_EXP_PARAM, 0.0001f, .1f, 4.0f, "");
-        configParam(Drumpler::PLUCK_ATTACK_PARAM, 0.0, 1.0f, 0.90f, "");
 
+        for (int r = 0; r < DRUMPLER_SAMPLERS; r++) {
+            configParam(Drumpler::SOUND_PARAM + r, 0.0, DRUMPLER_KIT_SIZE - 1, r, "Sound");
+            configParam(Drumpler::TUNE_PARAM + r, -2.0, 2.0, 0.0, "Tune", " octaves");
+            configParam(Drumpler::DECAY_PARAM + r, 0.0, 1.0, 1.0, "Decay");
+            configParam(Drumpler::LEVEL_PARAM + r, 0.0, 1.0, 0.8, "Level");
+            configParam(Drumpler::TRIG_BUTTON + r, 0.0, 1.0, 0.0, "Trigger");
+            instrument[r] = r;
+            bankNames[r] = DRUMPLER_KIT[r].name;
+            sampleNames[r] = DRUMPLER_KIT[r].labels[0];
+        }
+        paramDivider.setDivision(32);
+
+        for (int i = 0; i < DRUMPLER_KIT_SIZE; i++) {
+            for (int l = 0; l < DRUMPLER_KIT[i].count; l++) {
+                samples[i][l] = std::make_shared<SampleSlot>();
+                SampleLoader::instance()->load(asset::plugin(pluginInstance, DRUMPLER_KIT[i].files[l]), samples[i][l]);
+            }
+        }
+        updateParams(APP->engine->getSampleTime());
     }
 
-    void step() override {
+    void updateParams(float sampleTime) {
+        for (int r = 0; r < DRUMPLER_SAMPLERS; r++) {
+            // 1V per sound
+            int sound = (int) roundf(params[SOUND_PARAM + r].getValue() + inputs[SOUND_INPUT + r].getVoltage());
+            instrument[r] = clamp(sound, 0, DRUMPLER_KIT_SIZE - 1);
+            bankNames[r] = DRUMPLER_KIT[instrument[r]].name;
 
-    }
+            // 1V/Oct, relative to the sample's own rate
+            rate[r] = sampleTime * dsp::approxExp2_taylor5(params[TUNE_PARAM + r].getValue() + inputs[TUNE_INPUT + r].getVoltage());
 
-    void loadSample(std::string path) {
-        //from cF PLAYER.CPP
+            // 20ms to 10s to fall by 1/e, all the way up lets the sample ring out
+            float amount = clamp(params[DECAY_PARAM + r].getValue() + inputs[DECAY_INPUT + r].getVoltage() / 10.f, 0.f, 1.f);
+            float time = 0.02f * dsp::approxExp2_taylor5(amount * 9.f);
+            decay[r] = amount >= 1.f ? 1.f : expf(-sampleTime / time);
 
-        loading = true;
-        unsigned int c;
-        unsigned int sr;
-        drwav_uint64 sc;
-        float* pSampleData;
-        pSampleData = drwav_open_and_read_file_f32(path.c_str(), &c, &sr, &sc);
+            level[r] = params[LEVEL_PARAM + r].getValue();
+        }
+    }
 
-        if (pSampleData != NULL) {
-            channels = c;
-            sampleRate = sr;
-            playBuffer[0].clear();
-            playBuffer[1].clear();
+    void hit(int r, float velocity) {
+        const DrumplerInstrument &kit = DRUMPLER_KIT[instrument[r]];
+        int layer = drumplerPickLayer(kit, velocity, turn[r]);
+        const SampleBuffer *buffer = samples[instrument[r]][layer]->buffer.load(std::memory_order_acquire);
+        if (!buffer)
+            return;
+        sampleNames[r] = kit.labels[layer];
+        voices[r].start(buffer, buffer->sampleRate * rate[r], level[r] * velocity);
+    }
 
-            for (unsigned int i=0; i < sc; i = i + c) {
-                playBuffer[0].push_back(pSampleData[i]);
-                if (channels == 2)
-                    playBuffer[1].push_back((float)pSampleData[i+1]);
+    void process(const ProcessArgs &args) override {
+        if (paramDivider.process()) {
+            updateParams(args.sampleTime);
+        }
 
-            }
-            totalSampleCount = playBuffer[0].size();
-            drwav_free(pSampleData);
-            loading = false;
-            fileLoaded = true;
-            vector<double>().swap(displayBuff);
-            for (int i=0; i < floor(totalSampleCount); i = i + floor(totalSampleCount/130)) {
-                displayBuff.push_back(playBuffer[0][i]);
-            }
-            fileDesc = "\n";
-            if (reload) {
-                DIR* rep = NULL;
-                struct dirent* dirp = NULL;
-                std::string dir = path.empty() ? rack::system::getDirectory(lastPath) : "";
-
-                rep = opendir(dir.c_str());
-                int i = 0;
-                fichier.clear();
-                while ((dirp = readdir(rep)) != NULL) {
-                    std::string name = dirp->d_name;
-
-                    std::size_t found = name.find(".wav",name.length()-5);
-                    if (found==std::string::npos) found = name.find(".WAV",name.length()-5);
-                    if (found!=std::string::npos) {
-                        fichier.push_back(name);
-                        if ((dir + "/" + name)==path) {sampnumber = i;}
-                        i=i+1;
-                        }
-
-                    }
-            sort(fichier.begin(), fichier.end());  // Linux needs this to get files in right order
-                for (int o=0;o<int(fichier.size()-1); o++) {
-                    if ((dir + "/" + fichier[o])==path) {
-                        sampnumber = o;
-                    }
+        float mix = 0.f;
+        for (int r = 0; r < DRUMPLER_SAMPLERS; r++) {
+            // Every channel of the trigger cable is its own hit
+            int channels = inputs[TRIG_INPUT + r].getChannels();
+            bool velocityConnected = inputs[VEL_INPUT + r].isConnected();
+            for (int c = 0; c < channels; c++) {
+                if (triggers[r][c].process(inputs[TRIG_INPUT + r].getVoltage(c))) {
+                    float velocity = velocityConnected ? clamp(inputs[VEL_INPUT + r].getPolyVoltage(c) / 10.f, 0.f, 1.f) : 1.f;
+                    hit(r, velocity);
                 }
-                closedir(rep);
-                reload = false;
             }
-                lastPath = path;
-        }
-        else {
-            fileLoaded = false;
+            if (buttons[r].process(params[TRIG_BUTTON + r].getValue())) {
+                hit(r, 1.f);
+            }
+
+            float out = voices[r].process(decay[r]) * 5.f;
+            outputs[OUT_OUTPUT + r].setVoltage(out);
+            mix += out;
         }
+        outputs[MIX_OUTPUT].setVoltage(mix);
     }
 };
 
@@ -372,247 +338,60 @@ struct DrumplerWidget : ModuleWidget {
         addChild(createWidget<ScrewSilver>(Vec(15, 365)));
         addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
 
-        int TOP_BUFFER = 30;
-        int BOTTOM_OFFSET = 45;
-        int LEFT_BUFFER = 35;
-        int RIGHT_BUFFER = 50;
-
-        int CV_SIZE = 2;
-        int CV_DIST = 15;
-        int CV_NEG_DIST = 10;
-
-        int DISPLAY_SIZE_X = 60;
-        int DISPLAY_SIZE_Y = 25;
-        int ROW_OFFSET = 35;
-        int BANK_OFFSET = 30;
-        int BUTTON_SIZE = 5;
-        int KNOB_SIZE = 35;
-        int NEG_ROW = -5;
-        int NEG_ROW_CV = -2.5;
-
-        int GROUP_OFFSET = 15 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE;
-        int SAMPLER_BUFFER = 120;
-
-        /*
-            Row 0
-        */
-
-        // Button / CV
-        addInput(createInput<PJ301MPort>(Vec(7, TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-        addParam(createParam<TrigButton>(Vec(7, TOP_BUFFER + BANK_OFFSET), module, Drumpler::TRIG0_BUTTON));
-
-        // Displays
-        if(module != NULL){
-            DrumplerSmallStringDisplayWidget *bankDisplay0 = new DrumplerSmallStringDisplayWidget();
-            bankDisplay0->box.pos = Vec(LEFT_BUFFER, TOP_BUFFER);
-            bankDisplay0->box.size = Vec(DISPLAY_SIZE_X, DISPLAY_SIZE_Y);
-            bankDisplay0->value = &module->bank0;
-            addChild(bankDisplay0);
-
-            DrumplerSmallStringDisplayWidget *sampleDisplay0 = new DrumplerSmallStringDisplayWidget();
-            sampleDisplay0->box.pos = Vec(LEFT_BUFFER, TOP_BUFFER + BANK_OFFSET);
-            sampleDisplay0->box.size = Vec(DISPLAY_SIZE_X, DISPLAY_SIZE_Y);
-            sampleDisplay0->value = &module->sample0;
-            addChild(sampleDisplay0);
-        }
-
-        // Row 1
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X, TOP_BUFFER + NEG_ROW), module, Drumpler::WAVE_1_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X, TOP_BUFFER + NEG_ROW), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X, TOP_BUFFER + NEG_ROW), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-
-        // Row 2
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X, TOP_BUFFER + NEG_ROW + ROW_OFFSET), module, Drumpler::WAVE_1_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X, TOP_BUFFER + NEG_ROW + ROW_OFFSET), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X, TOP_BUFFER + NEG_ROW + ROW_OFFSET), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        // Row 3
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X, TOP_BUFFER + NEG_ROW + ROW_OFFSET + ROW_OFFSET), module, Drumpler::WAVE_1_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X, TOP_BUFFER + NEG_ROW + ROW_OFFSET+ ROW_OFFSET), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X, TOP_BUFFER + NEG_ROW + ROW_OFFSET + ROW_OFFSET), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-
-        /*
-            Row 1
-        */
-
-        // Button / CV
-        addInput(createInput<PJ301MPort>(Vec(7, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-        addParam(createParam<TrigButton>(Vec(7, SAMPLER_BUFFER + TOP_BUFFER + BANK_OFFSET), module, Drumpler::TRIG0_BUTTON));
-
-        // Displays
-        if(module != NULL){
-            DrumplerSmallStringDisplayWidget *bankDisplay0 = new DrumplerSmallStringDisplayWidget();
-            bankDisplay0->box.pos = Vec(LEFT_BUFFER, SAMPLER_BUFFER + TOP_BUFFER);
-            bankDisplay0->box.size = Vec(DISPLAY_SIZE_X, DISPLAY_SIZE_Y);
-            bankDisplay0->value = &module->bank0;
-            addChild(bankDisplay0);
-
-            DrumplerSmallStringDisplayWidget *sampleDisplay0 = new DrumplerSmallStringDisplayWidget();
-            sampleDisplay0->box.pos = Vec(LEFT_BUFFER, SAMPLER_BUFFER + TOP_BUFFER + BANK_OFFSET);
-            sampleDisplay0->box.size = Vec(DISPLAY_SIZE_X, DISPLAY_SIZE_Y);
-            sampleDisplay0->value = &module->sample0;
-            addChild(sampleDisplay0);
-        }
-
-        // Row 1
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW), module, Drumpler::WAVE_1_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-
-        // Row 2
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW + ROW_OFFSET), module, Drumpler::WAVE_1_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW + ROW_OFFSET), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW + ROW_OFFSET), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        // Row 3
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW + ROW_OFFSET + ROW_OFFSET), module, Drumpler::WAVE_1_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW + ROW_OFFSET+ ROW_OFFSET), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
+        int TOP_BUFFER = 45;
+        int LEFT_BUFFER = 5;
+
+        int DISPLAY_SIZE_X = 110;
+        int DISPLAY_SIZE_Y = 23;
+        int BANK_OFFSET = 25;
+        // Knobs along the top of each sampler, with their jacks under them
+        int KNOB_LEFT = 127;
+        int KNOB_SPACING = 45;
+        int KNOB_ROW = 14;
+        int JACK_ROW = 62;
+        int JACK_SPACING = 29;
+
+        int SAMPLER_BUFFER = 100;
+
+        for (int r = 0; r < DRUMPLER_SAMPLERS; r++) {
+            int y = TOP_BUFFER + r * SAMPLER_BUFFER;
+
+            // Displays
+            if(module != NULL){
+                DrumplerSmallStringDisplayWidget *bankDisplay = new DrumplerSmallStringDisplayWidget();
+                bankDisplay->box.pos = Vec(LEFT_BUFFER, y - 2);
+                bankDisplay->box.size = Vec(DISPLAY_SIZE_X, DISPLAY_SIZE_Y);
+                bankDisplay->value = &module->bankNames[r];
+                addChild(bankDisplay);
+
+                DrumplerSmallStringDisplayWidget *sampleDisplay = new DrumplerSmallStringDisplayWidget();
+                sampleDisplay->box.pos = Vec(LEFT_BUFFER, y - 2 + BANK_OFFSET);
+                sampleDisplay->box.size = Vec(DISPLAY_SIZE_X, DISPLAY_SIZE_Y);
+                sampleDisplay->value = &module->sampleNames[r];
+                addChild(sampleDisplay);
+            }
 
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW + ROW_OFFSET + ROW_OFFSET), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
+            // Trigger, button, out
+            addInput(createInput<PJ301MPort>(Vec(LEFT_BUFFER, y + JACK_ROW), module, Drumpler::TRIG_INPUT + r));
+            addParam(createParam<TrigButton>(Vec(LEFT_BUFFER + JACK_SPACING, y + JACK_ROW), module, Drumpler::TRIG_BUTTON + r));
+            addOutput(createOutput<PJ301MPort>(Vec(LEFT_BUFFER + 2 * JACK_SPACING, y + JACK_ROW), module, Drumpler::OUT_OUTPUT + r));
 
-        /*
-            Row 2
-        */
+            // Sound, tune, decay, level / velocity
+            addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(KNOB_LEFT, y + KNOB_ROW), module, Drumpler::SOUND_PARAM + r));
+            addInput(createInput<PJ301MPort>(Vec(KNOB_LEFT + 2, y + JACK_ROW), module, Drumpler::SOUND_INPUT + r));
 
-        // Button / CV
-        addInput(createInput<PJ301MPort>(Vec(7, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-        addParam(createParam<TrigButton>(Vec(7, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + BANK_OFFSET), module, Drumpler::TRIG0_BUTTON));
+            addParam(createParam<DrumplerRoundLargeBlackKnob>(Vec(KNOB_LEFT + KNOB_SPACING, y + KNOB_ROW), module, Drumpler::TUNE_PARAM + r));
+            addInput(createInput<PJ301MPort>(Vec(KNOB_LEFT + KNOB_SPACING + 2, y + JACK_ROW), module, Drumpler::TUNE_INPUT + r));
 
-        // Displays
-        if(module != NULL){
-            DrumplerSmallStringDisplayWidget *bankDisplay0 = new DrumplerSmallStringDisplayWidget();
-            bankDisplay0->box.pos = Vec(LEFT_BUFFER, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER);
-            bankDisplay0->box.size = Vec(DISPLAY_SIZE_X, DISPLAY_SIZE_Y);
-            bankDisplay0->value = &module->bank0;
-            addChild(bankDisplay0);
+            addParam(createParam<DrumplerRoundLargeBlackKnob>(Vec(KNOB_LEFT + 2 * KNOB_SPACING, y + KNOB_ROW), module, Drumpler::DECAY_PARAM + r));
+            addInput(createInput<PJ301MPort>(Vec(KNOB_LEFT + 2 * KNOB_SPACING + 2, y + JACK_ROW), module, Drumpler::DECAY_INPUT + r));
 
-            DrumplerSmallStringDisplayWidget *sampleDisplay0 = new DrumplerSmallStringDisplayWidget();
-            sampleDisplay0->box.pos = Vec(LEFT_BUFFER, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + BANK_OFFSET);
-            sampleDisplay0->box.size = Vec(DISPLAY_SIZE_X, DISPLAY_SIZE_Y);
-            sampleDisplay0->value = &module->sample0;
-            addChild(sampleDisplay0);
+            addParam(createParam<DrumplerRoundLargeBlackKnob>(Vec(KNOB_LEFT + 3 * KNOB_SPACING, y + KNOB_ROW), module, Drumpler::LEVEL_PARAM + r));
+            addInput(createInput<PJ301MPort>(Vec(KNOB_LEFT + 3 * KNOB_SPACING + 2, y + JACK_ROW), module, Drumpler::VEL_INPUT + r));
         }
 
-        // Row 1
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW), module, Drumpler::WAVE_1_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-
-        // Row 2
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW + ROW_OFFSET), module, Drumpler::WAVE_1_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW + ROW_OFFSET), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW + ROW_OFFSET), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        // Row 3
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW + ROW_OFFSET + ROW_OFFSET), module, Drumpler::WAVE_1_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(5 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW + ROW_OFFSET+ ROW_OFFSET), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(70 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-        addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW + ROW_OFFSET + ROW_OFFSET), module, Drumpler::WAVE_2_PARAM));
-        addInput(createInput<PJ301MPort>(Vec(135 + LEFT_BUFFER + DISPLAY_SIZE_X + KNOB_SIZE, SAMPLER_BUFFER + SAMPLER_BUFFER + TOP_BUFFER + NEG_ROW_CV + ROW_OFFSET + ROW_OFFSET), module, Drumpler::TRIG0_INPUT));
-
-
-
-        // addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(GROUP_OFFSET + GROUP_OFFSET, TOP_BUFFER + NEG_ROW), module, Drumpler::WAVE_1_PARAM));
-        // addInput(createInput<PJ301MPort>(Vec(GROUP_OFFSET + GROUP_OFFSET, TOP_BUFFER + NEG_ROW_CV), module, Drumpler::TRIG0_INPUT));
-
-
-        // Wave
-        // addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(Vec(5 + LEFT_BUFFER, 20 + TOP_BUFFER), module, Drumpler::WAVE_1_PARAM));
-        // addParam(createParam<DrumplerRoundLargeBlackSnapKnob>(mm2px(Vec(30 + LEFT_BUFFER, 20 + TOP_BUFFER)), module, Drumpler::WAVE_2_PARAM));
-        // addParam(createParam<DrumplerRoundLargeBlackKnob>(mm2px(Vec(17.5 + LEFT_BUFFER, 35 + TOP_BUFFER)), module, Drumpler::WAVE_MIX_PARAM));
-
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(5 + LEFT_BUFFER + CV_SIZE, 20 + TOP_BUFFER + CV_DIST)), module, Drumpler::WAVE_1_INPUT));
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(30 + LEFT_BUFFER+ CV_SIZE, 20 + TOP_BUFFER + CV_DIST)), module, Drumpler::WAVE_2_INPUT));
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(17.5 + LEFT_BUFFER + CV_SIZE, 35 + TOP_BUFFER + CV_DIST)), module, Drumpler::WAVE_MIX_INPUT));
-
-        // // Envelope
-        // addParam(createParam<DrumplerRoundLargeBlackKnob>(mm2px(Vec(5 + LEFT_BUFFER, 20 + BOTTOM_OFFSET + TOP_BUFFER)), module, Drumpler::ENV_REL_PARAM));
-        // addParam(createParam<DrumplerRoundLargeBlackKnob>(mm2px(Vec(30 + LEFT_BUFFER, 20 + BOTTOM_OFFSET + TOP_BUFFER)), module, Drumpler::ENV_AMT_PARAM));
-        // addParam(createParam<DrumplerRoundLargeBlackKnob>(mm2px(Vec(17.5 + LEFT_BUFFER, 35 + BOTTOM_OFFSET + TOP_BUFFER)), module, Drumpler::ENV_SHAPE_PARAM));
-
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(5 + LEFT_BUFFER + CV_SIZE, 20 + TOP_BUFFER + BOTTOM_OFFSET + CV_DIST)), module, Drumpler::ENV_REL_INPUT));
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(30 + LEFT_BUFFER+ CV_SIZE, 20 + TOP_BUFFER + BOTTOM_OFFSET + CV_DIST)), module, Drumpler::ENV_AMT_INPUT));
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(17.5 + LEFT_BUFFER + CV_SIZE, 35 + TOP_BUFFER + BOTTOM_OFFSET + CV_DIST)), module, Drumpler::ENV_SHAPE_INPUT));
-
-        // /*
-        //     Right Side
-        // */
-
-        // // Filter
-        // addParam(createParam<DrumplerRoundLargeBlackKnob>(mm2px(Vec(17.5 + LEFT_BUFFER + RIGHT_BUFFER, 20 + TOP_BUFFER)), module, Drumpler::FILTER_CUT_PARAM));
-        // addParam(createParam<DrumplerRoundLargeBlackKnob>(mm2px(Vec(5 + LEFT_BUFFER + RIGHT_BUFFER, 35 + TOP_BUFFER)), module, Drumpler::FILTER_FM_1_PARAM));
-        // addParam(createParam<DrumplerRoundLargeBlackKnob>(mm2px(Vec(30 + LEFT_BUFFER + RIGHT_BUFFER, 35 + TOP_BUFFER)), module, Drumpler::FILTER_Q_PARAM));
-        // addParam(createParam<DrumplerRoundLargeBlackKnob>(mm2px(Vec(5 + LEFT_BUFFER + RIGHT_BUFFER, 50 + TOP_BUFFER)), module, Drumpler::FILTER_FM_2_PARAM));
-        // addParam(createParam<DrumplerRoundLargeBlackKnob>(mm2px(Vec(30 + LEFT_BUFFER + RIGHT_BUFFER, 50 + TOP_BUFFER)), module, Drumpler::FILTER_DRIVE_PARAM));
-
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(17.5 + LEFT_BUFFER + RIGHT_BUFFER + CV_SIZE, 20 + TOP_BUFFER + CV_DIST)), module, Drumpler::FILTER_CUT_INPUT));
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(5 + LEFT_BUFFER + RIGHT_BUFFER + CV_SIZE, 35 + TOP_BUFFER - CV_NEG_DIST)), module, Drumpler::FILTER_FM_1_INPUT));
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(30 + LEFT_BUFFER + RIGHT_BUFFER + CV_SIZE, 35 + TOP_BUFFER - CV_NEG_DIST)), module, Drumpler::FILTER_Q_INPUT));
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(5 + LEFT_BUFFER + RIGHT_BUFFER + CV_SIZE, 50 + TOP_BUFFER + CV_DIST)), module, Drumpler::FILTER_FM_2_INPUT));
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(30 + LEFT_BUFFER + RIGHT_BUFFER + CV_SIZE, 50 + TOP_BUFFER + CV_DIST)), module, Drumpler::FILTER_DRIVE_INPUT));
-
-
-        // // Pluck
-        // addParam(createParam<DrumplerRoundLargeBlackKnob>(mm2px(Vec(5 + LEFT_BUFFER + RIGHT_BUFFER, 35 + BOTTOM_OFFSET + TOP_BUFFER)), module, Drumpler::PLUCK_REL_PARAM));
-        // addParam(createParam<DrumplerRoundLargeBlackKnob>(mm2px(Vec(30 + LEFT_BUFFER + RIGHT_BUFFER, 35 + BOTTOM_OFFSET + TOP_BUFFER)), module, Drumpler::PLUCK_EXP_PARAM));
-        // // addParam(createParam<DrumplerRoundLargeBlackKnob>(mm2px(Vec(17.5 + LEFT_BUFFER + RIGHT_BUFFER, 20 + BOTTOM_OFFSET + TOP_BUFFER)), module, Drumpler::PLUCK_ATTACK_PARAM));
-
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(5 + LEFT_BUFFER + RIGHT_BUFFER + CV_SIZE, 35 + TOP_BUFFER + BOTTOM_OFFSET + CV_DIST)), module, Drumpler::PLUCK_REL_INPUT));
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(30 + LEFT_BUFFER + RIGHT_BUFFER + CV_SIZE, 35 + TOP_BUFFER + BOTTOM_OFFSET + CV_DIST)), module, Drumpler::PLUCK_EXP_INPUT));
-
-        /*
-            Bottom
-        */
-        // float OUTLINE = 117.5f;
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(5 + LEFT_BUFFER + CV_SIZE, OUTLINE)), module, Drumpler::VOCT_INPUT));
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(17.5 + LEFT_BUFFER + CV_SIZE, OUTLINE)), module, Drumpler::VOCT2_INPUT));
-        // addInput(createInput<PJ301MPort>(mm2px(Vec(30 + LEFT_BUFFER + CV_SIZE, OUTLINE)), module, Drumpler::TRIG_INPUT));
-
-        // addOutput(createOutput<PJ301MPort>(mm2px(Vec(17.5 + LEFT_BUFFER + RIGHT_BUFFER + CV_SIZE, OUTLINE)), module, Drumpler::ENV_OUTPUT));
-        // addOutput(createOutput<PJ301MPort>(mm2px(Vec(30 + LEFT_BUFFER + RIGHT_BUFFER + CV_SIZE, OUTLINE)), module, Drumpler::OUT_OUTPUT));
+        // In the last sampler's free slot
+        addOutput(createOutput<PJ301MPort>(Vec(LEFT_BUFFER + 3 * JACK_SPACING, TOP_BUFFER + 2 * SAMPLER_BUFFER + JACK_ROW), module, Drumpler::MIX_OUTPUT));
     }
 };
 
@@ -1,4 +1,5 @@
 #include "RJModules.hpp"
+#include "UI.hpp"
 #include "osdialog.h"
 #include "common.hpp"
 #include <locale> // for wstring_convert
@@ -27,32 +28,11 @@ std::string soundfont_files[2] = {
 Display
 */
 
-struct EssEffSmallStringDisplayWidget : TransparentWidget {
-  std::string *value;
-  void draw(NVGcontext *vg) override
-  {
-    // Background
-    NVGcolor backgroundColor = nvgRGB(0xC0, 0xC0, 0xC0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
-    nvgFillColor(vg, backgroundColor);
-    nvgFill(vg);
-
-    // text
-    std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, "res/Pokemon.ttf"));
-    if (font) {
-    nvgFontSize(vg, 20);
-    nvgFontFaceId(vg, font->handle);
-    nvgTextLetterSpacing(vg, 0.4);
-    }
-
-    std::stringstream to_display;
-    to_display << std::setw(3) << *value;
-
-    Vec textPos = Vec(12.0f, 28.0f);
-    NVGcolor textColor = nvgRGB(0x00, 0x00, 0x00);
-    nvgFillColor(vg, textColor);
-    nvgText(vg, textPos.x, textPos.y, to_display.str().c_str(), NULL);
+struct EssEffSmallStringDisplayWidget : RJStringDisplay {
+  EssEffSmallStringDisplayWidget() {
+    fontSize = 20;
+    letterSpacing = 0.4;
+    textPos = Vec(12.0f, 28.0f);
   }
 };
 
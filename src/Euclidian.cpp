@@ -5,6 +5,7 @@ The fun is here: http://cgm.cs.mcgill.ca/~godfried/publications/banff.pdf
 */
 
 #include "RJModules.hpp"
+#include "UI.hpp"
 #include "common.hpp"
 #include <iostream>
 #include <cmath>
@@ -12,10 +13,114 @@ The fun is here: http://cgm.cs.mcgill.ca/~godfried/publications/banff.pdf
 #include <iomanip>
 #include <unistd.h>
 #include <mutex>
+#include <bitset>
 
 using namespace std;
 #define HISTORY_SIZE (1<<21)
 
+/*
+Patterns
+*/
+
+// N_PARAM max times J_PARAM max
+static const int EUCLIDIAN_MAX_BASE = 128;
+static const int EUCLIDIAN_MAX_STEPS = 128 * 15;
+static const int EUCLIDIAN_TRACKS = 16;
+
+typedef std::bitset<EUCLIDIAN_MAX_BASE> EuclidianBase;
+
+struct EuclidianPattern {
+    std::bitset<EUCLIDIAN_MAX_STEPS> steps;
+    int length = 0;
+    int K = -1;
+    int N = -1;
+    int I = -1;
+    int J = -1;
+};
+
+// From https://bitbucket.org/sjcastroe/bjorklunds-algorithm/src/master/
+// The same pairing as the string version, but with each string held as
+// (bits, length) so concatenation is a shift and an or, and nothing allocates.
+static EuclidianBase euclidianBjorklund(int beats, int steps, int *length)
+{
+    //We can only have as many beats as we have steps (0 <= beats <= steps)
+    if (beats > steps)
+        beats = steps;
+
+    //X will hold the "dominant" pair (the pair that there are more of)
+    EuclidianBase x;
+    x.set(0);
+    int x_length = 1;
+    int x_amount = beats;
+
+    EuclidianBase y;
+    int y_length = 1;
+    int y_amount = steps - beats;
+
+    do
+    {
+        int x_temp = x_amount;
+        int y_temp = y_amount;
+        EuclidianBase y_copy = y;
+        int y_copy_length = y_length;
+
+        //Check which is the dominant pair
+        if (x_temp >= y_temp)
+        {
+            x_amount = y_temp;
+            y_amount = x_temp - y_temp;
+
+            //The previous dominant pair becomes the new non dominant pair
+            y = x;
+            y_length = x_length;
+        }
+        else
+        {
+            x_amount = x_temp;
+            y_amount = y_temp - x_temp;
+        }
+
+        //Create the new dominant pair by combining the previous pairs
+        x |= y_copy << x_length;
+        x_length += y_copy_length;
+    } while (x_amount > 1 && y_amount > 1);
+
+    EuclidianBase rhythm;
+    int pos = 0;
+    for (int i = 1; i <= x_amount && pos < EUCLIDIAN_MAX_BASE; i++) {
+        rhythm |= x << pos;
+        pos += x_length;
+    }
+    for (int i = 1; i <= y_amount && pos < EUCLIDIAN_MAX_BASE; i++) {
+        rhythm |= y << pos;
+        pos += y_length;
+    }
+    *length = std::min(pos, EUCLIDIAN_MAX_BASE);
+    return rhythm;
+}
+
+// Bjorklund, then rotate left by I, then repeat every step J times
+static void euclidianBuild(EuclidianPattern &pattern, int K, int N, int I, int J)
+{
+    int length;
+    EuclidianBase rhythm = euclidianBjorklund(K, N, &length);
+
+    int rotation = (I < length) ? I : 0;
+    pattern.steps.reset();
+    for (int i = 0; i < length; i++) {
+        if (rhythm[(i + rotation) % length]) {
+            for (int j = 0; j < J; j++) {
+                pattern.steps.set(i * J + j);
+            }
+        }
+    }
+    pattern.length = length * J;
+    pattern.K = K;
+    pattern.N = N;
+    pattern.I = I;
+    pattern.J = J;
+}
+
 /*
 Module
 */
@@ -31,6 +136,8 @@ struct Euclidian : Module {
     enum InputIds {
         CLOCK_INPUT,
         RESET_INPUT,
+        K_INPUT,
+        I_INPUT,
         NUM_INPUTS
     };
     enum OutputIds {
@@ -50,11 +157,8 @@ struct Euclidian : Module {
     int head = -1;
     dsp::SchmittTrigger clockTrigger;
     dsp::SchmittTrigger resetTrigger;
-    int old_K;
-    int old_J;
-    int old_I;
-    int old_N;
-    std::string old_final_string;
+    // One pattern per poly track, rebuilt only when its K, N, I or J changes
+    EuclidianPattern patterns[EUCLIDIAN_TRACKS];
 
     json_t *dataToJson() override {
         json_t *rootJ = json_object();
@@ -72,76 +176,6 @@ struct Euclidian : Module {
         configParam(Euclidian::J_PARAM, 1, 15, 1, "j");
     }
 
-    // From https://bitbucket.org/sjcastroe/bjorklunds-algorithm/src/master/
-    std::string bjorklund(int beats, int steps)
-    {
-        //We can only have as many beats as we have steps (0 <= beats <= steps)
-        if (beats > steps)
-            beats = steps;
-
-        //Each iteration is a process of pairing strings X and Y and the remainder from the pairings
-        //X will hold the "dominant" pair (the pair that there are more of)
-        std::string x = "1";
-        int x_amount = beats;
-
-        std::string y = "0";
-        int y_amount = steps - beats;
-
-        do
-        {
-            //Placeholder variables
-            int x_temp = x_amount;
-            int y_temp = y_amount;
-            std::string y_copy = y;
-
-            //Check which is the dominant pair
-            if (x_temp >= y_temp)
-            {
-                //Set the new number of pairs for X and Y
-                x_amount = y_temp;
-                y_amount = x_temp - y_temp;
-
-                //The previous dominant pair becomes the new non dominant pair
-                y = x;
-            }
-            else
-            {
-                x_amount = x_temp;
-                y_amount = y_temp - x_temp;
-            }
-
-            //Create the new dominant pair by combining the previous pairs
-            x = x + y_copy;
-        } while (x_amount > 1 && y_amount > 1);//iterate as long as the non dominant pair can be paired (if there is 1 Y left, all we can do is pair it with however many Xs are left, so we're done)
-
-        //By this point, we have strings X and Y formed through a series of pairings of the initial strings "1" and "0"
-        //X is the final dominant pair and Y is the second to last dominant pair
-        std::string rhythm;
-        for (int i = 1; i <= x_amount; i++)
-            rhythm += x;
-        for (int i = 1; i <= y_amount; i++)
-            rhythm += y;
-        return rhythm;
-    }
-
-    void rotate(std::string &a, int d){
-        if(d>=a.length()){
-            return;
-        }
-        std::rotate(a.begin(), a.begin() + d, a.end());
-    }
-
-    void multiply(std::string &s, int d)
-    {
-        std::string new_s = "";
-        for(char& c : s) {
-            for(int i=0; i<d; i++){
-                new_s = new_s + c;
-            }
-        }
-        s = new_s;
-    }
-
     void process(const ProcessArgs &args) override {
 
         int K = (int)params[K_PARAM].getValue();
@@ -151,43 +185,45 @@ struct Euclidian : Module {
 
         k_display = K;
         n_display = N;
-        std::string final_string;
-
-        if( (old_K == K) && (old_J == J) && (old_I == I) && (old_N == N) ){
-            final_string = old_final_string;
-        } else{
-            std::string bork = bjorklund(K, N);
-            rotate(bork, I);
-            multiply(bork, J);
-            final_string = bork;
+
+        // Poly K and I CVs (1V per step) give one rhythm per channel
+        int tracks = std::max(1, std::max(inputs[K_INPUT].getChannels(), inputs[I_INPUT].getChannels()));
+        for (int t = 0; t < tracks; t++) {
+            int trackK = K;
+            int trackI = I;
+            if (inputs[K_INPUT].isConnected())
+                trackK = clamp(K + (int)roundf(inputs[K_INPUT].getPolyVoltage(t)), 0, EUCLIDIAN_MAX_BASE);
+            if (inputs[I_INPUT].isConnected())
+                trackI = clamp(I + (int)roundf(inputs[I_INPUT].getPolyVoltage(t)), 0, EUCLIDIAN_MAX_BASE);
+
+            EuclidianPattern &pattern = patterns[t];
+            if( (pattern.K != trackK) || (pattern.J != J) || (pattern.I != trackI) || (pattern.N != N) ){
+                euclidianBuild(pattern, trackK, N, trackI, J);
+            }
         }
 
-        old_final_string = final_string;
-        old_K = K;
-        old_N = N;
-        old_I = I;
-        old_J = J;
+        // Every track shares N and J, so they share a length and a head
+        const EuclidianPattern &first = patterns[0];
 
         if (resetTrigger.process(inputs[RESET_INPUT].value)) {
             head = -1;
         }
 
-        if (clockTrigger.process(inputs[CLOCK_INPUT].value)) {
-            if (head >= final_string.length() -1){
+        bool clocked = clockTrigger.process(inputs[CLOCK_INPUT].value);
+        if (clocked) {
+            if (head >= first.length - 1){
                 head = -1;
             }
             head += 1;
-            if(final_string[head] == "1"[0]){
-                outputs[OUTPUT].value = 12.0f;
-            } else{
-                outputs[OUTPUT].value = 0.0f;
-            }
-        } else{
-            outputs[OUTPUT].value = 0.0f;
         }
+        for (int t = 0; t < tracks; t++) {
+            bool hit = clocked && patterns[t].steps[head];
+            outputs[OUTPUT].setVoltage(hit ? 12.0f : 0.0f, t);
+        }
+        outputs[OUTPUT].setChannels(tracks);
 
         for(int li=0;li<16;li++){
-            if(li>final_string.length()){
+            if(li>first.length){
                 lights[PATTERN_LIGHT + li].setBrightness(0);
                 continue;
             }
@@ -196,7 +232,7 @@ struct Euclidian : Module {
                 continue;
             }
 
-            if(final_string[li] == "1"[0]){
+            if(first.steps[li]){
                 lights[PATTERN_LIGHT + li].setBrightness(.5);
             } else{
                 lights[PATTERN_LIGHT + li].setBrightness(0);
@@ -204,7 +240,7 @@ struct Euclidian : Module {
         }
 
         if((head<16)&&(head>=0)){
-            if(final_string[head] == "1"[0]){
+            if(first.steps[head]){
                 lights[PATTERN_LIGHT + head].setBrightness(1.0f);
             } else{
                 lights[PATTERN_LIGHT + head].setBrightness(0.75f);
@@ -225,49 +261,12 @@ struct EuclidianLight : BASE {
 Display
 */
 
-struct EuclidianSmallStringDisplayWidget : TransparentWidget {
-  Euclidian *module;
-  bool is_left = true;
-
-  void draw(NVGcontext *vg) override
-  {
-
-    // Shadow
-    NVGcolor backgroundColorS = nvgRGB(0xA0, 0xA0, 0xA0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y + 2.0, 4.0);
-    nvgFillColor(vg, backgroundColorS);
-    nvgFill(vg);
-
-    // Background
-    NVGcolor backgroundColor = nvgRGB(0xC0, 0xC0, 0xC0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
-    nvgFillColor(vg, backgroundColor);
-    nvgFill(vg);
-
-    // text
-    std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, "res/Pokemon.ttf"));
-    if (font) {
-    nvgFontSize(vg, 20);
-    nvgFontFaceId(vg, font->handle);
-    nvgTextLetterSpacing(vg, 0.4);
-  }
-
-    if (!module)
-        return;
-
-    std::stringstream to_display;
-    if(is_left){
-        to_display << std::setw(3) << std::to_string(module->k_display);
-    } else{
-        to_display << std::setw(3) << std::to_string(module->n_display);
-    }
-
-    Vec textPos = Vec(6.0f, 24.0f);
-    NVGcolor textColor = nvgRGB(0x00, 0x00, 0x00);
-    nvgFillColor(vg, textColor);
-    nvgText(vg, textPos.x, textPos.y, to_display.str().c_str(), NULL);
+struct EuclidianSmallStringDisplayWidget : RJIntegerDisplay {
+  EuclidianSmallStringDisplayWidget() {
+    shadow = true;
+    fontSize = 20;
+    letterSpacing = 0.4;
+    textPos = Vec(6.0f, 24.0f);
   }
 };
 
@@ -323,15 +322,14 @@ struct EuclidianWidget : ModuleWidget {
         EuclidianSmallStringDisplayWidget *k_Display = new EuclidianSmallStringDisplayWidget();
         k_Display->box.pos = Vec(45, 48);
         k_Display->box.size = Vec(35, 35);
-        k_Display->module = module;
+        k_Display->value = &module->k_display;
         addChild(k_Display);
     }
     if(module != NULL){
         EuclidianSmallStringDisplayWidget *n_Display = new EuclidianSmallStringDisplayWidget();
         n_Display->box.pos = Vec(100, 48);
         n_Display->box.size = Vec(35, 35);
-        n_Display->module = module;
-        n_Display->is_left = false;
+        n_Display->value = &module->n_display;
         addChild(n_Display);
     }
 
@@ -345,8 +343,10 @@ struct EuclidianWidget : ModuleWidget {
     addParam(createParam<EuclidianRoundLargeBlackSnapKnob>(Vec(LEFT + RIGHT, BASE), module, Euclidian::N_PARAM));
     addParam(createParam<EuclidianRoundLargeBlackSnapKnob>(Vec(LEFT, BASE + DIST), module, Euclidian::I_PARAM));
     addParam(createParam<EuclidianRoundLargeBlackSnapKnob>(Vec(LEFT + RIGHT, BASE + DIST), module, Euclidian::J_PARAM));
-    addInput(createInput<PJ301MPort>(Vec(11, 320), module, Euclidian::CLOCK_INPUT));
-    addInput(createInput<PJ301MPort>(Vec(45, 320), module, Euclidian::RESET_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(4.5, 320), module, Euclidian::CLOCK_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(33.5, 320), module, Euclidian::RESET_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(62.5, 320), module, Euclidian::K_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(91.5, 320), module, Euclidian::I_INPUT));
 
     for(int j=0;j<8;j++){
         addChild(createLight<EuclidianLight<WhiteLight>>(Vec(j * 16 + 15, 265), module, Euclidian::PATTERN_LIGHT + j));
@@ -355,7 +355,7 @@ struct EuclidianWidget : ModuleWidget {
         addChild(createLight<EuclidianLight<WhiteLight>>(Vec(k * 16 + 15, 285), module, Euclidian::PATTERN_LIGHT + (k + 8)));
     }
 
-    addOutput(createOutput<PJ301MPort>(Vec(112.5, 320), module, Euclidian::OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(120.5, 320), module, Euclidian::OUTPUT));
 
     }
 
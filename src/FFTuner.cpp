@@ -1,300 +1,374 @@
-// #include "RJModules.hpp"
-// #include "dsp/samplerate.hpp"
-// #include "dsp/ringbuffer.hpp"
-// #include <iostream>
-// #include <cmath>
-// #include <math.h>
-// #include <signal.h>
-// #include "libfft.h"
-
-// /* -- some basic parameters -- */
-// #define SAMPLE_RATE (41000)
-// #define FFT_SIZE (8192)
-// #define FFT_EXP_SIZE (13)
-// #define NUM_SECONDS (20)
-// #define HISTORY_SIZE (1<<21)
-
-// /* -- functions declared and used here -- */
-// void buildHammingWindow( float *window, int size );
-// void buildHanWindow( float *window, int size );
-// void applyWindow( float *window, float *data, int size );
-// //a must be of length 2, and b must be of length 3
-// void computeSecondOrderLowPassParameters( float srate, float f, float *a, float *b );
-// //mem must be of length 4.
-// float processSecondOrderFilter( float x, float *mem, float *a, float *b );
-// void signalHandler( int signum ) ;
-
-// static bool running = true;
-// static char * NOTES[] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
-
-// void buildHammingWindow( float *window, int size )
-// {
-//    for( int i=0; i<size; ++i )
-//       window[i] = .54 - .46 * cos( 2 * M_PI * i / (float) size );
-// }
-// void buildHanWindow( float *window, int size )
-// {
-//    for( int i=0; i<size; ++i )
-//       window[i] = .5 * ( 1 - cos( 2 * M_PI * i / (size-1.0) ) );
-// }
-// void applyWindow( float *window, float *data, int size )
-// {
-//    for( int i=0; i<size; ++i )
-//       data[i] *= window[i] ;
-// }
-// void computeSecondOrderLowPassParameters( float srate, float f, float *a, float *b )
-// {
-//    float a0;
-//    float w0 = 2 * M_PI * f/srate;
-//    float cosw0 = cos(w0);
-//    float sinw0 = sin(w0);
-//    //float alpha = sinw0/2;
-//    float alpha = sinw0/2 * sqrt(2);
-
-//    a0   = 1 + alpha;
-//    a[0] = (-2*cosw0) / a0;
-//    a[1] = (1 - alpha) / a0;
-//    b[0] = ((1-cosw0)/2) / a0;
-//    b[1] = ( 1-cosw0) / a0;
-//    b[2] = b[0];
-// }
-// float processSecondOrderFilter( float x, float *mem, float *a, float *b )
-// {
-//     float ret = b[0] * x + b[1] * mem[0] + b[2] * mem[1]
-//                          - a[0] * mem[2] - a[1] * mem[3] ;
-
-//         mem[1] = mem[0];
-//         mem[0] = x;
-//         mem[3] = mem[2];
-//         mem[2] = ret;
-
-//         return ret;
-// }
-
-// struct FFTuner: Module {
-//     enum ParamIds {
-//         CH1_PARAM,
-//         NUM_PARAMS
-//     };
-//     enum InputIds {
-//         CH1_INPUT,
-//         NUM_INPUTS
-//     };
-//     enum OutputIds {
-//         CH1_OUTPUT,
-//         NUM_OUTPUTS
-//     };
-
-
-//     dsp::DoubleRingBuffer<float, HISTORY_SIZE> historyBuffer;
-//     dsp::DoubleRingBuffer<float, 16> outBuffer;
-//     dsp::SampleRateConverter<1> src;
-
-//     FFTuner() {
-		// config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS);}
-//     void step() override;
-// };
-
-// void FFTuner::step() {
-
-//     float in = inputs[CH1_INPUT].value;
-//     if (!historyBuffer.full()) {
-//         historyBuffer.push(in);
-//     }
-//     // How many samples do we need consume to catch up?
-//     float consume = index - historyBuffer.size();
-//     if (outBuffer.empty()) {
-//         double ratio = 1.0;
-//         if (consume <= -16)
-//             ratio = 0.5;
-//         else if (consume >= 16)
-//             ratio = 2.0;
-
-//         int inFrames = mini(historyBuffer.size(), 16);
-//         int outFrames = outBuffer.capacity();
-//         src.setRatioSmooth(ratio);
-//         src.process((const dsp::Frame<1>*)historyBuffer.startData(), &inFrames, (dsp::Frame<1>*)outBuffer.endData(), &outFrames);
-//         historyBuffer.startIncr(inFrames);
-//         outBuffer.endIncr(outFrames);
-//     }
-
-//     float wet = 0.0;
-//     if (!outBuffer.empty()) {
-//         wet = outBuffer.shift();
-//     }
-
-//    float a[2], b[3], mem1[4], mem2[4];
-//    float data[FFT_SIZE];
-//    float datai[FFT_SIZE];
-//    float window[FFT_SIZE];
-//    float freqTable[FFT_SIZE];
-//    char * noteNameTable[FFT_SIZE];
-//    float notePitchTable[FFT_SIZE];
-//    void * fft = NULL;
-
-//    // build the window, fft, etc
-//     /*
-//        buildHanWindow( window, 30 );
-//        for( int i=0; i<30; ++i ) {
-//           for( int j=0; j<window[i]*50; ++j )
-//              printf( "*" );
-//           printf("\n");
-//        }
-//        exit(0);
-//     */
-//    buildHanWindow( window, FFT_SIZE );
-//    fft = initfft( FFT_EXP_SIZE );
-//    computeSecondOrderLowPassParameters( SAMPLE_RATE, 330, a, b );
-//    mem1[0] = 0; mem1[1] = 0; mem1[2] = 0; mem1[3] = 0;
-//    mem2[0] = 0; mem2[1] = 0; mem2[2] = 0; mem2[3] = 0;
-
-//    //freq/note tables
-//    for( int i=0; i<FFT_SIZE; ++i ) {
-//       freqTable[i] = ( SAMPLE_RATE * i ) / (float) ( FFT_SIZE );
-//    }
-
-//    for( int i=0; i<FFT_SIZE; ++i ) {
-//       noteNameTable[i] = NULL;
-//       notePitchTable[i] = -1;
-//    }
-
-//    for( int i=0; i<127; ++i ) {
-//       float pitch = ( 440.0 / 32.0 ) * pow( 2, (i-9.0)/12.0 ) ;
-//       if( pitch > SAMPLE_RATE / 2.0 )
-//          break;
-//       //find the closest frequency using brute force.
-//       float min = 1000000000.0;
-//       int index = -1;
-//       for( int j=0; j<FFT_SIZE; ++j ) {
-//          if( fabsf( freqTable[j]-pitch ) < min ) {
-//              min = fabsf( freqTable[j]-pitch );
-//              index = j;
-//          }
-//       }
-//       noteNameTable[index] = NOTES[i%12];
-//       notePitchTable[index] = pitch;
-//       //printf( "%f %d %s\n", pitch, index, noteNameTable[index] );
-//    }
-
-
-//    while( running )
-//    {
-//       // read some data
-//       // err = Pa_ReadStream( stream, data, FFT_SIZE );
-//       // if( err ) goto error; //FIXME: we don't want to err on xrun
-
-//       data *= outBuffer;
-
-//       // low-pass
-//       //for( int i=0; i<FFT_SIZE; ++i )
-//       //   printf( "in %f\n", data[i] );
-//       for( int j=0; j<FFT_SIZE; ++j ) {
-//          data[j] = processSecondOrderFilter( data[j], mem1, a, b );
-//          data[j] = processSecondOrderFilter( data[j], mem2, a, b );
-//       }
-//       // window
-//       applyWindow( window, data, FFT_SIZE );
-
-//       // do the fft
-//       for( int j=0; j<FFT_SIZE; ++j )
-//          datai[j] = 0;
-//       applyfft( fft, data, datai, false );
-
-//       //find the peak
-//       float maxVal = -1;
-//       int maxIndex = -1;
-//       for( int j=0; j<FFT_SIZE/2; ++j ) {
-//          float v = data[j] * data[j] + datai[j] * datai[j] ;
-// /*
-//          printf( "%d: ", j*SAMPLE_RATE/(2*FFT_SIZE) );
-//          for( int i=0; i<sqrt(v)*100000000; ++i )
-//             printf( "*" );
-//          printf( "\n" );
-// */
-//          if( v > maxVal ) {
-//             maxVal = v;
-//             maxIndex = j;
-//          }
-//       }
-//       float freq = freqTable[maxIndex];
-//       //find the nearest note:
-//       int nearestNoteDelta=0;
-//       while( true ) {
-//          if( nearestNoteDelta < maxIndex && noteNameTable[maxIndex-nearestNoteDelta] != NULL ) {
-//             nearestNoteDelta = -nearestNoteDelta;
-//             break;
-//          } else if( nearestNoteDelta + maxIndex < FFT_SIZE && noteNameTable[maxIndex+nearestNoteDelta] != NULL ) {
-//             break;
-//          }
-//          ++nearestNoteDelta;
-//       }
-//       char * nearestNoteName = noteNameTable[maxIndex+nearestNoteDelta];
-//       float nearestNotePitch = notePitchTable[maxIndex+nearestNoteDelta];
-//       float centsSharp = 1200 * log( freq / nearestNotePitch ) / log( 2.0 );
-
-//       // now output the results:
-//       printf("\033[2J\033[1;1H"); //clear screen, go to top left
-//       fflush(stdout);
-
-//       printf( "Tuner listening. Control-C to exit.\n" );
-//       printf( "%f Hz, %d : %f\n", freq, maxIndex, maxVal*1000 );
-//       printf( "Nearest Note: %s\n", nearestNoteName );
-//       if( nearestNoteDelta != 0 ) {
-//          if( centsSharp > 0 )
-//             printf( "%f cents sharp.\n", centsSharp );
-//          if( centsSharp < 0 )
-//             printf( "%f cents flat.\n", -centsSharp );
-//       } else {
-//          printf( "in tune!\n" );
-//       }
-//       printf( "\n" );
-//       int chars = 30;
-//       if( nearestNoteDelta == 0 || centsSharp >= 0 ) {
-//          for( int i=0; i<chars; ++i )
-//             printf( " " );
-//       } else {
-//          for( int i=0; i<chars+centsSharp; ++i )
-//             printf( " " );
-//          for( int i=chars+centsSharp<0?0:chars+centsSharp; i<chars; ++i )
-//             printf( "=" );
-//       }
-//       printf( " %2s ", nearestNoteName );
-//       if( nearestNoteDelta != 0 )
-//          for( int i=0; i<chars && i<centsSharp; ++i )
-//            printf( "=" );
-//       printf("\n");
-//    }
-
-
-
-
-
-//     // passthrough
-//     outputs[CH1_OUTPUT].value = inputs[CH1_INPUT].value;
-// }
-
-
-
-
-// FFTunerWidget::FFTunerWidget(FFTuner *module) {
-		// setModule(module);
-//     box.size = Vec(15*10, 380);
-
-//     {
-//         SVGPanel *panel = new SVGPanel();
-//         panel->box.size = box.size;
-//         panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/FFTuner.svg")));
-//         addChild(panel);
-//     }
-
-//     addChild(createWidget<ScrewSilver>(Vec(15, 0)));
-//     addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
-//     addChild(createWidget<ScrewSilver>(Vec(15, 365)));
-//     addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
-
-//     addParam(createParam<RoundBlackKnob>(Vec(57, 79), module, FFTuner::CH1_PARAM, 0.0, 1.0, 0.5));
-//     addInput(createInput<PJ301MPort>(Vec(22, 100), module, FFTuner::CH1_INPUT));
-//     addOutput(createOutput<PJ301MPort>(Vec(110, 85), module, FFTuner::CH1_OUTPUT));
-// }
-
-
+/*
+FFTuner - a tuner and spectrum analyzer.
+
+The audio thread only pushes samples into a lock-free ring. A worker thread
+drains the ring into a history buffer and, every FFTUNER_HOP samples, runs a
+Hann windowed real FFT (Rack's pffft based dsp::RealFFT) over the last
+FFTUNER_SIZE samples. The strongest peak is checked for a fundamental below
+it, refined with parabolic interpolation and published through atomics, so
+process() never waits on the analysis.
+*/
+
+#include "RJModules.hpp"
+#include "UI.hpp"
+#include <iostream>
+#include <cmath>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+static const int FFTUNER_SIZE = 8192;
+static const int FFTUNER_HOP = 2048;
+static const int FFTUNER_RING = 1 << 14;
+static const int FFTUNER_BANDS = 64;
+static const float FFTUNER_MIN_FREQ = 25.f;
+static const float FFTUNER_MAX_FREQ = 5000.f;
+static const float FFTUNER_REFERENCE = 5.f;
+
+static const char *FFTUNER_NOTES[] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+
+struct FFTunerRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    FFTunerRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+struct FFTuner: Module {
+    enum ParamIds {
+        THRESHOLD_PARAM,
+        REFERENCE_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        IN_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        VOCT_OUTPUT,
+        CENTS_OUTPUT,
+        GATE_OUTPUT,
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        GATE_LIGHT,
+        NUM_LIGHTS
+    };
+
+    // Audio thread -> worker
+    dsp::RingBuffer<float, FFTUNER_RING> ring;
+    std::atomic<float> sampleRate{44100.f};
+    std::atomic<int> overruns{0};
+
+    // Worker -> audio and UI threads
+    std::atomic<float> frequency{0.f};
+    std::atomic<float> level{-120.f};
+    float spectrum[2][FFTUNER_BANDS] = {};
+    std::atomic<int> spectrumIndex{0};
+
+    // Worker state, only touched by the worker
+    dsp::RealFFT fft;
+    alignas(16) float window[FFTUNER_SIZE];
+    alignas(16) float frame[FFTUNER_SIZE];
+    alignas(16) float bins[FFTUNER_SIZE];
+    float magnitudes[FFTUNER_SIZE / 2 + 1];
+    float history[FFTUNER_SIZE] = {};
+    int historyPos = 0;
+    int hopCounter = 0;
+    float analysisRate = 0.f;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool running = true;
+
+    // Display, written by the audio thread and read by the UI
+    const char *noteName = "-";
+    int octave = 0;
+    float cents = 0.f;
+
+    float lastSampleRate = 0.f;
+    float voct = 0.f;
+    bool gate = false;
+
+    FFTuner() : fft(FFTUNER_SIZE) {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(FFTuner::THRESHOLD_PARAM, -80.0, 0.0, -50.0, "Gate threshold", " dB");
+        configParam(FFTuner::REFERENCE_PARAM, 415.0, 466.0, 440.0, "A4 reference", " Hz");
+
+        for (int i = 0; i < FFTUNER_SIZE; i++)
+            window[i] = 0.5f * (1.f - cosf(2.f * M_PI * i / FFTUNER_SIZE));
+
+        worker = std::thread(&FFTuner::run, this);
+    }
+
+    ~FFTuner() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        condition.notify_one();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running) {
+            // Polling keeps the audio thread free of notify calls
+            condition.wait_for(lock, std::chrono::milliseconds(5));
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    }
+
+    void drain() {
+        float rate = sampleRate.load(std::memory_order_relaxed);
+        if (rate != analysisRate) {
+            // Old samples would read at the wrong pitch
+            analysisRate = rate;
+            std::fill(history, history + FFTUNER_SIZE, 0.f);
+            hopCounter = 0;
+        }
+
+        while (!ring.empty()) {
+            history[historyPos] = ring.shift();
+            historyPos = (historyPos + 1) % FFTUNER_SIZE;
+            if (++hopCounter >= FFTUNER_HOP) {
+                hopCounter = 0;
+                analyze();
+            }
+        }
+    }
+
+    // Peak of the magnitude spectrum near a bin
+    int localPeak(int bin, int radius, int lo, int hi) {
+        int best = bin;
+        for (int k = std::max(lo, bin - radius); k <= std::min(hi, bin + radius); k++) {
+            if (magnitudes[k] > magnitudes[best])
+                best = k;
+        }
+        return best;
+    }
+
+    void analyze() {
+        // Unroll the history so the oldest sample comes first
+        double energy = 0.0;
+        for (int i = 0; i < FFTUNER_SIZE; i++) {
+            float x = history[(historyPos + i) % FFTUNER_SIZE];
+            energy += x * x;
+            frame[i] = x * window[i];
+        }
+        fft.rfft(frame, bins);
+
+        // Ordered output: DC, Nyquist, then re/im pairs
+        const int half = FFTUNER_SIZE / 2;
+        magnitudes[0] = fabsf(bins[0]);
+        magnitudes[half] = fabsf(bins[1]);
+        for (int k = 1; k < half; k++)
+            magnitudes[k] = sqrtf(bins[2 * k] * bins[2 * k] + bins[2 * k + 1] * bins[2 * k + 1]);
+
+        float rms = sqrtf(energy / FFTUNER_SIZE);
+        level.store(20.f * log10f(std::max(rms / FFTUNER_REFERENCE, 1e-6f)), std::memory_order_relaxed);
+
+        // A Hann windowed sine of amplitude A peaks at A * N / 4
+        float norm = 4.f / (FFTUNER_SIZE * FFTUNER_REFERENCE);
+        float binHz = analysisRate / FFTUNER_SIZE;
+        int back = 1 - spectrumIndex.load(std::memory_order_relaxed);
+        for (int b = 0; b < FFTUNER_BANDS; b++) {
+            float f0 = 20.f * powf(1000.f, (float) b / FFTUNER_BANDS);
+            float f1 = 20.f * powf(1000.f, (float) (b + 1) / FFTUNER_BANDS);
+            int k0 = clamp((int) (f0 / binHz), 1, half);
+            int k1 = clamp((int) (f1 / binHz), k0, half);
+            float peak = 0.f;
+            for (int k = k0; k <= k1; k++)
+                peak = std::max(peak, magnitudes[k]);
+            float db = 20.f * log10f(std::max(peak * norm, 1e-6f));
+            spectrum[back][b] = clamp((db + 80.f) / 80.f, 0.f, 1.f);
+        }
+        spectrumIndex.store(back, std::memory_order_release);
+
+        int lo = std::max(2, (int) (FFTUNER_MIN_FREQ / binHz));
+        int hi = std::min(half - 1, (int) (FFTUNER_MAX_FREQ / binHz));
+        int peak = lo;
+        for (int k = lo; k <= hi; k++) {
+            if (magnitudes[k] > magnitudes[peak])
+                peak = k;
+        }
+
+        // The strongest partial is often a harmonic, prefer the lowest
+        // subharmonic that still carries a fair share of its energy
+        for (int d = 4; d >= 2; d--) {
+            int candidate = (int) roundf((float) peak / d);
+            if (candidate < lo)
+                continue;
+            int found = localPeak(candidate, 2, lo, hi);
+            if (magnitudes[found] > 0.2f * magnitudes[peak]) {
+                peak = found;
+                break;
+            }
+        }
+
+        // Parabolic interpolation on log magnitudes
+        float a = logf(magnitudes[peak - 1] + 1e-12f);
+        float b = logf(magnitudes[peak] + 1e-12f);
+        float c = logf(magnitudes[peak + 1] + 1e-12f);
+        float denom = a - 2.f * b + c;
+        float offset = denom != 0.f ? clamp(0.5f * (a - c) / denom, -0.5f, 0.5f) : 0.f;
+        frequency.store((peak + offset) * binHz, std::memory_order_relaxed);
+    }
+
+    void process(const ProcessArgs &args) override {
+        if (args.sampleRate != lastSampleRate) {
+            lastSampleRate = args.sampleRate;
+            sampleRate.store(args.sampleRate, std::memory_order_relaxed);
+        }
+
+        // Drop samples rather than wait if the worker falls behind
+        if (inputs[IN_INPUT].isConnected()) {
+            if (ring.full())
+                overruns++;
+            else
+                ring.push(inputs[IN_INPUT].getVoltageSum());
+        }
+
+        float threshold = params[THRESHOLD_PARAM].getValue();
+        float freq = frequency.load(std::memory_order_relaxed);
+        gate = inputs[IN_INPUT].isConnected() && freq > 0.f && level.load(std::memory_order_relaxed) > threshold;
+
+        // Hold the last pitch while the gate is low
+        if (gate) {
+            voct = log2f(freq / dsp::FREQ_C4);
+            float note = 69.f + 12.f * log2f(freq / params[REFERENCE_PARAM].getValue());
+            int nearest = (int) roundf(note);
+            cents = (note - nearest) * 100.f;
+            noteName = FFTUNER_NOTES[((nearest % 12) + 12) % 12];
+            octave = nearest / 12 - 1;
+        }
+
+        outputs[VOCT_OUTPUT].setVoltage(voct);
+        // +-50 cents as +-5V
+        outputs[CENTS_OUTPUT].setVoltage(gate ? cents * 0.1f : 0.f);
+        outputs[GATE_OUTPUT].setVoltage(gate ? 10.f : 0.f);
+        lights[GATE_LIGHT].value = gate ? 1.f : 0.f;
+    }
+};
+
+/*
+Display
+*/
+
+struct FFTunerNoteDisplayWidget : RJTextDisplay {
+    FFTuner *module = NULL;
+    const char *shownNote = NULL;
+    int shownOctave = 0;
+    int shownCents = 0;
+
+    FFTunerNoteDisplayWidget() {
+        fontSize = 16;
+        letterSpacing = 0.5;
+        text = "-";
+    }
+
+    bool update() override {
+        if (!module)
+            return false;
+        const char *note = module->gate ? module->noteName : NULL;
+        int centsRounded = (int) roundf(module->cents);
+        if (note == shownNote && (!note || (module->octave == shownOctave && centsRounded == shownCents)))
+            return false;
+
+        shownNote = note;
+        shownOctave = module->octave;
+        shownCents = centsRounded;
+        char buffer[32];
+        if (note)
+            snprintf(buffer, sizeof(buffer), "%s%d %+dc", note, shownOctave, shownCents);
+        else
+            snprintf(buffer, sizeof(buffer), "-");
+        text = buffer;
+        return true;
+    }
+
+    void drawText(NVGcontext *vg) override {
+        nvgTextAlign(vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(vg, box.size.x / 2, box.size.y / 2, text.c_str(), NULL);
+    }
+};
+
+struct FFTunerSpectrumWidget : TransparentWidget {
+    FFTuner *module = NULL;
+
+    void draw(NVGcontext *vg) override
+    {
+        NVGcolor backgroundColor = nvgRGB(0x20, 0x20, 0x20);
+        nvgBeginPath(vg);
+        nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
+        nvgFillColor(vg, backgroundColor);
+        nvgFill(vg);
+
+        if (!module)
+            return;
+
+        const float *bands = module->spectrum[module->spectrumIndex.load(std::memory_order_acquire)];
+        float width = box.size.x / FFTUNER_BANDS;
+        nvgBeginPath(vg);
+        for (int b = 0; b < FFTUNER_BANDS; b++) {
+            float height = bands[b] * (box.size.y - 4.f);
+            nvgRect(vg, b * width, box.size.y - 2.f - height, width * 0.8f, height);
+        }
+        nvgFillColor(vg, nvgRGB(0x00, 0xC0, 0x40));
+        nvgFill(vg);
+    }
+};
+
+
+struct FFTunerWidget: ModuleWidget {
+    FFTunerWidget(FFTuner *module);
+};
+
+FFTunerWidget::FFTunerWidget(FFTuner *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/FFTuner.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    {
+        FFTunerNoteDisplayWidget *display = new FFTunerNoteDisplayWidget();
+        display->box.pos = Vec(10, 45);
+        display->box.size = Vec(130, 30);
+        display->module = module;
+        addChild(display);
+    }
+    {
+        FFTunerSpectrumWidget *display = new FFTunerSpectrumWidget();
+        display->box.pos = Vec(10, 85);
+        display->box.size = Vec(130, 90);
+        display->module = module;
+        addChild(display);
+    }
+
+    addParam(createParam<FFTunerRoundLargeBlackKnob>(Vec(14, 190), module, FFTuner::THRESHOLD_PARAM));
+    addParam(createParam<FFTunerRoundLargeBlackKnob>(Vec(88, 190), module, FFTuner::REFERENCE_PARAM));
+    addChild(createLight<MediumLight<GreenLight>>(Vec(70, 270), module, FFTuner::GATE_LIGHT));
+
+    addInput(createInput<PJ301MPort>(Vec(10, 320), module, FFTuner::IN_INPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(45, 320), module, FFTuner::VOCT_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(80, 320), module, FFTuner::CENTS_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(112.5, 320), module, FFTuner::GATE_OUTPUT));
+}
+
+Model *modelFFTuner = createModel<FFTuner, FFTunerWidget>("FFTuner");
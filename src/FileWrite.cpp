@@ -27,6 +27,13 @@
 #include <cstring>
 #include <cmath>
 
+// The writer picks its byte order with __LITTLE_ENDIAN__, which Clang
+// predefines and GCC doesn't. Work it out here so recordings come out
+// right on every compiler, without touching how the readers are built.
+#if !defined(__LITTLE_ENDIAN__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define __LITTLE_ENDIAN__
+#endif
+
 namespace stk {
 
 const FileWrite::FILE_TYPE FileWrite :: FILE_RAW = 1;
@@ -101,12 +108,12 @@ struct MatHeader {
 };
 
 FileWrite :: FileWrite()
-  : fd_( 0 )
+  : fd_( 0 ), fileRate_( 0.0 )
 {
 }
 
 FileWrite::FileWrite( std::string fileName, unsigned int nChannels, FILE_TYPE type, Stk::StkFormat format )
-  : fd_( 0 )
+  : fd_( 0 ), fileRate_( 0.0 )
 {
   this->open( fileName, nChannels, type, format );
 }
@@ -223,7 +230,7 @@ bool FileWrite :: setWavFile( std::string fileName )
   }
 
   struct WaveHeader hdr = { {'R','I','F','F'}, 44, {'W','A','V','E'}, {'f','m','t',' '}, 16, 1, 1,
-                            (SINT32) Stk::sampleRate(), 0, 2, 16, 0, 0, 0, 
+                            (SINT32) fileRate(), 0, 2, 16, 0, 0, 0, 
                             {'\x01','\x00','\x00','\x00','\x00','\x00','\x10','\x00','\x80','\x00','\x00','\xAA','\x00','\x38','\x9B','\x71'},
                             {'f','a','c','t'}, 4, 0 };
   hdr.nChannels = (SINT16) channels_;
@@ -350,7 +357,7 @@ bool FileWrite :: setSndFile( std::string fileName )
     return false;
   }
 
-  struct SndHeader hdr = {".sn", 40, 0, 3, (SINT32) Stk::sampleRate(), 1, "Created by STK"};
+  struct SndHeader hdr = {".sn", 40, 0, 3, (SINT32) fileRate(), 1, "Created by STK"};
   hdr.pref[3] = 'd';
   hdr.nChannels = channels_;
   if ( dataType_ == STK_SINT8 )
@@ -446,7 +453,7 @@ bool FileWrite :: setAifFile( std::string fileName )
   // convert to that.
   SINT16 i;
   unsigned long exp;
-  unsigned long rate = (unsigned long) Stk::sampleRate();
+  unsigned long rate = (unsigned long) fileRate();
   memset( hdr.srate, 0, 10 );
   exp = rate;
   for ( i=0; i<32; i++ ) {
@@ -601,7 +608,7 @@ bool FileWrite :: setMatFile( std::string fileName )
   hdr.fs[12] = 9;             // Matlab IEEE 754 double data type
   hdr.fs[13] = 8;             // 8 bytes of data to follow
   FLOAT64 *sampleRate = (FLOAT64 *)&hdr.fs[14];
-  *sampleRate = (FLOAT64) Stk::sampleRate();
+  *sampleRate = (FLOAT64) fileRate();
 
   // Write audio samples in array data element
   hdr.adf[0] = (SINT32) 14;       // Matlab array data type value
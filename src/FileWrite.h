@@ -73,8 +73,18 @@ class FileWrite : public Stk
    */
   void write( StkFrames& buffer );
 
+  //! Set the sample rate stored in the header of the next file opened.
+  /*!
+    A value of zero (the default) uses Stk::sampleRate().  This lets a
+    file be tagged with a host rate without changing the global STK rate.
+  */
+  void setFileRate( StkFloat rate ) { fileRate_ = rate; };
+
  protected:
 
+  // Sample rate written to file headers.
+  StkFloat fileRate( void ) const { return fileRate_ > 0.0 ? fileRate_ : Stk::sampleRate(); };
+
   // Write STK RAW file header.
   bool setRawFile( std::string fileName );
 
@@ -108,6 +118,7 @@ class FileWrite : public Stk
   unsigned int channels_;
   unsigned long frameCounter_;
   bool byteswap_;
+  StkFloat fileRate_;
 
 };
 
@@ -71,6 +71,9 @@ class FileWvOut : public WvOut
   */
   void closeFile( void );
 
+  //! Set the sample rate stored in the header of the next file opened.
+  void setFileRate( StkFloat rate ) { file_.setFileRate( rate ); };
+
   //! Output a single sample to all channels in a sample frame.
   /*!
     An StkError is thrown if an output error occurs.
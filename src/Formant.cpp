@@ -0,0 +1,449 @@
+/*
+Formant - polyphonic vocal formant synth after stk::VoicForm.
+
+The voice is VoicForm's: a SingWave pulse through a one zero and a one pole,
+plus noise, into four parallel two pole resonances tuned from the Phonemes
+table. FormSwep recomputes its coefficients (a cos() each) every sample while
+it sweeps. Here the formants glide at control rate, once every FORMANT_BLOCK
+samples, and the coefficients ramp linearly across the block, which is
+enough to stay smooth and keeps the inner loop to multiplies and adds.
+
+Four voices run in the lanes of each float_4. The resonances all use the
+same zeros at +-1, so x - x[n-2] is worked out once per voice and shared by
+the four formants.
+*/
+
+#include "RJModules.hpp"
+#include "UI.hpp"
+#include "Phonemes.h"
+#include <iostream>
+#include <cmath>
+
+using simd::float_4;
+
+static const int FORMANT_BLOCK = 16;
+static const int FORMANT_VOICES = 16;
+static const int FORMANT_GROUPS = FORMANT_VOICES / 4;
+static const int FORMANT_PHONEMES = 32;
+// impuls20.raw, one cycle of the first 20 harmonics in 256 samples
+static const int FORMANT_TABLE = 256;
+static const float FORMANT_SILENCE = 1e-6f;
+
+struct FormantRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    FormantRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+// The Phonemes table with the gains already out of dB
+struct FormantTables {
+    float frequency[FORMANT_PHONEMES][4];
+    float radius[FORMANT_PHONEMES][4];
+    float gain[FORMANT_PHONEMES][4];
+    float voiced[FORMANT_PHONEMES];
+    float noise[FORMANT_PHONEMES];
+    // One extra sample so the interpolation never wraps
+    float pulse[FORMANT_TABLE + 1];
+
+    FormantTables() {
+        for (int i = 0; i < FORMANT_PHONEMES; i++) {
+            for (int f = 0; f < 4; f++) {
+                frequency[i][f] = stk::Phonemes::formantFrequency(i, f);
+                radius[i][f] = stk::Phonemes::formantRadius(i, f);
+                gain[i][f] = powf(10.f, stk::Phonemes::formantGain(i, f) / 20.f);
+            }
+            voiced[i] = stk::Phonemes::voiceGain(i);
+            noise[i] = stk::Phonemes::noiseGain(i);
+        }
+
+        // Rebuilt rather than read from rawwaves, it is only a sum of cosines
+        float peak = 0.f;
+        for (int n = 0; n < FORMANT_TABLE; n++) {
+            float sum = 0.f;
+            for (int k = 1; k <= 20; k++)
+                sum += cosf(2 * M_PI * k * n / FORMANT_TABLE);
+            pulse[n] = sum;
+            peak = std::max(peak, std::fabs(sum));
+        }
+        for (int n = 0; n < FORMANT_TABLE; n++)
+            pulse[n] /= peak;
+        pulse[FORMANT_TABLE] = pulse[0];
+    }
+};
+
+static const FormantTables &formantTables() {
+    static const FormantTables tables;
+    return tables;
+}
+
+// Four voices of VoicForm
+struct FormantVoice {
+    // Where the formants are now, in Hz, pole radius and linear gain
+    float_4 frequency[4];
+    float_4 radius[4];
+    float_4 gain[4];
+
+    // y = k * (x - x[n-2]) - a1 * y[n-1] - a2 * y[n-2], and the per sample
+    // steps that bring k, a1 and a2 to this block's values
+    float_4 k[4];
+    float_4 a1[4];
+    float_4 a2[4];
+    float_4 dk[4];
+    float_4 da1[4];
+    float_4 da2[4];
+    float_4 y1[4];
+    float_4 y2[4];
+    float_4 x1;
+    float_4 x2;
+
+    // SingWave
+    float_4 phase;
+    float_4 rate;
+    float_4 dRate;
+    float_4 vibratoPhase;
+    float_4 voiced;
+    float_4 voicedTarget;
+    float_4 noise;
+    float_4 noiseTarget;
+
+    // OneZero(-0.9) and OnePole
+    float_4 zeroState;
+    float_4 pole;
+    float_4 poleState;
+
+    bool awake = false;
+    bool fresh = true;
+
+    FormantVoice() {
+        for (int f = 0; f < 4; f++) {
+            frequency[f] = 0.f;
+            radius[f] = 0.f;
+            gain[f] = 0.f;
+        }
+        phase = 0.f;
+        rate = 0.f;
+        vibratoPhase = 0.f;
+        pole = 0.9f;
+        clear();
+    }
+
+    void clear() {
+        for (int f = 0; f < 4; f++) {
+            k[f] = 0.f;
+            a1[f] = 0.f;
+            a2[f] = 0.f;
+            dk[f] = 0.f;
+            da1[f] = 0.f;
+            da2[f] = 0.f;
+            y1[f] = 0.f;
+            y2[f] = 0.f;
+        }
+        x1 = 0.f;
+        x2 = 0.f;
+        dRate = 0.f;
+        voiced = 0.f;
+        voicedTarget = 0.f;
+        noise = 0.f;
+        noiseTarget = 0.f;
+        zeroState = 0.f;
+        poleState = 0.f;
+    }
+
+    // Moves the formants toward `phonemes` and sets up the next block's ramps.
+    // `glide` is the fraction of the way they go this block.
+    void control(const int *phonemes, float_4 scale, float glide, float_4 freq, float_4 velocity, float_4 gate, float_4 vibrato, float_4 vibratoRate, float sampleRate) {
+        const FormantTables &tables = formantTables();
+        float sampleTime = 1.f / sampleRate;
+
+        // First use, or back from silence: start on the phoneme, not a sweep up to it
+        float move = fresh ? 1.f : glide;
+        for (int f = 0; f < 4; f++) {
+            float_4 targetFrequency, targetRadius, targetGain;
+            for (int l = 0; l < 4; l++) {
+                targetFrequency[l] = tables.frequency[phonemes[l]][f];
+                targetRadius[l] = tables.radius[phonemes[l]][f];
+                targetGain[l] = tables.gain[phonemes[l]][f];
+            }
+            frequency[f] += (targetFrequency * scale - frequency[f]) * move;
+            radius[f] += (targetRadius - radius[f]) * move;
+            gain[f] += (targetGain - gain[f]) * move;
+
+            // FormSwep::setResonance(), with the gain folded into b0
+            float_4 w = 2.f * M_PI * simd::fmin(frequency[f], 0.45f * sampleRate) * sampleTime;
+            float_4 newK = gain[f] * (0.5f - 0.5f * radius[f] * radius[f]);
+            float_4 newA1 = -2.f * radius[f] * simd::cos(w);
+            float_4 newA2 = radius[f] * radius[f];
+            if (fresh) {
+                k[f] = newK;
+                a1[f] = newA1;
+                a2[f] = newA2;
+            }
+            dk[f] = (newK - k[f]) * (1.f / FORMANT_BLOCK);
+            da1[f] = (newA1 - a1[f]) * (1.f / FORMANT_BLOCK);
+            da2[f] = (newA2 - a2[f]) * (1.f / FORMANT_BLOCK);
+        }
+
+        float_4 voicedGain, noiseGain;
+        for (int l = 0; l < 4; l++) {
+            voicedGain[l] = tables.voiced[phonemes[l]];
+            noiseGain[l] = tables.noise[phonemes[l]];
+        }
+        voicedTarget = gate * velocity * voicedGain;
+        noiseTarget = gate * velocity * noiseGain;
+        // VoicForm::noteOn(), louder notes are brighter
+        pole = simd::ifelse(gate != 0.f, 0.97f - velocity * 0.2f, pole);
+
+        // SingWave's vibrato, held for the block, with the pitch ramped across it
+        vibratoPhase += vibratoRate * (FORMANT_BLOCK * sampleTime);
+        vibratoPhase -= simd::floor(vibratoPhase);
+        float_4 newRate = FORMANT_TABLE * freq * sampleTime * (1.f + vibrato * simd::sin(2.f * M_PI * vibratoPhase));
+        if (fresh)
+            rate = newRate;
+        dRate = (newRate - rate) * (1.f / FORMANT_BLOCK);
+        fresh = false;
+    }
+
+    // One block. Returns the block's largest output, for the sleep check.
+    float process(float *out, bool unvoiced, float sampleRate) {
+        const FormantTables &tables = formantTables();
+        // Envelope::setRate(0.001) at 44.1 kHz, at any sample rate
+        float envelopeRate = 44.1f / sampleRate;
+        float_4 peak = 0.f;
+
+        for (int n = 0; n < FORMANT_BLOCK; n++) {
+            rate += dRate;
+            phase += rate;
+            phase -= simd::floor(phase * (1.f / FORMANT_TABLE)) * FORMANT_TABLE;
+            float_4 index = simd::floor(phase);
+            float_4 frac = phase - index;
+            float_4 a, b;
+            for (int l = 0; l < 4; l++) {
+                int i = (int) index[l];
+                a[l] = tables.pulse[i];
+                b[l] = tables.pulse[i + 1];
+            }
+
+            voiced += simd::clamp(voicedTarget - voiced, -envelopeRate, envelopeRate);
+            float_4 pulse = (a + (b - a) * frac) * voiced;
+            float_4 zero = (pulse + 0.9f * zeroState) * (1.f / 1.9f);
+            zeroState = pulse;
+            poleState = (1.f - pole) * zero + pole * poleState;
+            float_4 x = poleState;
+
+            if (unvoiced) {
+                noise += simd::clamp(noiseTarget - noise, -envelopeRate, envelopeRate);
+                float_4 white;
+                for (int l = 0; l < 4; l++)
+                    white[l] = 2.f * random::uniform() - 1.f;
+                x += noise * white;
+            }
+
+            float_4 dx = x - x2;
+            x2 = x1;
+            x1 = x;
+
+            float_4 y = 0.f;
+            for (int f = 0; f < 4; f++) {
+                k[f] += dk[f];
+                a1[f] += da1[f];
+                a2[f] += da2[f];
+                float_4 yf = k[f] * dx - a1[f] * y1[f] - a2[f] * y2[f];
+                y2[f] = y1[f];
+                y1[f] = yf;
+                y += yf;
+            }
+            y.store(out + 4 * n);
+            peak = simd::fmax(peak, simd::fabs(y));
+        }
+
+        return std::max(std::max(peak[0], peak[1]), std::max(peak[2], peak[3]));
+    }
+
+    bool silent() {
+        return simd::movemask((voiced != 0.f) | (voicedTarget != 0.f) | (noise != 0.f) | (noiseTarget != 0.f)) == 0;
+    }
+};
+
+struct Formant: Module {
+    enum ParamIds {
+        FREQ_PARAM,
+        PHONEME_PARAM,
+        SHIFT_PARAM,
+        GLIDE_PARAM,
+        VIBRATO_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        VOCT_INPUT,
+        GATE_INPUT,
+        VELOCITY_INPUT,
+        PHONEME_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        OUT_OUTPUT,
+        MIX_OUTPUT,
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        NUM_LIGHTS
+    };
+
+    FormantVoice voices[FORMANT_GROUPS];
+    alignas(16) float buffer[FORMANT_GROUPS][4 * FORMANT_BLOCK] = {};
+    int position = 0;
+    int channels = 1;
+
+    // Display
+    const char *phonemeName = "eee";
+
+    Formant() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(Formant::FREQ_PARAM, -4.0, 4.0, -1.0, "Frequency", " Hz", 2, dsp::FREQ_C4);
+        configParam(Formant::PHONEME_PARAM, 0.0, FORMANT_PHONEMES - 1, 0.0, "Phoneme");
+        configParam(Formant::SHIFT_PARAM, -1.0, 1.0, 0.0, "Formant shift", " semitones", 0, 4);
+        configParam(Formant::GLIDE_PARAM, 0.0, 1.0, 0.33, "Glide", " ms", 1000, 1);
+        configParam(Formant::VIBRATO_PARAM, 0.0, 1.0, 0.5, "Vibrato", "%", 0, 100);
+        formantTables();
+    }
+
+    void onReset() override {
+        for (int g = 0; g < FORMANT_GROUPS; g++) {
+            voices[g].clear();
+            voices[g].awake = false;
+            voices[g].fresh = true;
+        }
+    }
+
+    void control(const ProcessArgs& args) {
+        channels = std::max(1, std::max(inputs[VOCT_INPUT].getChannels(), inputs[GATE_INPUT].getChannels()));
+
+        float pitch = params[FREQ_PARAM].getValue();
+        float_4 scale = std::pow(2.f, params[SHIFT_PARAM].getValue() / 3.f);
+        float glideTime = std::pow(1000.f, params[GLIDE_PARAM].getValue()) * 0.001f;
+        float glide = 1.f - std::exp(-FORMANT_BLOCK / (glideTime * args.sampleRate));
+        // SingWave's default vibrato gain is 0.04
+        float vibrato = params[VIBRATO_PARAM].getValue() * 0.08f;
+        bool velocityConnected = inputs[VELOCITY_INPUT].isConnected();
+        bool gateConnected = inputs[GATE_INPUT].isConnected();
+
+        for (int c = 0; c < channels; c += 4) {
+            int g = c / 4;
+            FormantVoice &voice = voices[g];
+
+            // 10V runs through the whole table
+            float_4 phoneme = params[PHONEME_PARAM].getValue() + inputs[PHONEME_INPUT].getPolyVoltageSimd<float_4>(c) * ((FORMANT_PHONEMES - 1) / 10.f);
+            int phonemes[4];
+            for (int l = 0; l < 4; l++)
+                phonemes[l] = clamp((int) roundf(phoneme[l]), 0, FORMANT_PHONEMES - 1);
+            if (c == 0)
+                phonemeName = stk::Phonemes::name(phonemes[0]);
+
+            // Without a gate cable the voices drone
+            float_4 gate = gateConnected ? simd::ifelse(inputs[GATE_INPUT].getPolyVoltageSimd<float_4>(c) >= 1.f, 1.f, 0.f) : 1.f;
+            float_4 velocity = velocityConnected ? simd::clamp(inputs[VELOCITY_INPUT].getPolyVoltageSimd<float_4>(c) / 10.f, 0.f, 1.f) : 1.f;
+            float_4 freq = simd::clamp(dsp::FREQ_C4 * dsp::approxExp2_taylor5(simd::clamp(pitch + inputs[VOCT_INPUT].getPolyVoltageSimd<float_4>(c), -6.f, 6.f)), 20.f, 2000.f);
+            // A slightly different vibrato speed per voice, so a choir doesn't wobble in step
+            float_4 vibratoRate = 6.f * (1.f + 0.03f * (float_4(0.f, 1.f, 2.f, 3.f) + c - 7.5f) / 7.5f);
+
+            if (!voice.awake && simd::movemask(gate != 0.f) == 0) {
+                std::fill(buffer[g], buffer[g] + 4 * FORMANT_BLOCK, 0.f);
+                continue;
+            }
+            if (!voice.awake) {
+                voice.clear();
+                voice.fresh = true;
+                voice.awake = true;
+            }
+            voice.control(phonemes, scale, glide, freq, velocity, gate, vibrato, vibratoRate, args.sampleRate);
+
+            bool unvoiced = simd::movemask((voice.noise != 0.f) | (voice.noiseTarget != 0.f)) != 0;
+            float peak = voice.process(buffer[g], unvoiced, args.sampleRate);
+            if (peak < FORMANT_SILENCE && voice.silent())
+                voice.awake = false;
+        }
+    }
+
+    void process(const ProcessArgs& args) override {
+        if (position == 0)
+            control(args);
+
+        outputs[OUT_OUTPUT].setChannels(channels);
+        float mix = 0.f;
+        for (int c = 0; c < channels; c++) {
+            float out = buffer[c / 4][4 * position + c % 4] * 5.f;
+            outputs[OUT_OUTPUT].setVoltage(out, c);
+            mix += out;
+        }
+        outputs[MIX_OUTPUT].setVoltage(mix);
+
+        if (++position >= FORMANT_BLOCK)
+            position = 0;
+    }
+};
+
+
+struct FormantPhonemeDisplay : RJValueDisplay<const char *> {
+    FormantPhonemeDisplay() {
+        fontSize = 16;
+        letterSpacing = 0.5;
+        text = "eee";
+    }
+
+    std::string format(const char * const &v) override {
+        return v;
+    }
+
+    void drawText(NVGcontext *vg) override {
+        nvgTextAlign(vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(vg, box.size.x / 2, box.size.y / 2, text.c_str(), NULL);
+    }
+};
+
+
+struct FormantWidget: ModuleWidget {
+    FormantWidget(Formant *module);
+};
+
+FormantWidget::FormantWidget(Formant *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/Formant.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    {
+        FormantPhonemeDisplay *display = new FormantPhonemeDisplay();
+        display->box.pos = Vec(10, 40);
+        display->box.size = Vec(130, 30);
+        display->value = module ? &module->phonemeName : NULL;
+        addChild(display);
+    }
+
+    addParam(createParam<FormantRoundLargeBlackKnob>(Vec(14, 80), module, Formant::FREQ_PARAM));
+    addParam(createParam<FormantRoundLargeBlackKnob>(Vec(88, 80), module, Formant::PHONEME_PARAM));
+    addParam(createParam<FormantRoundLargeBlackKnob>(Vec(14, 145), module, Formant::SHIFT_PARAM));
+    addParam(createParam<FormantRoundLargeBlackKnob>(Vec(88, 145), module, Formant::GLIDE_PARAM));
+    addParam(createParam<FormantRoundLargeBlackKnob>(Vec(51, 210), module, Formant::VIBRATO_PARAM));
+
+    addInput(createInput<PJ301MPort>(Vec(10, 280), module, Formant::VOCT_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(45, 280), module, Formant::GATE_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(80, 280), module, Formant::VELOCITY_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(112.5, 280), module, Formant::PHONEME_INPUT));
+
+    addOutput(createOutput<PJ301MPort>(Vec(45, 320), module, Formant::OUT_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(80, 320), module, Formant::MIX_OUTPUT));
+}
+
+Model *modelFormant = createModel<Formant, FormantWidget>("Formant");
@@ -33,6 +33,34 @@ struct GuitarLEDButton : SVGSwitch {
         }
 };
 
+// Semitones of each open string above the low E, bottom row first
+static const int GUITAR_STRING_BASE[8] = {0, 5, 10, 15, 19, 24, 29, 34};
+
+static const int GUITAR_STRINGS = 6;
+static const int GUITAR_CHORDS = 16;
+
+// Open chord shapes for the top two rows in six string mode, frets from low E, -1 is muted
+static const int GUITAR_CHORD_SHAPES[GUITAR_CHORDS][GUITAR_STRINGS] = {
+    // Top row: Em Am Dm A7 D7 G7 C7 Bm
+    { 0,  2,  2,  0,  0,  0},
+    {-1,  0,  2,  2,  1,  0},
+    {-1, -1,  0,  2,  3,  1},
+    {-1,  0,  2,  0,  2,  0},
+    {-1, -1,  0,  2,  1,  2},
+    { 3,  2,  0,  0,  0,  1},
+    {-1,  3,  2,  3,  1,  0},
+    {-1,  2,  4,  4,  3,  2},
+    // Second row: E A D G C F B7 E7
+    { 0,  2,  2,  1,  0,  0},
+    {-1,  0,  2,  2,  2,  0},
+    {-1, -1,  0,  2,  3,  2},
+    { 3,  2,  0,  0,  0,  3},
+    {-1,  3,  2,  0,  1,  0},
+    { 1,  3,  3,  2,  1,  1},
+    {-1,  2,  1,  2,  0,  2},
+    { 0,  2,  0,  1,  0,  0}
+};
+
 struct GuitarNeck: Module {
     enum ParamIds {
         ENUMS(FRET, 64),
@@ -58,40 +86,41 @@ struct GuitarNeck: Module {
         HOLD_LIGHT,
         NUM_LIGHTS
     };
-    
+
     dsp::SchmittTrigger returnTrigger;
     dsp::SchmittTrigger holdTrigger;
     bool RETURN = true;
     bool HOLD = false;
 
-    int currentSquare;
-    bool gateOpen;
-    float lightValues[64];
+    // Pads are only scanned when the widgets report a change, or now and
+    // then in case something else (MIDI map, undo) moved them
+    std::atomic<uint32_t> padChanges{0};
+    uint32_t seenChanges = 0;
+    dsp::ClockDivider scanDivider;
+    dsp::ClockDivider lightDivider;
+    uint64_t pressed = 0;
+    uint64_t lit = 0;
+    float lightValues[64] = {};
     const float lightLambda = 0.06;
-    float pitchVoltage = 0;
 
+    // Mono: the last pressed pad in scan order wins
     int string = 0;
-    int lastPad;
-    int realPad;
-    bool newPad = false;
+    int fret = 0;
+    bool gateOpen = false;
     bool lastGate = false;
-    bool lastOpen = false;
-    bool pluck = false;
-    bool returnToOpen = false;
-
-    float notes[12] = { 0,  
-                        0.08333333333333333333, 
-                        0.16666666666666666667, 
-                        0.25, 
-                        0.33333333333333333333, 
-                        0.41666666666666666667,
-                        0.5, 
-                        0.58333333333333333333, 
-                        0.66666666666666666667, 
-                        0.75, 
-                        0.83333333333333333333, 
-                        0.91666666666666666667
-                    };
+
+    // Six strings: one poly channel per string
+    int poly_mode_index = 0;
+    int scannedPolyMode = 0;
+    bool scannedHold = false;
+    int strum_mode_index = 1;
+    int chord = -1;
+    int stringFret[GUITAR_STRINGS];
+    float stringPitch[GUITAR_STRINGS] = {};
+    bool stringGate[GUITAR_STRINGS] = {};
+    // Counts down to the sample a string (re)opens its gate, 0 when idle
+    int stringDelay[GUITAR_STRINGS] = {};
+    bool strumming = false;
 
     GuitarNeck() {
         config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -104,8 +133,31 @@ struct GuitarNeck: Module {
         configParam(GuitarNeck::OCT_PARAM, -2.0, 4.0, 1.0, string::f("Octave", 0));
         configParam(GuitarNeck::ROOT_PARAM, 0.0, 11.0, 4.0, string::f("Root", 0));
 
+        scanDivider.setDivision(512);
+        lightDivider.setDivision(64);
+        for (int s = 0; s < GUITAR_STRINGS; s++)
+            stringFret[s] = -1;
+    }
+
+    json_t *dataToJson() override {
+        json_t *rootJ = json_object();
+        json_object_set_new(rootJ, "poly", json_integer(poly_mode_index));
+        json_object_set_new(rootJ, "strum", json_integer(strum_mode_index));
+        return rootJ;
+    }
+
+    void dataFromJson(json_t *rootJ) override {
+        json_t *polyJ = json_object_get(rootJ, "poly");
+        if (polyJ)
+            poly_mode_index = clamp((int) json_integer_value(polyJ), 0, 1);
+        json_t *strumJ = json_object_get(rootJ, "strum");
+        if (strumJ)
+            strum_mode_index = clamp((int) json_integer_value(strumJ), 0, 2);
     }
-    void step() override;
+
+    void scanPads(float sampleRate);
+    void updateStrings(uint64_t pressedNow, float sampleRate);
+    void process(const ProcessArgs &args) override;
 };
 
 struct MedLEDButton : SVGSwitch {
@@ -122,125 +174,171 @@ struct MedLight : BASE {
         }
 };
 
-void GuitarNeck::step() {
+void GuitarNeck::scanPads(float sampleRate) {
+    uint64_t pressedNow = 0;
+    for (int i = 0; i < 64; i++) {
+        if (params[FRET + i].getValue() > 0)
+            pressedNow |= (uint64_t) 1 << i;
+    }
+    // Letting go of HOLD releases strings without any pad changing
+    if (pressedNow == pressed && poly_mode_index == scannedPolyMode && HOLD == scannedHold)
+        return;
+
+    if (pressedNow) {
+        // Pad i sits on row i / 8, the bottom row being the low E string
+        int i = 63 - __builtin_clzll(pressedNow);
+        string = 7 - i / 8;
+        fret = i % 8;
+    }
+    gateOpen = pressedNow != 0;
+
+    if (poly_mode_index != 0)
+        updateStrings(pressedNow, sampleRate);
 
-    // Knobs and CV processing
-    int root = params[ROOT_PARAM].value + clamp(inputs[ROOT_INPUT].normalize(5.0f) / 5.0f, 0.0f, 11.0f);
-    int octave = params[OCT_PARAM].value * clamp(inputs[OCT_INPUT].normalize(5.0f) / 5.0f, 0.0f, 5.0f);
+    pressed = pressedNow;
+    scannedPolyMode = poly_mode_index;
+    scannedHold = HOLD;
+}
+
+void GuitarNeck::updateStrings(uint64_t pressedNow, float sampleRate) {
+    uint64_t pressedNew = pressedNow & ~pressed;
+
+    // The top two rows hold chord shapes, top left being the first
+    int chordNow = -1;
+    uint64_t chordPads = pressedNow & 0xFFFF;
+    if (chordPads)
+        chordNow = __builtin_ctzll(chordPads & pressedNew ? chordPads & pressedNew : chordPads);
+    bool strum = chordNow >= 0 && (chordNow != chord || scannedPolyMode == 0);
+    chord = chordNow;
+
+    static const float strumTimes[] = {0.f, 0.012f, 0.035f};
+    int strumSamples = (int) (strumTimes[clamp(strum_mode_index, 0, 2)] * sampleRate);
+
+    lit = pressedNow;
+    for (int s = 0; s < GUITAR_STRINGS; s++) {
+        // The highest fret held on a string wins over the chord shape
+        int row = (7 - s) * 8;
+        uint64_t rowPads = (pressedNow >> row) & 0xFF;
+        int newFret = -1;
+        if (rowPads)
+            newFret = 63 - __builtin_clzll(rowPads);
+        else if (chord >= 0)
+            newFret = GUITAR_CHORD_SHAPES[chord][s];
+
+        if (chord >= 0 && !rowPads && newFret >= 0 && newFret < 8)
+            lit |= (uint64_t) 1 << (row + newFret);
+
+        bool fretted = (pressedNew >> row) & 0xFF;
+        if (newFret >= 0) {
+            stringPitch[s] = (GUITAR_STRING_BASE[s] + newFret) / 12.f;
+            // Retrigger on a new fret or a strum, low string first. The
+            // gate stays low for at least one sample
+            if (fretted || strum || stringFret[s] < 0) {
+                stringDelay[s] = 2 + (strum ? s * strumSamples : 0);
+                strumming = true;
+            }
+        }
+        else if (!HOLD) {
+            stringGate[s] = false;
+            stringDelay[s] = 0;
+        }
+        stringFret[s] = newFret;
+    }
+}
 
+void GuitarNeck::process(const ProcessArgs &args) {
+
+    // Knobs and CV processing
+    int root = params[ROOT_PARAM].getValue() + clamp(inputs[ROOT_INPUT].getNormalVoltage(5.0f) / 5.0f, 0.0f, 11.0f);
+    int octave = params[OCT_PARAM].getValue() * clamp(inputs[OCT_INPUT].getNormalVoltage(5.0f) / 5.0f, 0.0f, 5.0f);
+    float rootVoltage = (root - 1) / 12.f;
 
     // Buttons
-    if (holdTrigger.process(params[HOLD_PARAM].value)){
+    if (holdTrigger.process(params[HOLD_PARAM].getValue())){
         HOLD = !HOLD;
     }
-    if (returnTrigger.process(params[RETURN_PARAM].value)){
+    if (returnTrigger.process(params[RETURN_PARAM].getValue())){
         RETURN = !RETURN;
     }
-    if(HOLD){
-        lights[HOLD_LIGHT].value = 10.0;
-    }
-    else{
-        lights[HOLD_LIGHT].value = -10.0;
-    }
-    if(RETURN){
-        lights[RETURN_LIGHT].value = 10.0;
-    }
-    else{
-        lights[RETURN_LIGHT].value = -10.0;
+
+    uint32_t changes = padChanges.load(std::memory_order_relaxed);
+    bool rescan = scanDivider.process();
+    if (changes != seenChanges || HOLD != scannedHold || rescan) {
+        seenChanges = changes;
+        scanPads(args.sampleRate);
     }
-    
-    // Get the note and lights
-    for(int i=0; i<64; i++){
-        // Lights
-        if(paramQuantities[ParamIds::FRET + i]->getValue() > 0){
-            lightValues[i] = 1.0;
-            // lol I have no idea how I came up with this
-            realPad = ((64-((i/8) * 8)) + (i%8)) - 8;
-            string = 7 - i/8;
-            if(realPad != lastPad){
-                newPad = true;
-                lastPad = newPad;
+
+    if (poly_mode_index != 0) {
+        if (strumming) {
+            strumming = false;
+            for (int s = 0; s < GUITAR_STRINGS; s++) {
+                if (stringDelay[s] > 0) {
+                    // Hold the gate low until the string's turn comes
+                    stringGate[s] = --stringDelay[s] == 0;
+                    strumming |= stringDelay[s] > 0;
+                }
             }
-            gateOpen = true;
         }
 
-        lights[LIGHT + i].value = lightValues[i];
-        if(lightValues[i] > 0){
-            lightValues[i] -= lightValues[i] / lightLambda / APP->engine->getSampleRate();
+        outputs[NOTE_OUTPUT].setChannels(GUITAR_STRINGS);
+        outputs[GATE_OUTPUT].setChannels(GUITAR_STRINGS);
+        for (int s = 0; s < GUITAR_STRINGS; s++) {
+            outputs[NOTE_OUTPUT].setVoltage(stringPitch[s] + rootVoltage + octave, s);
+            outputs[GATE_OUTPUT].setVoltage(stringGate[s] ? 10.f : 0.f, s);
         }
-
     }
-
-    // Calculate pad output
-    if(RETURN){
-        if(!gateOpen){
-            realPad = string * 8;
-        }
-        if(!gateOpen && lastGate){
-            pluck = true;
+    else {
+        // Calculate pad output
+        bool pluck = false;
+        if(RETURN){
+            if(!gateOpen){
+                fret = 0;
+            }
+            if(!gateOpen && lastGate){
+                pluck = true;
+            }
         }
-    } else{
-        pluck = false;
-    }
 
+        float pitchVoltage = (GUITAR_STRING_BASE[string] + fret) / 12.f;
 
-    switch(string){
-        case 0:
-            // E
-            pitchVoltage = (float)realPad / (float)12;
-            break;
-        case 1:
-            // A
-            pitchVoltage = ((float)realPad - (float)3) / (float)12;
-            break;
-        case 2:
-            // D
-            pitchVoltage = ((float)realPad - (float)6) / (float)12;
-            break;
-        case 3:
-            // G
-            pitchVoltage = ((float)realPad - (float)9) / (float)12;
-            break;
-        case 4:
-            // B
-            pitchVoltage = ((float)realPad - (float)13) / (float)12;
-            break;
-        case 5:
-            // E
-            pitchVoltage = ((float)realPad - (float)16) / (float)12;
-            break;
-        case 6:
-            // A
-            pitchVoltage = ((float)realPad - (float)19) / (float)12;
-            break;
-        case 7:
-            // D
-            pitchVoltage = ((float)realPad - (float)22) / (float)12;
-            break;
-    }
+        outputs[NOTE_OUTPUT].setChannels(1);
+        outputs[GATE_OUTPUT].setChannels(1);
+        if(pluck){
+            outputs[NOTE_OUTPUT].setVoltage(pitchVoltage + octave);
+        } else{
+            outputs[NOTE_OUTPUT].setVoltage(pitchVoltage + rootVoltage + octave);
+        }
 
-    if(pluck){
-        outputs[NOTE_OUTPUT].value = pitchVoltage + octave;
-    } else{
-        outputs[NOTE_OUTPUT].value = pitchVoltage + notes[root-1] + octave;
-    }
+        if(gateOpen || pluck){
+            outputs[GATE_OUTPUT].setVoltage(10.f);
+        } else{
+            outputs[GATE_OUTPUT].setVoltage(0.f);
+        }
 
-    if(gateOpen || pluck){
-        outputs[GATE_OUTPUT].value = 10.f;
-    } else{
-        outputs[GATE_OUTPUT].value = 0.f;
+        lastGate = gateOpen;
+        lit = pressed;
     }
 
-    lastGate = gateOpen;
-    gateOpen = false;
-    pluck=false;
-
+    if (lightDivider.process()) {
+        lights[HOLD_LIGHT].value = HOLD ? 10.0 : -10.0;
+        lights[RETURN_LIGHT].value = RETURN ? 10.0 : -10.0;
 
+        // Held pads stay lit, released ones fade out
+        float decay = expf(-(float) lightDivider.getDivision() / (lightLambda * args.sampleRate));
+        for (int i = 0; i < 64; i++) {
+            if ((lit >> i) & 1)
+                lightValues[i] = 1.0;
+            else
+                lightValues[i] *= decay;
+            lights[LIGHT + i].value = lightValues[i];
+        }
+    }
 }
 
 
 struct GuitarNeckWidget: ModuleWidget {
     GuitarNeckWidget(GuitarNeck *module);
+    void appendContextMenu(Menu *menu) override;
 };
 
 GuitarNeckWidget::GuitarNeckWidget(GuitarNeck *module) {
@@ -307,6 +405,7 @@ GuitarNeckWidget::GuitarNeckWidget(GuitarNeck *module) {
             pad->box.pos = Vec(x, y);
             pad->btnId = id;
             pad->groupId = groupId;
+            pad->changes = module ? &module->padChanges : NULL;
             if (pad->getParamQuantity())
             {
                 pad->getParamQuantity()->minValue = 0;
@@ -339,4 +438,20 @@ GuitarNeckWidget::GuitarNeckWidget(GuitarNeck *module) {
 
 }
 
+void GuitarNeckWidget::appendContextMenu(Menu *menu) {
+    GuitarNeck *module = dynamic_cast<GuitarNeck *>(this->module);
+
+    menu->addChild(new MenuEntry);
+
+    RJChoiceItem *polyItem = createMenuItem<RJChoiceItem>("Poly Mode", ">");
+    polyItem->target = &module->poly_mode_index;
+    polyItem->labels = {"Mono", "Six Strings (top rows are chords)"};
+    menu->addChild(polyItem);
+
+    RJChoiceItem *strumItem = createMenuItem<RJChoiceItem>("Strum", ">");
+    strumItem->target = &module->strum_mode_index;
+    strumItem->labels = {"Off", "Fast", "Slow"};
+    menu->addChild(strumItem);
+}
+
 Model *modelGuitarNeck = createModel<GuitarNeck, GuitarNeckWidget>("GuitarNeck");
@@ -1,4 +1,5 @@
 #include "RJModules.hpp"
+#include "UI.hpp"
 #include "common.hpp"
 
 #include "Rhodey.h"
@@ -27,6 +28,8 @@
 #include "Twang.h"
 #include "Whistle.h"
 #include "Wurley.h"
+#include "Convolver.hpp"
+#include "osdialog.h"
 
 #include <iostream>
 #include <cmath>
@@ -42,42 +45,12 @@ using namespace std;
 Display
 */
 
-struct InstroSmallStringDisplayWidget : TransparentWidget {
-
-  std::string *value;
-
-  void draw(NVGcontext *vg) override
-  {
-
-    // Shadow
-    NVGcolor backgroundColorS = nvgRGB(0xA0, 0xA0, 0xA0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y + 2.0, 4.0);
-    nvgFillColor(vg, backgroundColorS);
-    nvgFill(vg);
-
-    // Background
-    NVGcolor backgroundColor = nvgRGB(0xC0, 0xC0, 0xC0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
-    nvgFillColor(vg, backgroundColor);
-    nvgFill(vg);
-
-    // text
-    std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, "res/Pokemon.ttf"));
-    if (font) {
-    nvgFontSize(vg, 20);
-    nvgFontFaceId(vg, font->handle);
-    nvgTextLetterSpacing(vg, 0.4);
-    }
-
-    std::stringstream to_display;
-    to_display << std::setw(3) << *value;
-
-    Vec textPos = Vec(12.0f, 28.0f);
-    NVGcolor textColor = nvgRGB(0x00, 0x00, 0x00);
-    nvgFillColor(vg, textColor);
-    nvgText(vg, textPos.x, textPos.y, to_display.str().c_str(), NULL);
+struct InstroSmallStringDisplayWidget : RJStringDisplay {
+  InstroSmallStringDisplayWidget() {
+    shadow = true;
+    fontSize = 20;
+    letterSpacing = 0.4;
+    textPos = Vec(12.0f, 28.0f);
   }
 };
 
@@ -169,6 +142,10 @@ struct Instro : Module {
     stk::Whistle whistle = stk::Whistle();
     stk::Wurley wurley = stk::Wurley();
 
+    // Optional guitar body, convolved onto the Guitar voice's output
+    ConvolverLoader guitarBody;
+    Convolver *guitarBodyConvolver = NULL;
+
     Instro() {
 
         config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
@@ -179,6 +156,22 @@ struct Instro : Module {
         configParam(Instro::PARAM_4, 0, 128, 1, "Param 4");
     }
 
+    ~Instro() {
+        delete guitarBodyConvolver;
+    }
+
+    json_t *dataToJson() override {
+        json_t *rootJ = json_object();
+        json_object_set_new(rootJ, "guitar_body", json_string(guitarBody.getPath().c_str()));
+        return rootJ;
+    }
+
+    void dataFromJson(json_t *rootJ) override {
+        json_t *bodyJ = json_object_get(rootJ, "guitar_body");
+        if (bodyJ && json_string_value(bodyJ)[0])
+            guitarBody.load(json_string_value(bodyJ));
+    }
+
     // Pitchies
     float referenceFrequency = 261.626; // C4; frequency at which Rack 1v/octave CVs are zero.
     float referenceSemitone = 60.0; // C4; value of C4 in semitones is arbitrary here, so have it match midi note numbers when rounded to integer.
@@ -452,6 +445,13 @@ struct Instro : Module {
                 }
             }
             processed = guitar.tick( );
+            guitarBody.setSampleRate(args.sampleRate);
+            if (Convolver *ready = guitarBody.take()) {
+                guitarBody.retire(guitarBodyConvolver);
+                guitarBodyConvolver = ready;
+            }
+            if (guitarBodyConvolver && !guitarBodyConvolver->empty())
+                processed = guitarBodyConvolver->process(processed);
             voice_display = "Guitar";
         } else if (instrument_choice == 11){
             // Control
@@ -770,6 +770,46 @@ struct InstroWidget : ModuleWidget {
     addOutput(createOutput<PJ301MPort>(Vec(112.5, 320), module, Instro::RIGHT_OUTPUT));
     }
 
+  void appendContextMenu(Menu *menu) override {
+    Instro *module = dynamic_cast<Instro *>(this->module);
+
+    struct BodyItem : MenuItem
+    {
+        Instro *module;
+        void onAction(const event::Action &e) override
+        {
+            osdialog_filters *filters = osdialog_filters_parse("WAV:wav,WAV");
+            char *path = osdialog_file(OSDIALOG_OPEN, NULL, NULL, filters);
+            osdialog_filters_free(filters);
+            if (path) {
+                module->guitarBody.load(path);
+                free(path);
+            }
+        }
+    };
+
+    struct ClearBodyItem : MenuItem
+    {
+        Instro *module;
+        void onAction(const event::Action &e) override
+        {
+            module->guitarBody.load("");
+        }
+    };
+
+    menu->addChild(new MenuEntry);
+
+    BodyItem *bodyItem = createMenuItem<BodyItem>("Guitar body impulse response...");
+    bodyItem->module = module;
+    menu->addChild(bodyItem);
+
+    if (!module->guitarBody.getPath().empty()) {
+        ClearBodyItem *clearItem = createMenuItem<ClearBodyItem>("Clear guitar body");
+        clearItem->module = module;
+        menu->addChild(clearItem);
+    }
+  }
+
 };
 
 Model *modelInstro = createModel<Instro, InstroWidget>("Instro");
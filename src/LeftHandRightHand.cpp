@@ -1,6 +1,7 @@
 #include "plugin.hpp"
 #include <algorithm>
 #include "RJModules.hpp"
+#include "UI.hpp"
 #include "common.hpp"
 #include "dsp/digital.hpp"
 #include <iostream>
@@ -13,43 +14,12 @@
 Display
 */
 
-struct LeftHandRightHandSmallStringDisplayWidget : TransparentWidget {
-
-  std::string *value;
-  std::shared_ptr<Font> font;
-
-  void draw(NVGcontext *vg) override
-  {
-
-    // Shadow
-    NVGcolor backgroundColorS = nvgRGB(0xA0, 0xA0, 0xA0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y + 2.0, 4.0);
-    nvgFillColor(vg, backgroundColorS);
-    nvgFill(vg);
-
-    // Background
-    NVGcolor backgroundColor = nvgRGB(0xC0, 0xC0, 0xC0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
-    nvgFillColor(vg, backgroundColor);
-    nvgFill(vg);
-
-    // text
-    std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, "res/Pokemon.ttf"));
-    if (font) {
-    nvgFontSize(vg, 20);
-    nvgFontFaceId(vg, font->handle);
-    nvgTextLetterSpacing(vg, 0.4);
-    }
-
-    std::stringstream to_display;
-    to_display << std::setw(3) << *value;
-
-    Vec textPos = Vec(6.0f, 24.0f);
-    NVGcolor textColor = nvgRGB(0x00, 0x00, 0x00);
-    nvgFillColor(vg, textColor);
-    nvgText(vg, textPos.x, textPos.y, to_display.str().c_str(), NULL);
+struct LeftHandRightHandSmallStringDisplayWidget : RJStringDisplay {
+  LeftHandRightHandSmallStringDisplayWidget() {
+    shadow = true;
+    fontSize = 20;
+    letterSpacing = 0.4;
+    textPos = Vec(6.0f, 24.0f);
   }
 };
 
@@ -25,6 +25,23 @@ LentPitShift::LentPitShift( StkFloat periodRatio, int tMax )
 	dpt = new StkFloat[tMax+1];    // Allocation of the pitch tracking function coefficient array
 	dpt[0]   = 1.;                 // Initialization of the first coefficient of dpt which is always the same
 
+	// FFT pitch tracker, the correlation of one frame against two frames of history fits in 2*tMax without wrapping
+	fftSize_ = 1;
+	while ( fftSize_ < 2 * tMax_ )
+		fftSize_ <<= 1;
+	history_ = new StkFloat[2*tMax_];
+	energy_ = new StkFloat[2*tMax_+1];
+	fftRe_ = new StkFloat[fftSize_];
+	fftIm_ = new StkFloat[fftSize_];
+	corrRe_ = new StkFloat[fftSize_];
+	corrIm_ = new StkFloat[fftSize_];
+	cosTable_ = new StkFloat[fftSize_/2];
+	sinTable_ = new StkFloat[fftSize_/2];
+	for ( unsigned long k=0; k<fftSize_/2; k++ ) {
+		cosTable_[k] = cos( TWO_PI * k / fftSize_ );
+		sinTable_[k] = sin( TWO_PI * k / fftSize_ );
+	}
+
 	// Initialisation of the input and output delay lines
 	inputLine_.setMaximumDelay( 3 * tMax_ );
 	// The delay is choosed such as the coefficients are not read before being finalised.
@@ -28,6 +28,14 @@ class LentPitShift : public Effect
     delete dt;
     delete dpt;
     delete cumDt;
+    delete [] history_;
+    delete [] energy_;
+    delete [] fftRe_;
+    delete [] fftIm_;
+    delete [] corrRe_;
+    delete [] corrIm_;
+    delete [] cosTable_;
+    delete [] sinTable_;
   }
 
   //! Reset and clear all internal state.
@@ -70,6 +78,19 @@ class LentPitShift : public Effect
   */
   void process( );
 
+  //! Compute the dt coefficients of the last frame.
+  /*!
+    The squared difference sum_n (x[n] - x[n-T])^2 is expanded into
+    two energy terms, taken from a running sum, and a cross term,
+    taken from one FFT correlation of the frame against the last
+    2 * tMax_ inputs.  This is O(tMax_ log tMax_) instead of the
+    O(tMax_^2) direct loop.
+  */
+  void differenceFunction( );
+
+  //! In-place radix-2 complex FFT of length fftSize_.
+  void fft( StkFloat *re, StkFloat *im );
+
   // Frame storage vectors for process function
   StkFrames inputFrames;
   StkFrames outputFrames;
@@ -100,6 +121,17 @@ class LentPitShift : public Effect
   double periodRatio_; // Ratio of modification of the signal period
   StkFrames zeroFrame; // Frame of tMax_ zero samples
 
+  // FFT pitch tracker storage
+  unsigned long fftSize_; // Smallest power of two >= 2 * tMax_
+  StkFloat* history_;  // The last 2 * tMax_ inputs, oldest first
+  StkFloat* energy_;   // Running sum of history_ squared
+  StkFloat* fftRe_;
+  StkFloat* fftIm_;
+  StkFloat* corrRe_;
+  StkFloat* corrIm_;
+  StkFloat* cosTable_;
+  StkFloat* sinTable_;
+
 
   // Coefficient delay line that could be used for a dynamic calculation of the pitch
   //Delay* coeffLine_;
@@ -108,10 +140,6 @@ class LentPitShift : public Effect
 
 inline void LentPitShift::process()
 {
-  StkFloat x_t;    // input coefficient
-  StkFloat x_t_T;  // previous input coefficient at T samples
-  StkFloat coeff;  // new coefficient for the difference function
-
   unsigned long alternativePitch = tMax_;  // Global minimum storage
   lastPeriod_ = tMax_+1;         // Storage of the lowest local minimum under the threshold
 
@@ -119,22 +147,13 @@ inline void LentPitShift::process()
   unsigned long delay_;
   unsigned int n;
 
-  // Initialization of the dt coefficients.  Since the
-  // frames are of tMax_ length, there is no overlapping
-  // between the successive windows where pitch tracking
-  // is performed.
-  for ( delay_=1; delay_<=tMax_; delay_++ )
-    dt[delay_] = 0.;
-
-  // Calculation of the dt coefficients and update of the input delay line.
-  for ( n=0; n<inputFrames.size(); n++ ) {
-    x_t = inputLine_.tick( inputFrames[ n ] );
-    for ( delay_=1; delay_<= tMax_; delay_++ ) {
-      x_t_T = inputLine_.tapOut( delay_ );
-      coeff = x_t - x_t_T;
-      dt[delay_] += coeff * coeff;
-    }
-  }
+  // Update of the input delay line and calculation of the dt
+  // coefficients.  Since the frames are of tMax_ length, there is
+  // no overlapping between the successive windows where pitch
+  // tracking is performed.
+  for ( n=0; n<inputFrames.size(); n++ )
+    inputLine_.tick( inputFrames[ n ] );
+  differenceFunction();
 
   // Calculation of the pitch tracking function and test for the minima.
   for ( delay_=1; delay_<=tMax_; delay_++ ) {
@@ -203,6 +222,88 @@ inline void LentPitShift::process()
 }
 
 
+inline void LentPitShift :: fft( StkFloat *re, StkFloat *im )
+{
+  unsigned long i, j, len, half, k, step;
+  StkFloat wr, wi, ur, ui, vr, vi, tmp;
+
+  // Bit reversal permutation
+  for ( i=1, j=0; i<fftSize_; i++ ) {
+    unsigned long bit = fftSize_ >> 1;
+    for ( ; j & bit; bit >>= 1 )
+      j ^= bit;
+    j ^= bit;
+    if ( i < j ) {
+      tmp = re[i]; re[i] = re[j]; re[j] = tmp;
+      tmp = im[i]; im[i] = im[j]; im[j] = tmp;
+    }
+  }
+
+  // Butterflies
+  for ( len=2; len<=fftSize_; len<<=1 ) {
+    half = len >> 1;
+    step = fftSize_ / len;
+    for ( i=0; i<fftSize_; i+=len ) {
+      for ( k=0; k<half; k++ ) {
+        wr = cosTable_[k*step];
+        wi = -sinTable_[k*step];
+        ur = re[i+k];
+        ui = im[i+k];
+        vr = re[i+k+half] * wr - im[i+k+half] * wi;
+        vi = re[i+k+half] * wi + im[i+k+half] * wr;
+        re[i+k] = ur + vr;
+        im[i+k] = ui + vi;
+        re[i+k+half] = ur - vr;
+        im[i+k+half] = ui - vi;
+      }
+    }
+  }
+}
+
+inline void LentPitShift :: differenceFunction( )
+{
+  unsigned long N = tMax_;
+  unsigned long n, k, j;
+
+  // history_[m] is the input 2N-1-m samples ago, the frame we
+  // just received sits in history_[N..2N)
+  energy_[0] = 0.;
+  for ( n=0; n<2*N; n++ ) {
+    history_[n] = inputLine_.tapOut( 2*N-1-n );
+    energy_[n+1] = energy_[n] + history_[n] * history_[n];
+  }
+
+  // One complex FFT carries both real sequences: the frame in the
+  // real part, the whole history in the imaginary part
+  for ( n=0; n<fftSize_; n++ ) {
+    fftRe_[n] = ( n < N ) ? history_[N+n] : 0.;
+    fftIm_[n] = ( n < 2*N ) ? history_[n] : 0.;
+  }
+  fft( fftRe_, fftIm_ );
+
+  // Split the two spectra and form conj(A) * B, conjugated again so
+  // the forward transform below does the inverse
+  for ( k=0; k<fftSize_; k++ ) {
+    j = ( fftSize_ - k ) & ( fftSize_ - 1 );
+    StkFloat ar = ( fftRe_[k] + fftRe_[j] ) / 2.;
+    StkFloat ai = ( fftIm_[k] - fftIm_[j] ) / 2.;
+    StkFloat br = ( fftIm_[k] + fftIm_[j] ) / 2.;
+    StkFloat bi = -( fftRe_[k] - fftRe_[j] ) / 2.;
+    corrRe_[k] = ar * br + ai * bi;
+    corrIm_[k] = -( ar * bi - ai * br );
+  }
+  fft( corrRe_, corrIm_ );
+
+  // corrRe_[N-T] / fftSize_ = sum_n frame[n] * history[N+n-T]
+  StkFloat frameEnergy = energy_[2*N] - energy_[N];
+  for ( unsigned long T=1; T<=N; T++ ) {
+    StkFloat lagEnergy = energy_[2*N-T] - energy_[N-T];
+    StkFloat cross = corrRe_[N-T] / fftSize_;
+    StkFloat d = frameEnergy + lagEnergy - 2. * cross;
+    dt[T] = d > 0. ? d : 0.;
+  }
+}
+
 inline StkFloat LentPitShift :: tick( StkFloat input )
 {
   StkFloat sample;
@@ -1,4 +1,5 @@
 #include "RJModules.hpp"
+#include "UI.hpp"
 #include "dsp/digital.hpp"
 #include "plugin.hpp"
 #include <iostream>
@@ -8,170 +9,74 @@
 
 using simd::float_4;
 
-// CV
-class CV {
-public:
-    CV (float threshold) {
-        this->threshold = threshold;
-        this->reset();
-        }
-
-        bool newTrigger ( ) {
-        // check to see if this is a status change, if so reset the states and return true
-        if (this->triggered == true && this->lastTriggered == false) {
-          this->lastTriggered = true;
-
-          return true;
-        }
-
-        this->lastTriggered = this->triggered;
-
-        return false;
-    }
-
-    void update (float current) {
-        // set the last value to whatever the current value is
-        this->lastValue = current;
-
-        // increase the trigger interval count
-        this->triggerIntervalCount++;
-
-        // check the threshold, if it meets or is greater, then we make a change
-        if (current >= this->threshold) {
-          if (this->triggered == false) {
-            this->triggered = true;
-
-            // increment the total number of triggers fired
-            this->triggerCount++;
-
-            // set the last trigger interval to the interval
-            this->lastTriggerInterval = this->triggerIntervalCount;
-
-            // reset the count to 0
-            this->triggerIntervalCount = 0;
-          }
-        } else {
-          this->triggered = false;
-        }
-    }
-
-    bool isHigh ( ) {
-        return this->triggered;
-    }
+static const int MEGADIVIDER_COUNT = 8 * 8;
+static const float MEGADIVIDER_THRESHOLD = 1.7f;
 
-    bool isLow ( ) {
-        return !this->triggered;
-    }
-
-    void reset ( ) {
-        this->triggered = false;
-        this->lastTriggered = false;
-        this->lastValue = 0;
-        this->triggerCount = 0;
-        this->triggerIntervalCount = 0;
-        this->lastTriggerInterval = 0;
-    }
-
-    float currentValue ( ) {
-        return this->lastValue;
-    }
-
-    uint32_t triggerInterval ( ) {
-        return this->lastTriggerInterval;
-    }
-
-    uint32_t triggerTotal ( ) {
-        return this->triggerCount;
-    }
-protected:
-  bool triggered;
-  bool lastTriggered;
-  uint32_t triggerCount;
-private:
-  float threshold;
-  float lastValue;
-  uint32_t triggerIntervalCount;
-  uint32_t lastTriggerInterval;
-
-};
-
-// CLOCK
-#define CLOCK_LIMIT 1024 * 8
-#define CLK_ERROR_TOO_MANY 1
-class Clock {
-public:
-    Clock (uint16_t count, float threshold) {
-        if (count > CLOCK_LIMIT) {
-          throw CLK_ERROR_TOO_MANY;
-        }
-
-        triggerThreshold = threshold;
-        triggerCount = count;
-        current = 0;
-        ready = false;
-        step = 0;
-
-        cv = new CV(threshold);
+/*
+    Sixty four clock dividers (/1 to /64) driven by one clock. The counters
+    only move on clock edges and the gates are kept as one bit per divider.
 
-        for (uint16_t i = 0; i < CLOCK_LIMIT; i++) {
-          states[i] = false;
-        }
+    Edges are located between samples by interpolating the crossing of the
+    threshold, so the measured clock period (and the half period gate
+    length that follows from it) doesn't jitter by a sample at high BPM.
+*/
+struct MegaDividerClock {
+    uint8_t counters[MEGADIVIDER_COUNT] = {};
+    uint64_t states = 0;
+    bool armed = false;
+    bool high = false;
+    float last = 0.f;
+    // Samples since the last edge, and the last measured clock period
+    double sinceEdge = 0.0;
+    double period = 0.0;
+
+    void reset() {
+        for (int i = 0; i < MEGADIVIDER_COUNT; i++)
+            counters[i] = 0;
+        states = 0;
+        armed = false;
+        sinceEdge = 0.0;
+        period = 0.0;
     }
 
-    bool *update (float input) {
-        cv->update(input);
-
-        // only become ready after the first trigger has occurred.  this allows for
-        // an interval to be set up
-        if (!ready) {
-          if (cv->newTrigger()) {
-            ready = true;
-          }
-
-          return states;
+    uint64_t process(float in) {
+        sinceEdge += 1.0;
+
+        if (!high && in >= MEGADIVIDER_THRESHOLD) {
+            high = true;
+            // How far back, in samples, the input crossed the threshold
+            float rise = in - last;
+            double edgeAge = rise > 0.f ? clamp((in - MEGADIVIDER_THRESHOLD) / rise, 0.f, 1.f) : 0.0;
+
+            // The first edge only starts the period measurement
+            if (armed) {
+                // Hard edged clocks still land on whole samples, so smooth
+                // the measurement to keep the gate length from jittering
+                double measured = sinceEdge - edgeAge;
+                period = period > 0.0 ? period + (measured - period) * 0.5 : measured;
+                uint64_t fired = 0;
+                for (int i = 0; i < MEGADIVIDER_COUNT; i++) {
+                    if (++counters[i] > i) {
+                        counters[i] = 0;
+                        fired |= (uint64_t) 1 << i;
+                    }
+                }
+                states = fired;
+            }
+            armed = true;
+            sinceEdge = edgeAge;
         }
-
-        current++;
-
-        if (cv->newTrigger()) {
-          step++;
-          current = 0;
-
-          for (uint16_t i = 0; i < triggerCount; i++) {
-            states[i] = ((step % (i + 1)) == 0) ? true : false;
-          }
-        } else if (current >= cv->triggerInterval() / 2) {
-          for (uint16_t i = 0; i < triggerCount; i++) {
-            states[i] = false;
-          }
+        else if (in < MEGADIVIDER_THRESHOLD) {
+            high = false;
         }
 
-        if (step >= triggerCount) {
-          step = 0;
-        }
+        // Gates fall half a clock period after their edge
+        if (states && sinceEdge >= period * 0.5)
+            states = 0;
 
+        last = in;
         return states;
     }
-
-    void reset ( ) {
-        current = 0;
-        ready = false;
-        step = 0;
-
-        for (uint16_t i = 0; i < CLOCK_LIMIT; i++) {
-          states[i] = false;
-        }
-
-        cv->reset();
-    }
-protected:
-  CV *cv;
-  uint16_t triggerCount;
-  bool ready;
-  uint64_t current;
-  uint16_t step;
-  float triggerThreshold;
-  bool states[CLOCK_LIMIT];
 };
 
 // MODULE
@@ -205,8 +110,10 @@ struct MegaDivider: Module {
         NUM_LIGHTS
     };
 
-    Clock *clock;
-    CV *cv;
+    MegaDividerClock clock;
+    dsp::SchmittTrigger resetTrigger;
+    uint64_t lastStates = 0;
+    int poly_mode_index = 0;
 
     // Displays
     int a_display = 4;
@@ -220,16 +127,31 @@ struct MegaDivider: Module {
         configParam(MegaDivider::B_PARAM, 1, 64, 7, "Mutli B");
         configParam(MegaDivider::C_PARAM, 1, 64, 4, "Mutli C");
         configParam(MegaDivider::D_PARAM, 1, 64, 9, "Mutli D");
-        clock = new Clock(8 * 8, 1.7f);
-        cv = new CV(1.7f);
+    }
+
+    json_t *dataToJson() override {
+        json_t *rootJ = json_object();
+        json_object_set_new(rootJ, "poly", json_integer(poly_mode_index));
+        return rootJ;
+    }
+
+    void dataFromJson(json_t *rootJ) override {
+        json_t *polyJ = json_object_get(rootJ, "poly");
+        if (polyJ)
+            poly_mode_index = json_integer_value(polyJ);
+    }
+
+    // Bit for a divider in 1..64, nothing for 0
+    static uint64_t dividerBit(int division) {
+        return division >= 1 ? (uint64_t) 1 << (division - 1) : 0;
     }
 
     void process(const ProcessArgs& args) override {
 
-        int A = (int)params[A_PARAM].getValue() * clamp(inputs[A_CV].normalize(5.0f) / 5.0f, 0.0f, 1.0f);
-        int B = (int)params[B_PARAM].getValue() * clamp(inputs[B_CV].normalize(5.0f) / 5.0f, 0.0f, 1.0f);
-        int C = (int)params[C_PARAM].getValue() * clamp(inputs[C_CV].normalize(5.0f) / 5.0f, 0.0f, 1.0f);
-        int D = (int)params[D_PARAM].getValue() * clamp(inputs[D_CV].normalize(5.0f) / 5.0f, 0.0f, 1.0f);
+        int A = (int)params[A_PARAM].getValue() * clamp(inputs[A_CV].getNormalVoltage(5.0f) / 5.0f, 0.0f, 1.0f);
+        int B = (int)params[B_PARAM].getValue() * clamp(inputs[B_CV].getNormalVoltage(5.0f) / 5.0f, 0.0f, 1.0f);
+        int C = (int)params[C_PARAM].getValue() * clamp(inputs[C_CV].getNormalVoltage(5.0f) / 5.0f, 0.0f, 1.0f);
+        int D = (int)params[D_PARAM].getValue() * clamp(inputs[D_CV].getNormalVoltage(5.0f) / 5.0f, 0.0f, 1.0f);
 
         a_display = A;
         b_display = B;
@@ -240,40 +162,45 @@ struct MegaDivider: Module {
             return;
         }
 
-        float reset_in = inputs[RESET_CV].value;
-        cv->update(reset_in);
-
-        if (cv->newTrigger()) {
-            clock->reset();
+        if (resetTrigger.process(inputs[RESET_CV].getVoltage(), 0.f, MEGADIVIDER_THRESHOLD)) {
+            clock.reset();
         }
 
-        float in = inputs[CLOCK_CV].value;
-        bool *states = clock->update(in);
-
-        for (int i = 0; i < 8 * 8; i++) {
-            if (states[i] == true) {
-              outputs[CH_OUTPUT + i].value = in;
-              lights[i].value = 1.0f;
-            } else {
-              outputs[CH_OUTPUT + i].value = 0;
-              lights[i].value = 0;
+        float in = inputs[CLOCK_CV].getVoltage();
+        uint64_t states = clock.process(in);
+
+        // The outputs pass the clock through while their gate is up
+        if (poly_mode_index != 0) {
+            // Each column of eight as one eight channel cable on its top output
+            for (int column = 0; column < 8; column++) {
+                Output &output = outputs[CH_OUTPUT + column * 8];
+                output.setChannels(8);
+                for (int c = 0; c < 8; c++)
+                    output.setVoltage((states >> (column * 8 + c)) & 1 ? in : 0.f, c);
+                for (int c = 1; c < 8; c++)
+                    outputs[CH_OUTPUT + column * 8 + c].setChannels(0);
             }
         }
-
-        if (states[A - 1] || states[B - 1]){
-            outputs[MULTI_A].value = in;
-            lights[A_LIGHT].value = 1.0f;
-        } else{
-            outputs[MULTI_A].value = 0;
-            lights[A_LIGHT].value = 0.0f;
+        else {
+            for (int i = 0; i < MEGADIVIDER_COUNT; i++) {
+                outputs[CH_OUTPUT + i].setChannels(1);
+                outputs[CH_OUTPUT + i].setVoltage((states >> i) & 1 ? in : 0.f);
+            }
         }
-        if (states[C - 1] || states[D - 1]){
-            outputs[MULTI_B].value = in;
-            lights[B_LIGHT].value = 1.0f;
-        } else{
-            outputs[MULTI_B].value = 0;
-            lights[B_LIGHT].value = 0.0f;
+
+        bool multiA = states & (dividerBit(A) | dividerBit(B));
+        bool multiB = states & (dividerBit(C) | dividerBit(D));
+        outputs[MULTI_A].setVoltage(multiA ? in : 0.f);
+        outputs[MULTI_B].setVoltage(multiB ? in : 0.f);
+        lights[A_LIGHT].setBrightness(multiA ? 1.f : 0.f);
+        lights[B_LIGHT].setBrightness(multiB ? 1.f : 0.f);
+
+        // Only touch the lights whose gate changed
+        for (uint64_t changed = states ^ lastStates; changed; changed &= changed - 1) {
+            int i = __builtin_ctzll(changed);
+            lights[CH_LIGHT + i].setBrightness((states >> i) & 1 ? 1.f : 0.f);
         }
+        lastStates = states;
     }
 };
 
@@ -281,57 +208,13 @@ struct MegaDivider: Module {
 Display
 */
 
-struct MegaDividerSmallStringDisplayWidget : TransparentWidget {
-
-  MegaDivider *module;
-  bool is_a = true;
-  bool is_b = false;
-  bool is_c = false;
-  bool is_d = false;
-
-  void draw(NVGcontext *vg) override
-  {
-
-    // Shadow
-    NVGcolor backgroundColorS = nvgRGB(0xA0, 0xA0, 0xA0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y + 2.0, 4.0);
-    nvgFillColor(vg, backgroundColorS);
-    nvgFill(vg);
-
-    // Background
-    NVGcolor backgroundColor = nvgRGB(0xC0, 0xC0, 0xC0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
-    nvgFillColor(vg, backgroundColor);
-    nvgFill(vg);
-
-    // text
-    std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, "res/Pokemon.ttf"));
-    if (font) {
-    nvgFontSize(vg, 20);
-    nvgFontFaceId(vg, font->handle);
-    nvgTextLetterSpacing(vg, 0.4);
-    }
-
-    if (!module)
-        return;
-
-    std::stringstream to_display;
-    if(is_a){
-        to_display << std::setw(2) << std::to_string(module->a_display);
-    } else if (is_b){
-        to_display << std::setw(2) << std::to_string(module->b_display);
-    } else if (is_c){
-        to_display << std::setw(2) << std::to_string(module->c_display);
-    } else if (is_d){
-        to_display << std::setw(2) << std::to_string(module->d_display);
-    }
-
-    Vec textPos = Vec(6.0f, 24.0f);
-    NVGcolor textColor = nvgRGB(0x00, 0x00, 0x00);
-    nvgFillColor(vg, textColor);
-    nvgText(vg, textPos.x, textPos.y, to_display.str().c_str(), NULL);
+struct MegaDividerSmallStringDisplayWidget : RJIntegerDisplay {
+  MegaDividerSmallStringDisplayWidget() {
+    width = 2;
+    shadow = true;
+    fontSize = 20;
+    letterSpacing = 0.4;
+    textPos = Vec(6.0f, 24.0f);
   }
 };
 
@@ -368,11 +251,7 @@ struct MegaDividerWidget: ModuleWidget {
             MegaDividerSmallStringDisplayWidget *a_Display = new MegaDividerSmallStringDisplayWidget();
             a_Display->box.pos = Vec(108, 36);
             a_Display->box.size = Vec(33, 33);
-            a_Display->module = module;
-            a_Display->is_a = true;
-            a_Display->is_b = false;
-            a_Display->is_c = false;
-            a_Display->is_d = false;
+            a_Display->value = &module->a_display;
             addChild(a_Display);
         }
         addParam(createParam<MegaDividerRoundSmallBlackKnob>(Vec(145, 40), module, MegaDivider::A_PARAM));
@@ -382,11 +261,7 @@ struct MegaDividerWidget: ModuleWidget {
             MegaDividerSmallStringDisplayWidget *b_Display = new MegaDividerSmallStringDisplayWidget();
             b_Display->box.pos = Vec(200, 36);
             b_Display->box.size = Vec(33, 33);
-            b_Display->module = module;
-            b_Display->is_a = false;
-            b_Display->is_b = true;
-            b_Display->is_c = false;
-            b_Display->is_d = false;
+            b_Display->value = &module->b_display;
             addChild(b_Display);
         }
 
@@ -401,11 +276,7 @@ struct MegaDividerWidget: ModuleWidget {
             MegaDividerSmallStringDisplayWidget *c_Display = new MegaDividerSmallStringDisplayWidget();
             c_Display->box.pos = Vec(108, 36 + ROW_TWO);
             c_Display->box.size = Vec(33, 33);
-            c_Display->module = module;
-            c_Display->is_a = false;
-            c_Display->is_b = false;
-            c_Display->is_c = true;
-            c_Display->is_d = false;
+            c_Display->value = &module->c_display;
             addChild(c_Display);
         }
         addParam(createParam<MegaDividerRoundSmallBlackKnob>(Vec(145, 40 + ROW_TWO), module, MegaDivider::C_PARAM));
@@ -415,11 +286,7 @@ struct MegaDividerWidget: ModuleWidget {
             MegaDividerSmallStringDisplayWidget *d_Display = new MegaDividerSmallStringDisplayWidget();
             d_Display->box.pos = Vec(200, 36 + ROW_TWO);
             d_Display->box.size = Vec(33, 33);
-            d_Display->module = module;
-            d_Display->is_a = false;
-            d_Display->is_b = false;
-            d_Display->is_c = false;
-            d_Display->is_d = true;
+            d_Display->value = &module->d_display;
             addChild(d_Display);
         }
 
@@ -464,6 +331,18 @@ struct MegaDividerWidget: ModuleWidget {
         }
     }
 
+    void appendContextMenu(Menu *menu) override
+    {
+        MegaDivider *module = dynamic_cast<MegaDivider *>(this->module);
+
+        menu->addChild(new MenuEntry);
+
+        RJChoiceItem *polyItem = createMenuItem<RJChoiceItem>("Poly Mode", ">");
+        polyItem->target = &module->poly_mode_index;
+        polyItem->labels = {"Mono Outs", "Each Column on its Top Output"};
+        menu->addChild(polyItem);
+    }
+
 };
 
 Model *modelMegaDivider = createModel<MegaDivider, MegaDividerWidget>("MegaDivider");
@@ -0,0 +1,329 @@
+/*
+MeshDrum - polyphonic 2D waveguide mesh percussion.
+
+The mesh is stk::Mesh2D's rectilinear waveguide mesh, rewritten in float so
+it can grow to 64x64 junctions. Each wave variable is stored row by row
+(x major, y contiguous) with padded rows, so the junction update runs four
+y positions at a time in float_4, and the filtered x edge does too.
+
+Every channel of the trigger input strikes its own mesh. A mesh measures its
+energy (as Mesh2D::energy() does) every MESHDRUM_ENERGY_CHECK samples and
+goes to sleep once it has rung out, so silent voices cost nothing. A strike
+leaves part of its energy in a mode that never reaches the lossy edges or
+the output, so "rung out" means the energy has stopped draining and the
+output has gone quiet, not that the energy reached zero. Right after a
+strike the wave is still scattering inside the mesh, losing nothing and not
+yet at the output, so a mesh can't sleep until 2 * (nx + ny) ticks after
+its last strike, which is time for the wave to cross it both ways.
+
+The size knobs are read when a silent mesh is struck, so a mesh keeps its
+size until it has rung out. The POSITION input adds the same offset to
+both strike coordinates, moving the strike along the diagonal.
+*/
+
+#include "RJModules.hpp"
+#include "UI.hpp"
+#include <iostream>
+#include <cmath>
+
+using simd::float_4;
+
+static const int MESHDRUM_MAX = 64;
+// Room for the y + 1 reads and writes of the last vector in a row
+static const int MESHDRUM_STRIDE = MESHDRUM_MAX + 4;
+static const int MESHDRUM_VOICES = 16;
+static const int MESHDRUM_ENERGY_CHECK = 128;
+// Relative energy loss per check, and output peak, below which a mesh sleeps
+static const float MESHDRUM_SLEEP_DRAIN = 1e-5f;
+static const float MESHDRUM_SLEEP_LEVEL = 1e-6f;
+
+struct MeshDrumRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    MeshDrumRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+// One set of the four wave variables, indexed [x][y]
+struct MeshDrumWaves {
+    alignas(16) float xp[MESHDRUM_MAX][MESHDRUM_STRIDE];
+    alignas(16) float xm[MESHDRUM_MAX][MESHDRUM_STRIDE];
+    alignas(16) float yp[MESHDRUM_MAX][MESHDRUM_STRIDE];
+    alignas(16) float ym[MESHDRUM_MAX][MESHDRUM_STRIDE];
+};
+
+struct MeshDrumMesh {
+    // Read from waves[counter & 1], written to the other, like tick0()/tick1()
+    MeshDrumWaves waves[2];
+    alignas(16) float filterY[MESHDRUM_STRIDE];
+    float filterX[MESHDRUM_MAX];
+    // Zero for the lanes of the last vector that fall past NY - 2
+    float_4 tailMask;
+    int nx = 12;
+    int ny = 12;
+    int chunks = 3;
+    // A single corner pickup gets quieter as the mesh grows
+    float level = 1.f;
+    unsigned int counter = 0;
+    bool awake = false;
+    float lastEnergy = 0.f;
+    float peak = 0.f;
+    // counter at the last strike
+    unsigned int struck = 0;
+
+    MeshDrumMesh() {
+        // Padding stays zero from here on, the updates only ever copy zeros into it
+        memset(waves, 0, sizeof(waves));
+        memset(filterY, 0, sizeof(filterY));
+        memset(filterX, 0, sizeof(filterX));
+    }
+
+    // The size doesn't change while the mesh rings, so only its first nx
+    // rows can hold anything
+    void clear() {
+        for (int w = 0; w < 2; w++) {
+            memset(waves[w].xp, 0, nx * sizeof(waves[w].xp[0]));
+            memset(waves[w].xm, 0, nx * sizeof(waves[w].xm[0]));
+            memset(waves[w].yp, 0, nx * sizeof(waves[w].yp[0]));
+            memset(waves[w].ym, 0, nx * sizeof(waves[w].ym[0]));
+        }
+        memset(filterY, 0, sizeof(filterY));
+        memset(filterX, 0, sizeof(filterX));
+        counter = 0;
+        lastEnergy = 0.f;
+        peak = 0.f;
+        struck = 0;
+    }
+
+    void setSize(int x, int y) {
+        nx = clamp(x, 2, MESHDRUM_MAX);
+        ny = clamp(y, 2, MESHDRUM_MAX);
+        chunks = (ny - 1 + 3) / 4;
+        level = std::max(1.f, (nx + ny) / 24.f);
+        int valid = (ny - 1) - (chunks - 1) * 4;
+        tailMask = float_4(valid > 0 ? 1.f : 0.f, valid > 1 ? 1.f : 0.f, valid > 2 ? 1.f : 0.f, valid > 3 ? 1.f : 0.f);
+    }
+
+    // Mesh2D::noteOn at (xFactor, yFactor)
+    void strike(float xFactor, float yFactor, float amplitude) {
+        int x = (int) (clamp(xFactor, 0.f, 1.f) * (nx - 1));
+        int y = (int) (clamp(yFactor, 0.f, 1.f) * (ny - 1));
+        MeshDrumWaves &a = waves[counter & 1];
+        a.xp[x][y] += amplitude;
+        a.yp[x][y] += amplitude;
+        awake = true;
+        lastEnergy = energy();
+        peak = 0.f;
+        struck = counter;
+    }
+
+    // Mesh2D::energy() for the buffer about to be read
+    float energy() {
+        MeshDrumWaves &a = waves[counter & 1];
+        float_4 e = 0.f;
+        for (int x = 0; x < nx; x++) {
+            for (int c = 0; c < (ny + 3) / 4; c++) {
+                int y = c * 4;
+                float_4 t = float_4::load(&a.xp[x][y]);
+                e += t * t;
+                t = float_4::load(&a.xm[x][y]);
+                e += t * t;
+                t = float_4::load(&a.yp[x][y]);
+                e += t * t;
+                t = float_4::load(&a.ym[x][y]);
+                e += t * t;
+            }
+        }
+        return e[0] + e[1] + e[2] + e[3];
+    }
+
+    // Called every MESHDRUM_ENERGY_CHECK ticks, false once the mesh has rung out
+    bool ringing() {
+        float e = energy();
+        bool draining = lastEnergy - e > MESHDRUM_SLEEP_DRAIN * lastEnergy;
+        bool audible = peak > MESHDRUM_SLEEP_LEVEL;
+        bool settling = counter - struck < (unsigned int) (2 * (nx + ny));
+        lastEnergy = e;
+        peak = 0.f;
+        return draining || audible || settling;
+    }
+
+    // One Mesh2D::tick0()/tick1(). `gain` and `pole` are the edge OnePole's.
+    float tick(float gain, float pole) {
+        MeshDrumWaves &a = waves[counter & 1];
+        MeshDrumWaves &b = waves[(counter & 1) ^ 1];
+        counter++;
+
+        // Junction velocities and outgoing waves, four y positions at a time
+        for (int x = 0; x < nx - 1; x++) {
+            for (int c = 0; c < chunks; c++) {
+                int y = c * 4;
+                float_4 v = (float_4::load(&a.xp[x][y]) + float_4::load(&a.xm[x + 1][y]) +
+                    float_4::load(&a.yp[x][y]) + float_4::load(&a.ym[x][y + 1])) * 0.5f;
+                if (c == chunks - 1)
+                    v *= tailMask;
+                (v - float_4::load(&a.xm[x + 1][y])).store(&b.xp[x + 1][y]);
+                (v - float_4::load(&a.ym[x][y + 1])).store(&b.yp[x][y + 1]);
+                (v - float_4::load(&a.xp[x][y])).store(&b.xm[x][y]);
+                (v - float_4::load(&a.yp[x][y])).store(&b.ym[x][y]);
+            }
+        }
+
+        // Edge reflections, filtered on one x and one y edge
+        float_4 g = gain * (1.f - pole);
+        for (int c = 0; c < chunks; c++) {
+            int y = c * 4;
+            float_4 f = g * float_4::load(&a.xm[0][y]) + pole * float_4::load(&filterY[y]);
+            if (c == chunks - 1)
+                f *= tailMask;
+            f.store(&filterY[y]);
+            f.store(&b.xp[0][y]);
+        }
+        for (int y = 0; y < ny - 1; y++)
+            b.xm[nx - 1][y] = a.xp[nx - 1][y];
+        for (int x = 0; x < nx - 1; x++) {
+            filterX[x] = gain * (1.f - pole) * a.ym[x][0] + pole * filterX[x];
+            b.yp[x][0] = filterX[x];
+            b.ym[x][ny - 1] = a.yp[x][ny - 1];
+        }
+
+        // Sum of outgoing waves at the far corner
+        float out = a.xp[nx - 1][ny - 2] + a.yp[nx - 2][ny - 1];
+        peak = std::max(peak, std::fabs(out));
+        return out * level;
+    }
+};
+
+struct MeshDrum: Module {
+    enum ParamIds {
+        SIZE_X_PARAM,
+        SIZE_Y_PARAM,
+        DECAY_PARAM,
+        POSITION_X_PARAM,
+        POSITION_Y_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        TRIG_INPUT,
+        VELOCITY_INPUT,
+        POSITION_INPUT,
+        DECAY_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        OUT_OUTPUT,
+        MIX_OUTPUT,
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        ACTIVE_LIGHT,
+        NUM_LIGHTS
+    };
+
+    // Meshes are large, so they live on the heap, all made up front
+    std::vector<MeshDrumMesh *> meshes;
+    dsp::SchmittTrigger triggers[MESHDRUM_VOICES];
+    int energyCounter = 0;
+    dsp::ClockDivider lightDivider;
+
+    MeshDrum() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(MeshDrum::SIZE_X_PARAM, 2.0, 64.0, 12.0, "Width", " junctions");
+        configParam(MeshDrum::SIZE_Y_PARAM, 2.0, 64.0, 12.0, "Height", " junctions");
+        configParam(MeshDrum::DECAY_PARAM, 0.0, 1.0, 0.9, "Decay", "%", 0, 100);
+        configParam(MeshDrum::POSITION_X_PARAM, 0.0, 1.0, 0.0, "Strike X", "%", 0, 100);
+        configParam(MeshDrum::POSITION_Y_PARAM, 0.0, 1.0, 0.0, "Strike Y", "%", 0, 100);
+        lightDivider.setDivision(512);
+        for (int c = 0; c < MESHDRUM_VOICES; c++)
+            meshes.push_back(new MeshDrumMesh());
+    }
+
+    ~MeshDrum() {
+        for (MeshDrumMesh *mesh : meshes)
+            delete mesh;
+    }
+
+    void process(const ProcessArgs& args) override {
+        int channels = std::max(1, inputs[TRIG_INPUT].getChannels());
+        // Mesh2D::controlChange(11) range
+        float decay = clamp(params[DECAY_PARAM].getValue() + inputs[DECAY_INPUT].getVoltage() / 10.f, 0.f, 1.f);
+        float gain = std::min(0.9f + decay * 0.1f, 0.9999f);
+        bool checkEnergy = ++energyCounter >= MESHDRUM_ENERGY_CHECK;
+        if (checkEnergy)
+            energyCounter = 0;
+
+        outputs[OUT_OUTPUT].setChannels(channels);
+        float mix = 0.f;
+        int active = 0;
+        for (int c = 0; c < channels; c++) {
+            if (triggers[c].process(inputs[TRIG_INPUT].getPolyVoltage(c))) {
+                MeshDrumMesh *mesh = meshes[c];
+                // Only a silent mesh takes the new size, changing it mid ring would leave stray waves
+                if (!mesh->awake)
+                    mesh->setSize((int) roundf(params[SIZE_X_PARAM].getValue()), (int) roundf(params[SIZE_Y_PARAM].getValue()));
+                float velocity = inputs[VELOCITY_INPUT].isConnected() ? clamp(inputs[VELOCITY_INPUT].getPolyVoltage(c) / 10.f, 0.f, 1.f) : 1.f;
+                // One CV for both coordinates, along the diagonal
+                float offset = inputs[POSITION_INPUT].getPolyVoltage(c) / 10.f;
+                mesh->strike(params[POSITION_X_PARAM].getValue() + offset, params[POSITION_Y_PARAM].getValue() + offset, velocity);
+            }
+
+            MeshDrumMesh *mesh = meshes[c];
+            float out = 0.f;
+            if (mesh->awake) {
+                out = mesh->tick(gain, 0.05f);
+                if (checkEnergy && !mesh->ringing()) {
+                    mesh->awake = false;
+                    mesh->clear();
+                }
+                active++;
+            }
+            out *= 5.f;
+            outputs[OUT_OUTPUT].setVoltage(out, c);
+            mix += out;
+        }
+        outputs[MIX_OUTPUT].setVoltage(mix);
+
+        if (lightDivider.process())
+            lights[ACTIVE_LIGHT].setBrightness((float) active / channels);
+    }
+};
+
+
+struct MeshDrumWidget: ModuleWidget {
+    MeshDrumWidget(MeshDrum *module);
+};
+
+MeshDrumWidget::MeshDrumWidget(MeshDrum *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/MeshDrum.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    addParam(createParam<MeshDrumRoundLargeBlackKnob>(Vec(14, 50), module, MeshDrum::SIZE_X_PARAM));
+    addParam(createParam<MeshDrumRoundLargeBlackKnob>(Vec(88, 50), module, MeshDrum::SIZE_Y_PARAM));
+    addParam(createParam<MeshDrumRoundLargeBlackKnob>(Vec(14, 125), module, MeshDrum::POSITION_X_PARAM));
+    addParam(createParam<MeshDrumRoundLargeBlackKnob>(Vec(88, 125), module, MeshDrum::POSITION_Y_PARAM));
+    addParam(createParam<MeshDrumRoundLargeBlackKnob>(Vec(51, 195), module, MeshDrum::DECAY_PARAM));
+    addChild(createLight<MediumLight<GreenLight>>(Vec(70, 260), module, MeshDrum::ACTIVE_LIGHT));
+
+    addInput(createInput<PJ301MPort>(Vec(10, 280), module, MeshDrum::TRIG_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(45, 280), module, MeshDrum::VELOCITY_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(80, 280), module, MeshDrum::POSITION_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(112.5, 280), module, MeshDrum::DECAY_INPUT));
+
+    addOutput(createOutput<PJ301MPort>(Vec(45, 320), module, MeshDrum::OUT_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(80, 320), module, MeshDrum::MIX_OUTPUT));
+}
+
+Model *modelMeshDrum = createModel<MeshDrum, MeshDrumWidget>("MeshDrum");
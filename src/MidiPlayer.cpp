@@ -0,0 +1,678 @@
+/*
+MidiPlayer - plays Standard MIDI Files as polyphonic V/Oct, gate and velocity.
+
+A worker thread reads the file once through stk::MidiFileIn, resolves every
+note on and off against the tempo map into seconds, and stamps the result
+at the engine sample rate into one flat, time sorted event array. The array
+is handed to the audio thread through an atomic pointer, so process() only
+advances a playhead and a cursor into the array, never parsing anything.
+
+With a clock patched, the playhead runs at clock tempo / file tempo, and
+stops when the clock does.
+*/
+
+#include "RJModules.hpp"
+#include "UI.hpp"
+#include "osdialog.h"
+#include "MidiFileIn.h"
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+static const int MIDIPLAYER_MAX_VOICES = 16;
+static const int MIDIPLAYER_POLYPHONY[] = { 1, 4, 8, 16 };
+static const int MIDIPLAYER_PPQN[] = { 1, 2, 4, 24 };
+
+struct MidiPlayerRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    MidiPlayerRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+// A note on (velocity > 0) or off, in seconds from the start of the file
+struct MidiPlayerNote {
+    double time;
+    uint8_t channel;
+    uint8_t note;
+    uint8_t velocity;
+};
+
+// The same note, in samples at the rate the song was stamped for
+struct MidiPlayerEvent {
+    uint32_t frame;
+    uint8_t channel;
+    uint8_t note;
+    uint8_t velocity;
+};
+
+struct MidiPlayerSong {
+    std::vector<MidiPlayerEvent> events;
+    uint32_t length = 0;
+    float sampleRate = 44100.f;
+    float bpm = 120.f;
+    // Which load this came from, a restamp keeps the playhead
+    int file = 0;
+};
+
+struct MidiPlayer: Module {
+    enum ParamIds {
+        PLAY_PARAM,
+        SEEK_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        PLAY_INPUT,
+        RESET_INPUT,
+        SEEK_INPUT,
+        CLOCK_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        VOCT_OUTPUT,
+        GATE_OUTPUT,
+        VELOCITY_OUTPUT,
+        EOC_OUTPUT,
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        PLAY_LIGHT,
+        NUM_LIGHTS
+    };
+
+    // Worker -> audio thread. The audio thread swaps `pending` into `song`
+    // and hands the old one back through `retired` for the worker to free,
+    // and won't take another until the worker has.
+    std::atomic<MidiPlayerSong *> pending{NULL};
+    std::atomic<MidiPlayerSong *> retired{NULL};
+    std::atomic<float> sampleRate{44100.f};
+
+    // Worker state
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool running = true;
+    // Guarded by mutex
+    std::string requestedPath;
+    std::string path;
+    std::string fileName;
+    bool loadRequested = false;
+    bool failed = false;
+    // Only touched by the worker
+    std::vector<MidiPlayerNote> notes;
+    double noteLength = 0.0;
+    float noteBpm = 120.f;
+    int fileCounter = 0;
+    float stampedRate = 0.f;
+
+    // Bumped whenever fileName or failed change, for the display
+    std::atomic<int> fileVersion{0};
+
+    // Audio thread
+    MidiPlayerSong *song = NULL;
+    double position = 0.0;
+    size_t cursor = 0;
+    bool playing = true;
+
+    int voiceNote[MIDIPLAYER_MAX_VOICES];
+    int voiceChannel[MIDIPLAYER_MAX_VOICES];
+    float voiceVoct[MIDIPLAYER_MAX_VOICES] = {};
+    float voiceVelocity[MIDIPLAYER_MAX_VOICES] = {};
+    bool voiceGate[MIDIPLAYER_MAX_VOICES] = {};
+    bool voiceRetrigger[MIDIPLAYER_MAX_VOICES] = {};
+    uint32_t voiceAge[MIDIPLAYER_MAX_VOICES] = {};
+    uint32_t noteCounter = 0;
+
+    dsp::SchmittTrigger playTrigger;
+    dsp::SchmittTrigger playInputTrigger;
+    dsp::SchmittTrigger resetTrigger;
+    dsp::SchmittTrigger seekTrigger;
+    dsp::SchmittTrigger clockTrigger;
+    dsp::PulseGenerator eocPulse;
+    uint32_t sinceClock = 0;
+    uint32_t clockPeriod = 0;
+    bool clockStarted = false;
+
+    // Read by the display
+    std::atomic<float> seconds{0.f};
+
+    int polyphony_index = 2;
+    int channel_index = 0;
+    int ppqn_index = 2;
+    int loop_index = 1;
+
+    MidiPlayer() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(MidiPlayer::PLAY_PARAM, 0.0, 1.0, 0.0, "Play");
+        configParam(MidiPlayer::SEEK_PARAM, 0.0, 1.0, 0.0, "Seek position", "%", 0, 100);
+
+        for (int v = 0; v < MIDIPLAYER_MAX_VOICES; v++) {
+            voiceNote[v] = -1;
+            voiceChannel[v] = -1;
+        }
+        worker = std::thread(&MidiPlayer::run, this);
+    }
+
+    ~MidiPlayer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        condition.notify_one();
+        if (worker.joinable())
+            worker.join();
+        delete song;
+        delete pending.load();
+        delete retired.load();
+    }
+
+    json_t *dataToJson() override {
+        json_t *rootJ = json_object();
+        json_object_set_new(rootJ, "polyphony", json_integer(polyphony_index));
+        json_object_set_new(rootJ, "channel", json_integer(channel_index));
+        json_object_set_new(rootJ, "ppqn", json_integer(ppqn_index));
+        json_object_set_new(rootJ, "loop", json_integer(loop_index));
+        std::lock_guard<std::mutex> lock(mutex);
+        json_object_set_new(rootJ, "path", json_string(path.c_str()));
+        return rootJ;
+    }
+
+    void dataFromJson(json_t *rootJ) override {
+        json_t *polyphonyJ = json_object_get(rootJ, "polyphony");
+        if (polyphonyJ)
+            polyphony_index = clamp((int) json_integer_value(polyphonyJ), 0, (int) LENGTHOF(MIDIPLAYER_POLYPHONY) - 1);
+        json_t *channelJ = json_object_get(rootJ, "channel");
+        if (channelJ)
+            channel_index = clamp((int) json_integer_value(channelJ), 0, 16);
+        json_t *ppqnJ = json_object_get(rootJ, "ppqn");
+        if (ppqnJ)
+            ppqn_index = clamp((int) json_integer_value(ppqnJ), 0, (int) LENGTHOF(MIDIPLAYER_PPQN) - 1);
+        json_t *loopJ = json_object_get(rootJ, "loop");
+        if (loopJ)
+            loop_index = clamp((int) json_integer_value(loopJ), 0, 1);
+        json_t *pathJ = json_object_get(rootJ, "path");
+        if (pathJ && json_string_value(pathJ)[0])
+            loadFile(json_string_value(pathJ));
+    }
+
+    // Any thread but the audio thread
+    void loadFile(std::string filePath) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requestedPath = filePath;
+            loadRequested = true;
+        }
+        condition.notify_one();
+    }
+
+    /*
+    Worker
+    */
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running) {
+            // Sample rate changes are polled, so the audio thread never notifies
+            condition.wait_for(lock, std::chrono::milliseconds(50));
+            bool load = loadRequested;
+            std::string filePath = requestedPath;
+            loadRequested = false;
+            lock.unlock();
+
+            delete retired.exchange(NULL, std::memory_order_acquire);
+            if (load)
+                parse(filePath);
+            float rate = sampleRate.load(std::memory_order_relaxed);
+            if (fileCounter > 0 && (load || rate != stampedRate))
+                publish(rate);
+
+            lock.lock();
+        }
+    }
+
+    void parse(std::string filePath) {
+        std::vector<MidiPlayerNote> parsed;
+        double length = 0.0;
+        float bpm = 120.f;
+        bool ok = true;
+
+        try {
+            stk::MidiFileIn file(filePath);
+
+            // Absolute tick times for every track, plus the tempo map from all of them
+            struct Timed { unsigned long tick; MidiPlayerNote note; };
+            std::vector<Timed> timed;
+            std::vector<std::pair<unsigned long, double>> tempos;
+            unsigned long endTick = 0;
+            std::vector<unsigned char> event;
+            for (unsigned int t = 0; t < file.getNumberOfTracks(); t++) {
+                file.rewindTrack(t);
+                unsigned long tick = 0;
+                while (true) {
+                    tick += file.getNextEvent(&event, t);
+                    if (event.empty())
+                        break;
+                    endTick = std::max(endTick, tick);
+                    unsigned char type = event[0] & 0xF0;
+                    if (event[0] == 0xFF && event.size() == 6 && event[1] == 0x51) {
+                        unsigned long microseconds = (event[3] << 16) + (event[4] << 8) + event[5];
+                        tempos.push_back(std::make_pair(tick, microseconds * 0.000001));
+                    }
+                    else if ((type == 0x90 || type == 0x80) && event.size() >= 3) {
+                        Timed n;
+                        n.tick = tick;
+                        n.note.time = 0.0;
+                        n.note.channel = event[0] & 0x0F;
+                        n.note.note = event[1];
+                        n.note.velocity = type == 0x90 ? event[2] : 0;
+                        timed.push_back(n);
+                    }
+                }
+            }
+
+            int division = file.getDivision();
+            std::stable_sort(tempos.begin(), tempos.end(), [](const std::pair<unsigned long, double> &a, const std::pair<unsigned long, double> &b) {
+                return a.first < b.first;
+            });
+            std::stable_sort(timed.begin(), timed.end(), [](const Timed &a, const Timed &b) {
+                return a.tick < b.tick;
+            });
+
+            // Walk notes and tempo changes together, ticks -> seconds
+            auto secondsAt = [&](unsigned long tick, size_t &tempoIndex, unsigned long &lastTick, double &lastTime, double &tickSeconds) {
+                while (tempoIndex < tempos.size() && tempos[tempoIndex].first <= tick) {
+                    lastTime += (tempos[tempoIndex].first - lastTick) * tickSeconds;
+                    lastTick = tempos[tempoIndex].first;
+                    tickSeconds = tempos[tempoIndex].second / division;
+                    tempoIndex++;
+                }
+                return lastTime + (tick - lastTick) * tickSeconds;
+            };
+            size_t tempoIndex = 0;
+            unsigned long lastTick = 0;
+            double lastTime = 0.0;
+            // SMPTE divisions have a fixed tick length, otherwise 120 BPM until told
+            double tickSeconds = (division & 0x8000) ? file.getTickSeconds(0) : 0.5 / division;
+            if (division & 0x8000)
+                tempos.clear();
+            if (!tempos.empty() && tempos[0].first == 0)
+                bpm = 60.0 / tempos[0].second;
+
+            parsed.reserve(timed.size());
+            for (Timed &n : timed) {
+                n.note.time = secondsAt(n.tick, tempoIndex, lastTick, lastTime, tickSeconds);
+                parsed.push_back(n.note);
+            }
+            length = secondsAt(endTick, tempoIndex, lastTick, lastTime, tickSeconds);
+        }
+        catch (stk::StkError &e) {
+            std::cerr << "MidiPlayer: " << e.getMessage() << std::endl;
+            ok = false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = !ok;
+        if (ok) {
+            notes.swap(parsed);
+            noteLength = length;
+            noteBpm = bpm;
+            fileCounter++;
+            path = filePath;
+            fileName = system::getFilename(filePath);
+        }
+        fileVersion++;
+    }
+
+    void publish(float rate) {
+        MidiPlayerSong *next = new MidiPlayerSong();
+        next->sampleRate = rate;
+        next->bpm = noteBpm;
+        next->file = fileCounter;
+        next->length = (uint32_t) ceil(noteLength * rate);
+        next->events.resize(notes.size());
+        for (size_t i = 0; i < notes.size(); i++) {
+            MidiPlayerEvent &e = next->events[i];
+            e.frame = (uint32_t) llround(notes[i].time * rate);
+            e.channel = notes[i].channel;
+            e.note = notes[i].note;
+            e.velocity = notes[i].velocity;
+        }
+        // Offs before ons on the same sample, so repeated notes retrigger
+        std::stable_sort(next->events.begin(), next->events.end(), [](const MidiPlayerEvent &a, const MidiPlayerEvent &b) {
+            if (a.frame != b.frame)
+                return a.frame < b.frame;
+            return a.velocity == 0 && b.velocity != 0;
+        });
+        next->length = std::max(next->length, next->events.empty() ? 0 : next->events.back().frame + 1);
+        stampedRate = rate;
+
+        // Never seen by the audio thread if it is replaced before being picked up
+        delete pending.exchange(next, std::memory_order_acq_rel);
+    }
+
+    /*
+    Audio thread
+    */
+
+    void releaseAll() {
+        for (int v = 0; v < MIDIPLAYER_MAX_VOICES; v++) {
+            voiceGate[v] = false;
+            voiceNote[v] = -1;
+        }
+    }
+
+    void seek(double frame) {
+        releaseAll();
+        position = frame;
+        if (!song) {
+            cursor = 0;
+            return;
+        }
+        MidiPlayerEvent key;
+        key.frame = (uint32_t) ceil(frame);
+        cursor = std::lower_bound(song->events.begin(), song->events.end(), key, [](const MidiPlayerEvent &a, const MidiPlayerEvent &b) {
+            return a.frame < b.frame;
+        }) - song->events.begin();
+    }
+
+    void swapSong() {
+        // Wait until the worker has freed the last one handed back
+        if (retired.load(std::memory_order_acquire))
+            return;
+        MidiPlayerSong *next = pending.exchange(NULL, std::memory_order_acq_rel);
+        if (!next)
+            return;
+
+        double frame = 0.0;
+        if (song && song->file == next->file)
+            frame = position * next->sampleRate / song->sampleRate;
+        retired.store(song, std::memory_order_release);
+        song = next;
+        seek(frame);
+    }
+
+    void noteOn(int channel, int note, int velocity, int voices) {
+        // Same note again, or the free voice released longest ago, or steal the oldest
+        int best = -1;
+        for (int v = 0; v < voices; v++) {
+            if (voiceNote[v] == note && voiceChannel[v] == channel) {
+                best = v;
+                break;
+            }
+            if (best < 0 || (voiceGate[best] && !voiceGate[v]) || (voiceGate[best] == voiceGate[v] && voiceAge[v] < voiceAge[best]))
+                best = v;
+        }
+        voiceRetrigger[best] = voiceGate[best];
+        voiceNote[best] = note;
+        voiceChannel[best] = channel;
+        voiceVoct[best] = (note - 60) / 12.f;
+        voiceVelocity[best] = velocity / 127.f * 10.f;
+        voiceGate[best] = true;
+        voiceAge[best] = ++noteCounter;
+    }
+
+    void noteOff(int channel, int note, int voices) {
+        for (int v = 0; v < voices; v++) {
+            if (voiceNote[v] == note && voiceChannel[v] == channel) {
+                voiceGate[v] = false;
+                voiceNote[v] = -1;
+            }
+        }
+    }
+
+    float clockSpeed() {
+        // Clock BPM over file BPM, zero once the clock stops
+        if (clockPeriod == 0 || sinceClock > 2 * clockPeriod)
+            return 0.f;
+        float clockBpm = 60.f * song->sampleRate / (clockPeriod * MIDIPLAYER_PPQN[ppqn_index]);
+        return clockBpm / song->bpm;
+    }
+
+    void process(const ProcessArgs& args) override {
+        sampleRate.store(args.sampleRate, std::memory_order_relaxed);
+        swapSong();
+
+        bool pressed = playTrigger.process(params[PLAY_PARAM].getValue());
+        bool triggered = playInputTrigger.process(inputs[PLAY_INPUT].getVoltage());
+        if (pressed || triggered) {
+            playing = !playing;
+            if (!playing)
+                releaseAll();
+        }
+        if (resetTrigger.process(inputs[RESET_INPUT].getVoltage()))
+            seek(0.0);
+        if (song && seekTrigger.process(inputs[SEEK_INPUT].getVoltage()))
+            seek(params[SEEK_PARAM].getValue() * song->length);
+
+        // The first edge after patching only starts the count
+        if (inputs[CLOCK_INPUT].isConnected()) {
+            sinceClock++;
+            if (clockTrigger.process(inputs[CLOCK_INPUT].getVoltage())) {
+                if (clockStarted)
+                    clockPeriod = sinceClock;
+                clockStarted = true;
+                sinceClock = 0;
+            }
+        }
+        else {
+            clockStarted = false;
+            clockPeriod = 0;
+        }
+
+        int voices = MIDIPLAYER_POLYPHONY[polyphony_index];
+        for (int v = 0; v < voices; v++)
+            voiceRetrigger[v] = false;
+
+        if (song && playing) {
+            // Everything up to and including this sample
+            const std::vector<MidiPlayerEvent> &events = song->events;
+            while (cursor < events.size() && events[cursor].frame <= position) {
+                const MidiPlayerEvent &e = events[cursor++];
+                if (channel_index != 0 && e.channel != channel_index - 1)
+                    continue;
+                if (e.velocity > 0)
+                    noteOn(e.channel, e.note, e.velocity, voices);
+                else
+                    noteOff(e.channel, e.note, voices);
+            }
+
+            position += inputs[CLOCK_INPUT].isConnected() ? clockSpeed() : 1.f;
+            if (position >= song->length) {
+                eocPulse.trigger(1e-3);
+                if (loop_index)
+                    seek(position - song->length);
+                else {
+                    playing = false;
+                    seek(0.0);
+                }
+            }
+            seconds.store(position / song->sampleRate, std::memory_order_relaxed);
+        }
+
+        outputs[VOCT_OUTPUT].setChannels(voices);
+        outputs[GATE_OUTPUT].setChannels(voices);
+        outputs[VELOCITY_OUTPUT].setChannels(voices);
+        for (int v = 0; v < voices; v++) {
+            outputs[VOCT_OUTPUT].setVoltage(voiceVoct[v], v);
+            // One low sample lets envelopes see a repeated note
+            outputs[GATE_OUTPUT].setVoltage(voiceGate[v] && !voiceRetrigger[v] ? 10.f : 0.f, v);
+            outputs[VELOCITY_OUTPUT].setVoltage(voiceVelocity[v], v);
+        }
+        outputs[EOC_OUTPUT].setVoltage(eocPulse.process(args.sampleTime) ? 10.f : 0.f);
+        lights[PLAY_LIGHT].setBrightness(playing && song ? 1.f : 0.f);
+    }
+};
+
+/*
+Display
+*/
+
+struct MidiPlayerFileDisplay : RJTextDisplay {
+    MidiPlayer *module = NULL;
+    int shownVersion = -1;
+
+    MidiPlayerFileDisplay() {
+        fontSize = 12;
+        letterSpacing = 0.5;
+        text = "NO FILE";
+    }
+
+    bool update() override {
+        if (!module)
+            return false;
+        int version = module->fileVersion.load(std::memory_order_relaxed);
+        if (version == shownVersion)
+            return false;
+
+        shownVersion = version;
+        std::lock_guard<std::mutex> lock(module->mutex);
+        if (module->failed)
+            text = "ERROR";
+        else if (module->fileName.empty())
+            text = "NO FILE";
+        else
+            text = module->fileName.substr(0, 16);
+        return true;
+    }
+
+    void drawText(NVGcontext *vg) override {
+        nvgTextAlign(vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(vg, box.size.x / 2, box.size.y / 2, text.c_str(), NULL);
+    }
+};
+
+struct MidiPlayerTimeDisplay : RJTextDisplay {
+    MidiPlayer *module = NULL;
+    int shownSeconds = -1;
+
+    MidiPlayerTimeDisplay() {
+        fontSize = 16;
+        letterSpacing = 0.5;
+        text = "00:00";
+    }
+
+    bool update() override {
+        if (!module)
+            return false;
+        int s = (int) module->seconds.load(std::memory_order_relaxed);
+        if (s == shownSeconds)
+            return false;
+
+        shownSeconds = s;
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%02d:%02d", s / 60, s % 60);
+        text = buffer;
+        return true;
+    }
+
+    void drawText(NVGcontext *vg) override {
+        nvgTextAlign(vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(vg, box.size.x / 2, box.size.y / 2, text.c_str(), NULL);
+    }
+};
+
+
+struct MidiPlayerWidget: ModuleWidget {
+    MidiPlayerWidget(MidiPlayer *module);
+    void appendContextMenu(Menu *menu) override;
+};
+
+MidiPlayerWidget::MidiPlayerWidget(MidiPlayer *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/MidiPlayer.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    {
+        MidiPlayerFileDisplay *display = new MidiPlayerFileDisplay();
+        display->box.pos = Vec(10, 45);
+        display->box.size = Vec(130, 24);
+        display->module = module;
+        addChild(display);
+    }
+    {
+        MidiPlayerTimeDisplay *display = new MidiPlayerTimeDisplay();
+        display->box.pos = Vec(10, 75);
+        display->box.size = Vec(130, 30);
+        display->module = module;
+        addChild(display);
+    }
+
+    addParam(createParam<LEDButton>(Vec(25, 140), module, MidiPlayer::PLAY_PARAM));
+    addChild(createLight<MediumLight<GreenLight>>(Vec(29.4, 144.4), module, MidiPlayer::PLAY_LIGHT));
+    addParam(createParam<MidiPlayerRoundLargeBlackKnob>(Vec(80, 125), module, MidiPlayer::SEEK_PARAM));
+
+    addInput(createInput<PJ301MPort>(Vec(10, 200), module, MidiPlayer::PLAY_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(45, 200), module, MidiPlayer::RESET_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(80, 200), module, MidiPlayer::SEEK_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(112.5, 200), module, MidiPlayer::CLOCK_INPUT));
+
+    addOutput(createOutput<PJ301MPort>(Vec(10, 320), module, MidiPlayer::VOCT_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(45, 320), module, MidiPlayer::GATE_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(80, 320), module, MidiPlayer::VELOCITY_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(112.5, 320), module, MidiPlayer::EOC_OUTPUT));
+}
+
+void MidiPlayerWidget::appendContextMenu(Menu *menu) {
+    MidiPlayer *module = dynamic_cast<MidiPlayer *>(this->module);
+
+    struct LoadItem : MenuItem
+    {
+        MidiPlayer *module;
+        void onAction(const event::Action &e) override
+        {
+            osdialog_filters *filters = osdialog_filters_parse("MIDI:mid,midi");
+            char *path = osdialog_file(OSDIALOG_OPEN, NULL, NULL, filters);
+            osdialog_filters_free(filters);
+            if (path) {
+                module->loadFile(path);
+                free(path);
+            }
+        }
+    };
+
+    menu->addChild(new MenuEntry);
+
+    LoadItem *loadItem = createMenuItem<LoadItem>("Load MIDI file...");
+    loadItem->module = module;
+    menu->addChild(loadItem);
+
+    RJChoiceItem *polyphonyItem = createMenuItem<RJChoiceItem>("Polyphony", ">");
+    polyphonyItem->target = &module->polyphony_index;
+    polyphonyItem->labels = {"1", "4", "8", "16"};
+    menu->addChild(polyphonyItem);
+
+    RJChoiceItem *channelItem = createMenuItem<RJChoiceItem>("MIDI Channel", ">");
+    channelItem->target = &module->channel_index;
+    channelItem->labels = {"All"};
+    for (int c = 1; c <= 16; c++)
+        channelItem->labels.push_back(std::to_string(c));
+    menu->addChild(channelItem);
+
+    RJChoiceItem *ppqnItem = createMenuItem<RJChoiceItem>("Clock", ">");
+    ppqnItem->target = &module->ppqn_index;
+    ppqnItem->labels = {"Quarter notes", "Eighth notes", "Sixteenth notes", "24 PPQN"};
+    menu->addChild(ppqnItem);
+
+    RJChoiceItem *loopItem = createMenuItem<RJChoiceItem>("At End", ">");
+    loopItem->target = &module->loop_index;
+    loopItem->labels = {"Stop", "Loop"};
+    menu->addChild(loopItem);
+}
+
+Model *modelMidiPlayer = createModel<MidiPlayer, MidiPlayerWidget>("MidiPlayer");
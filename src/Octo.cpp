@@ -1,4 +1,5 @@
 #include "RJModules.hpp"
+#include "UI.hpp"
 #include "dsp/digital.hpp"
 #include "plugin.hpp"
 #include <iostream>
@@ -31,7 +32,8 @@ struct OctoLowFrequencyOscillator {
     T phase = 0.f;
     T pw = 0.5f;
     T freq = 1.f;
-    bool invert = false;
+    // Per-lane polarity, -1 flips that lane
+    T sign = 1.f;
     bool bipolar = false;
     T resetState = T::mask();
 
@@ -52,18 +54,17 @@ struct OctoLowFrequencyOscillator {
         resetState = simd::ifelse(on, T::mask(), resetState);
         phase = simd::ifelse(triggered, 0.f, phase);
     }
+    // dt can span many cycles when a bank catches up after sitting idle
     void step(float dt) {
-        T deltaPhase = simd::fmin(freq * dt, 0.5f);
-        phase += deltaPhase;
-        phase -= (phase >= 1.f) & 1.f;
+        phase += freq * dt;
+        phase -= simd::floor(phase);
     }
     T sin() {
         T p = phase;
         // if (bipolar)
         //     p += 0.25f;
         T v = simd::sin(2 * M_PI * p);
-        if (invert)
-            v *= -1.f;
+        v *= sign;
         if (!bipolar)
             v += 1.f;
         return v;
@@ -73,8 +74,7 @@ struct OctoLowFrequencyOscillator {
         // if (bipolar)
         //     p += 0.25f;
         T v = 4.f * simd::fabs(p - simd::round(p)) - 1.f;
-        if (invert)
-            v *= -1.f;
+        v *= sign;
         if (!bipolar)
             v += 1.f;
         return v;
@@ -84,16 +84,14 @@ struct OctoLowFrequencyOscillator {
         // if (bipolar)
         //     p += 0.25f;
         T v = 2.f * (p - simd::round(p));
-        if (invert)
-            v *= -1.f;
+        v *= sign;
         if (!bipolar)
             v += 1.f;
         return v;
     }
     T sqr() {
         T v = simd::ifelse(phase < pw, 1.f, -1.f);
-        if (invert)
-            v *= -1.f;
+        v *= sign;
         if (!bipolar)
             v += 1.f;
         return v;
@@ -124,37 +122,98 @@ struct Octo: Module {
         NUM_LIGHTS
     };
 
-    OctoLowFrequencyOscillator<float_4> oscillators[8];
+    // The eight LFOs live in two banks of four lanes: LFO c is lane c % 4 of bank c / 4
+    OctoLowFrequencyOscillator<float_4> banks[2];
     dsp::ClockDivider lightDivider;
-    float multiples[8];
-    rack::simd::Vector<float, 4> samples[8];
+    float_4 multiples[2];
+    float_4 samples[2];
     bool hold = false;
 
-    rack::simd::Vector<float, 4> outs[8];
+    float_4 outs[2];
     int frame_counter = 0;
     bool force_update = false;
     int COUNTER_MAX = 5000;
     int wave_mode_index = 0;
 
+    // Control rate: run the LFOs every CONTROL_DIVISION samples and ramp between results
+    static const int CONTROL_DIVISION = 16;
+    int rate_mode_index = 0;
+    int poly_mode_index = 0;
+    int control_counter = 0;
+    float_4 previous[2];
+    float_4 target[2];
+    // Samples since each bank was last run, so an idle one catches up on all of them
+    int idle[2] = {};
+
     Octo() {
         config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
         configParam(Octo::SPEED_PARAM, 0.0, 10.0, 5.0, "Speed");
         configParam(Octo::SPEED_ATTEN_PARAM, -1.0, 1.0, 1.0, "Attenuvertion");
         lightDivider.setDivision(2048);
 
-        multiples[0] = 1;
-        multiples[1] = .85f;
-        oscillators[1].invert = true;
-        multiples[2] = .701f;
-        multiples[3] = .54f;
-        oscillators[3].invert = true;
-        multiples[4] = .42f;
-        multiples[5] = .3333f;
-        oscillators[5].invert = true;
-        multiples[6] = .1f;
-        multiples[7] = .004f;
-        oscillators[7].invert = true;
+        multiples[0] = float_4(1.f, .85f, .701f, .54f);
+        multiples[1] = float_4(.42f, .3333f, .1f, .004f);
+        banks[0].sign = float_4(1.f, -1.f, 1.f, -1.f);
+        banks[1].sign = float_4(1.f, -1.f, 1.f, -1.f);
+
+        for (int b = 0; b < 2; b++) {
+            samples[b] = 0.f;
+            outs[b] = 0.f;
+            previous[b] = 0.f;
+            target[b] = 0.f;
+        }
+    }
+
+    float_4 wave(OctoLowFrequencyOscillator<float_4> *oscillator) {
+        switch(wave_mode_index){
+        case 1:
+            return oscillator->sqr();
+        case 2:
+            return oscillator->saw();
+        case 3:
+            return oscillator->sin();
+        default:
+            return oscillator->tri();
+        }
+    }
+
+    // One exp2 and one waveform evaluation for four LFOs
+    float_4 runBank(int b, float pitch, float dt) {
+        OctoLowFrequencyOscillator<float_4> *oscillator = &banks[b];
+        oscillator->setPitch(simd::clamp(pitch * multiples[b], 0.0f, 20.0f));
+        oscillator->step(dt);
+        if(hold != true){
+            samples[b] = wave(oscillator);
+        }
+        return samples[b];
+    }
+
+    bool bankConnected(int b) {
+        for (int i = 0; i < 4; i++) {
+            if (outputs[CH_OUTPUT + b * 4 + i].isConnected())
+                return true;
+        }
+        return false;
+    }
 
+    json_t *dataToJson() override {
+        json_t *rootJ = json_object();
+        json_object_set_new(rootJ, "wave", json_integer(wave_mode_index));
+        json_object_set_new(rootJ, "rate", json_integer(rate_mode_index));
+        json_object_set_new(rootJ, "poly", json_integer(poly_mode_index));
+        return rootJ;
+    }
+
+    void dataFromJson(json_t *rootJ) override {
+        json_t *waveJ = json_object_get(rootJ, "wave");
+        if (waveJ)
+            wave_mode_index = json_integer_value(waveJ);
+        json_t *rateJ = json_object_get(rootJ, "rate");
+        if (rateJ)
+            rate_mode_index = json_integer_value(rateJ);
+        json_t *polyJ = json_object_get(rootJ, "poly");
+        if (polyJ)
+            poly_mode_index = json_integer_value(polyJ);
     }
 
     void process(const ProcessArgs& args) override {
@@ -176,44 +235,62 @@ struct Octo: Module {
         } else {
             hold = false;
         }
-
-        bool isOutputConnected = false;
-        for (int c = 0; c < 8; c++) {
-            isOutputConnected = outputs[CH_OUTPUT + c].isConnected();
-            if(isOutputConnected || force_update){
-                auto* oscillator = &oscillators[c];
-                oscillator->setPitch(clamp( ((pitch + cv_voltage) * multiples[c]), 0.0f, 20.0f));
-                if(isOutputConnected){
-                    oscillator->step(args.sampleTime);
-                } else{
-                    oscillator->step(args.sampleTime * COUNTER_MAX);
-                }
-                if(hold != true){
-                    switch(wave_mode_index){
-                    case 0:
-                        outs[c] = oscillator->tri();
-                        break;
-                    case 1:
-                        outs[c] = oscillator->sqr();
-                        break;
-                    case 2:
-                        outs[c] = oscillator->saw();
-                        break;
-                    case 3:
-                        outs[c] = oscillator->sin();
-                        break;
+        pitch = pitch + cv_voltage;
+
+        bool poly = poly_mode_index != 0;
+
+        if (rate_mode_index != 0) {
+            // Run the banks once per division and ramp linearly towards the result
+            if (control_counter == 0) {
+                for (int b = 0; b < 2; b++) {
+                    previous[b] = target[b];
+                    idle[b] += CONTROL_DIVISION;
+                    if (poly || idle[b] >= COUNTER_MAX || bankConnected(b)) {
+                        target[b] = runBank(b, pitch, args.sampleTime * idle[b]);
+                        idle[b] = 0;
                     }
-                    samples[c] = outs[c];
-                } else{
-                    outs[c] = samples[c];
                 }
-                outputs[CH_OUTPUT + c].setVoltageSimd(outs[c] * 2.5, 0);
+            }
+            float frac = (control_counter + 1) / (float) CONTROL_DIVISION;
+            for (int b = 0; b < 2; b++) {
+                outs[b] = previous[b] + (target[b] - previous[b]) * frac;
+            }
+            control_counter = (control_counter + 1) % CONTROL_DIVISION;
+        }
+        else {
+            for (int b = 0; b < 2; b++) {
+                // Nobody is listening to an idle bank, so it's only run every
+                // COUNTER_MAX samples, or as soon as it's patched again
+                idle[b]++;
+                if (poly || idle[b] >= COUNTER_MAX || bankConnected(b)) {
+                    outs[b] = runBank(b, pitch, args.sampleTime * idle[b]);
+                    idle[b] = 0;
+                }
+            }
+        }
+
+        if (poly) {
+            // All eight LFOs as an eight channel cable on the first output
+            outputs[CH_OUTPUT].setChannels(8);
+            outputs[CH_OUTPUT].setVoltageSimd(outs[0] * 2.5f, 0);
+            outputs[CH_OUTPUT].setVoltageSimd(outs[1] * 2.5f, 4);
+            for (int c = 1; c < 8; c++) {
+                outputs[CH_OUTPUT + c].setChannels(1);
+                outputs[CH_OUTPUT + c].setVoltage(outs[c / 4][c % 4] * 2.5f);
+            }
+        }
+        else {
+            for (int c = 0; c < 8; c++) {
+                if (outputs[CH_OUTPUT + c].isConnected()) {
+                    outputs[CH_OUTPUT + c].setChannels(1);
+                    outputs[CH_OUTPUT + c].setVoltage(outs[c / 4][c % 4] * 2.5f);
+                }
             }
         }
 
         if (lightDivider.process() || (force_update == true)) {
             for (int c = 0; c < 8; c++) {
-                float lightValue = outs[c][0];
+                float lightValue = outs[c / 4][c % 4];
                 if(force_update == false){
                     lights[CH_LIGHT + c].setSmoothBrightness(lightValue / 2.5, args.sampleTime * lightDivider.getDivision());
                 } else{
@@ -273,21 +350,6 @@ struct OctoWidget: ModuleWidget {
         addChild(createLight<MediumLight<WhiteLight>>(Vec(LEFT,  BASE + SPACE * 7), module, Octo::CH_LIGHT + 7));
     }
 
-    json_t *toJson() {
-        json_t *rootJ = ModuleWidget::toJson();
-        Octo *module = dynamic_cast<Octo *>(this->module);
-        json_object_set_new(rootJ, "wave", json_real(module->wave_mode_index));
-        return rootJ;
-    }
-
-    void fromJson(json_t *rootJ) {
-        ModuleWidget::fromJson(rootJ);
-        json_t *waveJ = json_object_get(rootJ, "wave");
-        Octo *module = dynamic_cast<Octo *>(this->module);
-        if (waveJ)
-            module->wave_mode_index = json_number_value(waveJ);
-    }
-
     void appendContextMenu(Menu *menu) override
     {
         Octo *module = dynamic_cast<Octo *>(this->module);
@@ -331,6 +393,16 @@ struct OctoWidget: ModuleWidget {
         waveItem->module = module;
         menu->addChild(waveItem);
 
+        RJChoiceItem *rateItem = createMenuItem<RJChoiceItem>("Output Rate", ">");
+        rateItem->target = &module->rate_mode_index;
+        rateItem->labels = {"Audio Rate", "Control Rate (1/16, interpolated)"};
+        menu->addChild(rateItem);
+
+        RJChoiceItem *polyItem = createMenuItem<RJChoiceItem>("Poly Mode", ">");
+        polyItem->target = &module->poly_mode_index;
+        polyItem->labels = {"Mono Outs", "All 8 on Output 1"};
+        menu->addChild(polyItem);
+
     }
 
 };
@@ -0,0 +1,135 @@
+/*
+PitchShift - a polyphonic pitch shifter.
+
+Each channel runs its own stk::LentPitShift: a pitch tracker finds the
+period of every 512 sample frame and grains one period long are laid
+back down at the new spacing. Good on voices and other monophonic
+sources, one voice per channel.
+
+The shifted signal comes out PITCHSHIFT_LATENCY samples late, so the dry
+signal is held back by the same amount before they're mixed.
+*/
+
+#include "RJModules.hpp"
+#include "LentPitShift.h"
+#include <iostream>
+#include <cmath>
+
+struct PitchShiftRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    PitchShiftRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+// Analysis frame, also the longest period the tracker can find
+static const int PITCHSHIFT_FRAME = 512;
+// A frame of buffering plus LentPitShift's output line of three frames
+static const int PITCHSHIFT_LATENCY = 4 * PITCHSHIFT_FRAME - 1;
+
+struct PitchShift: Module {
+    enum ParamIds {
+        SHIFT_PARAM,
+        MIX_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        IN_INPUT,
+        SHIFT_CV_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        OUT_OUTPUT,
+        NUM_OUTPUTS
+    };
+
+    stk::LentPitShift *shifters[16];
+    dsp::ClockDivider paramDivider;
+    float mix = 1.f;
+
+    // The dry signal, delayed to line up with the wet
+    float dry[PITCHSHIFT_LATENCY][16] = {};
+    int dryPosition = 0;
+
+    PitchShift() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS);
+        configParam(PitchShift::SHIFT_PARAM, -12.0, 12.0, 0.0, "Shift", " semitones");
+        configParam(PitchShift::MIX_PARAM, 0.0, 1.0, 1.0, "Mix", "%", 0.f, 100.f);
+        paramDivider.setDivision(32);
+
+        for (int c = 0; c < 16; c++) {
+            shifters[c] = new stk::LentPitShift(1.0, PITCHSHIFT_FRAME);
+            // Each channel analyses a frame every PITCHSHIFT_FRAME samples. Offset the
+            // channels against each other so their frames don't all land on the same sample.
+            for (int i = 0; i < c * PITCHSHIFT_FRAME / 16; i++) {
+                shifters[c]->tick(0.0);
+            }
+        }
+    }
+
+    ~PitchShift() {
+        for (int c = 0; c < 16; c++) {
+            delete shifters[c];
+        }
+    }
+
+    void updateParams(int channels) {
+        for (int c = 0; c < channels; c++) {
+            // Semitones from the knob, 1V/Oct from the CV
+            float octaves = params[SHIFT_PARAM].getValue() / 12.f + inputs[SHIFT_CV_INPUT].getPolyVoltage(c);
+            shifters[c]->setShift(dsp::approxExp2_taylor5(clamp(octaves, -2.f, 2.f)));
+        }
+        mix = params[MIX_PARAM].getValue();
+    }
+
+    void process(const ProcessArgs &args) override {
+        int channels = std::max(1, inputs[IN_INPUT].getChannels());
+
+        if (paramDivider.process()) {
+            updateParams(channels);
+        }
+
+        float *delayed = dry[dryPosition];
+        for (int c = 0; c < channels; c++) {
+            float in = inputs[IN_INPUT].getVoltage(c);
+            // The grains overlap at half level, so the wet is brought back up to match the dry
+            float wet = (float) shifters[c]->tick(in / 5.0) * 10.f;
+            outputs[OUT_OUTPUT].setVoltage(crossfade(delayed[c], wet, mix), c);
+            delayed[c] = in;
+        }
+        dryPosition = (dryPosition + 1) % PITCHSHIFT_LATENCY;
+        outputs[OUT_OUTPUT].setChannels(channels);
+    }
+};
+
+
+struct PitchShiftWidget: ModuleWidget {
+    PitchShiftWidget(PitchShift *module);
+};
+
+PitchShiftWidget::PitchShiftWidget(PitchShift *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/PitchShift.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    addParam(createParam<PitchShiftRoundLargeBlackKnob>(Vec(47, 61), module, PitchShift::SHIFT_PARAM));
+    addInput(createInput<PJ301MPort>(Vec(61, 125), module, PitchShift::SHIFT_CV_INPUT));
+    addParam(createParam<PitchShiftRoundLargeBlackKnob>(Vec(47, 190), module, PitchShift::MIX_PARAM));
+
+    addInput(createInput<PJ301MPort>(Vec(22, 320), module, PitchShift::IN_INPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(100, 320), module, PitchShift::OUT_OUTPUT));
+}
+
+Model *modelPitchShift = createModel<PitchShift, PitchShiftWidget>("PitchShift");
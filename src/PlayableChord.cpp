@@ -5,6 +5,7 @@
 #include <sstream>
 #include <iomanip>
 #include "RJModules.hpp"
+#include "UI.hpp"
 
 
 // Displays
@@ -19,33 +20,11 @@ struct PCRoundLargeBlackSnapKnob : RoundLargeBlackKnob
     }
 };
 
-struct StringDisplayWidget : TransparentWidget {
-
-  std::string *value;
-
-  void draw(NVGcontext *vg) override
-  {
-    // Background
-    NVGcolor backgroundColor = nvgRGB(0xC0, 0xC0, 0xC0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
-    nvgFillColor(vg, backgroundColor);
-    nvgFill(vg);
-
-    // text
-    std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, "res/Pokemon.ttf"));
-    if (font) {
-    nvgFontSize(vg, 24);
-    nvgFontFaceId(vg, font->handle);
-    nvgTextLetterSpacing(vg, 2.5);
-    }
-    std::stringstream to_display;
-    to_display << std::setw(3) << *value;
-
-    Vec textPos = Vec(16.0f, 33.0f);
-    NVGcolor textColor = nvgRGB(0x00, 0x00, 0x00);
-    nvgFillColor(vg, textColor);
-    nvgText(vg, textPos.x, textPos.y, to_display.str().c_str(), NULL);
+struct StringDisplayWidget : RJStringDisplay {
+  StringDisplayWidget() {
+    fontSize = 24;
+    letterSpacing = 2.5;
+    textPos = Vec(16.0f, 33.0f);
   }
 };
 
@@ -1,9 +1,16 @@
 /*
 Pluck is an integrated VCA + "ADSR". Hacked up from Fundamental.
+
+Polyphonic, 16 channels in float_4 lanes. Gate and trigger edges are
+timed inside the sample, so the envelope doesn't jitter by a sample.
 */
 
 #include "RJModules.hpp"
 
+using simd::float_4;
+
+static const int PLUCK_TABLE_SIZE = 256;
+
 struct Pluck : Module {
     enum ParamIds {
         LEVEL_PARAM,
@@ -43,79 +50,127 @@ struct Pluck : Module {
 };
 
     float lastCv = 0.f;
-    bool decaying = false;
-    float env = 0.0f;
-    dsp::SchmittTrigger trigger;
+
+    // Four channels per float_4. decaying and gated are lane masks.
+    float_4 env[4];
+    float_4 decaying[4];
+    float_4 gated[4];
+    float_4 triggered[4];
+    float_4 lastGate[4];
+    float_4 lastTrig[4];
+
+    // The release multiplier, redone only when a channel's release moves
+    float_4 release[4];
+    float_4 releaseMul[4];
+
+    // Release multiplier against release knob + CV, one step per sample
+    float releaseTable[PLUCK_TABLE_SIZE + 1];
+    float attackStep = 0.f;
 
     Pluck() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
         configParam(Pluck::LEVEL_PARAM, 0.0, 1.0, 1.0, "");
         configParam(Pluck::RELEASE_PARAM, 0.2, 0.4f, 0.50f, "");
         configParam(Pluck::EXP_PARAM, 0.0001f, .2f, 4.0f, "");
+        for (int g = 0; g < 4; g++) {
+            env[g] = 0.f;
+            decaying[g] = 0.f;
+            gated[g] = 0.f;
+            triggered[g] = 0.f;
+            lastGate[g] = 0.f;
+            lastTrig[g] = 0.f;
+            release[g] = -1.f;
+            releaseMul[g] = 0.f;
+        }
+        onSampleRateChange();
     }
 
-    void step() override {
-
-        /* ADSR */
-        float attack = 0.005f;
-        float decay = 10.0f;
-        float sustain = 10.0f;
-        float release = clamp(params[RELEASE_PARAM].value + inputs[RELEASE_INPUT].value / 10.0f, 0.0f, 1.0f);
-
-        // Gate and trigger
-        bool gated = inputs[GATE_INPUT].value >= 1.0f;
-        if (trigger.process(inputs[TRIG_INPUT].value))
-            decaying = false;
-
+    void onSampleRateChange() override {
+        // The envelope is a one pole recursion, env += k * (target - env), with
+        // k = base^(1 - time) / maxTime per second
+        const float attack = 0.005f;
         const float base = 20000.0f;
         const float maxTime = 20.0f;
-        if (gated) {
-            if (decaying) {
-                // Decay
-                if (decay < 1e-4) {
-                    env = sustain;
-                }
-                else {
-                    env += powf(base, 1 - decay) / maxTime * (sustain - env) * APP->engine->getSampleTime();
-                }
-            }
-            else {
-                // Attack
-                // Skip ahead if attack is all the way down (infinitely fast)
-                if (attack < 1e-4) {
-                    env = 1.0f;
-                }
-                else {
-                    env += powf(base, 1 - attack) / maxTime * (1.01f - env) * APP->engine->getSampleTime();
-                }
-                if (env >= 1.0f) {
-                    env = 1.0f;
-                    decaying = true;
-                }
-            }
+        float sampleTime = APP->engine->getSampleTime();
+        attackStep = powf(base, 1 - attack) / maxTime * sampleTime;
+        for (int i = 0; i <= PLUCK_TABLE_SIZE; i++) {
+            float r = (float) i / PLUCK_TABLE_SIZE;
+            releaseTable[i] = 1.0f - std::min(powf(base, 1 - r) / maxTime * sampleTime, 1.0f);
         }
-        else {
-            // Release
-            if (release < 1e-4) {
-                env = 0.0f;
-            }
-            else {
-                env += powf(base, 1 - release) / maxTime * (0.0f - env) * APP->engine->getSampleTime();
-            }
-            decaying = false;
+        for (int g = 0; g < 4; g++)
+            release[g] = -1.f;
+    }
+
+    float_4 lookupRelease(float_4 r) {
+        float_4 x = r * PLUCK_TABLE_SIZE;
+        float_4 i = simd::fmin(simd::floor(x), PLUCK_TABLE_SIZE - 1);
+        float_4 frac = x - i;
+        float_4 a, b;
+        for (int l = 0; l < 4; l++) {
+            a[l] = releaseTable[(int) i[l]];
+            b[l] = releaseTable[(int) i[l] + 1];
         }
+        // A release all the way down cuts off at once
+        return simd::ifelse(r < 1e-4f, 0.f, a + (b - a) * frac);
+    }
 
-        bool sustaining = isNear(env, sustain, 1e-3);
-        bool resting = isNear(env, 0.0f, 1e-3);
-        float env_output = 10.0f * env;
+    // How much of this sample lies after the input crossed 1V, from the line
+    // between the last sample and this one
+    static float_4 sinceCrossing(float_4 in, float_4 last) {
+        float_4 d = in - last;
+        return simd::clamp(simd::ifelse(d != 0.f, (in - 1.0f) / d, 1.f), 0.f, 1.f);
+    }
+
+    void process(const ProcessArgs &args) override {
+        int channels = std::max(std::max(inputs[IN_INPUT].getChannels(), inputs[GATE_INPUT].getChannels()), 1);
+        channels = std::max(channels, inputs[TRIG_INPUT].getChannels());
 
-        /* VCA */
-        float cv = fmaxf(env_output / 10.f, 0.f);
-        float exp_val =  clamp(params[EXP_PARAM].value + inputs[EXP_PARAM].value / 10.0f, 0.0f, 1.0f);
-        cv = powf(cv, exp_val);
-        lastCv = cv;
-        outputs[OUT_OUTPUT].value = inputs[IN_INPUT].value * cv;
+        for (int c = 0; c < channels; c += 4) {
+            int g = c / 4;
 
+            // Release, with the multiplier looked up again only on a change
+            float_4 r = simd::clamp(params[RELEASE_PARAM].getValue() + inputs[RELEASE_INPUT].getPolyVoltageSimd<float_4>(c) / 10.0f, 0.0f, 1.0f);
+            if (simd::movemask(r != release[g])) {
+                release[g] = r;
+                releaseMul[g] = lookupRelease(r);
+            }
+
+            // Gate and trigger, timed to where they cross 1V inside the sample
+            float_4 gate = inputs[GATE_INPUT].getPolyVoltageSimd<float_4>(c);
+            float_4 trig = inputs[TRIG_INPUT].getPolyVoltageSimd<float_4>(c);
+            float_4 nowGated = gate >= 1.0f;
+            float_4 edge = nowGated ^ gated[g];
+            float_4 trigRise = (trig >= 1.0f) & ~triggered[g];
+            triggered[g] = simd::ifelse(trigRise, trig >= 1.0f, triggered[g] & (trig > 0.0f));
+            float_4 gateWeight = simd::ifelse(edge, sinceCrossing(gate, lastGate[g]), 1.f);
+            float_4 weight = simd::ifelse(trigRise, simd::fmin(gateWeight, sinceCrossing(trig, lastTrig[g])), gateWeight);
+            lastGate[g] = gate;
+            lastTrig[g] = trig;
+            gated[g] = nowGated;
+            decaying[g] = decaying[g] & ~trigRise & nowGated;
+
+            // Attack to full, then hold. The original decay stage ran at
+            // base^-9 per second towards the sustain, which is a hold.
+            float_4 attacking = nowGated & ~decaying[g];
+            float_4 attacked = env[g] + attackStep * weight * (1.01f - env[g]);
+            float_4 full = attacked >= 1.0f;
+            attacked = simd::ifelse(full, 1.0f, attacked);
+            decaying[g] |= attacking & full;
+
+            // Release, one multiply, or part of one when the gate fell inside the sample
+            float_4 released = env[g] * (1.0f - (1.0f - releaseMul[g]) * weight);
+            env[g] = simd::ifelse(attacking, attacked, simd::ifelse(nowGated, env[g], released));
+
+            /* VCA */
+            float_4 cv = simd::fmax(env[g], 0.f);
+            float_4 exp_val = simd::clamp(params[EXP_PARAM].getValue() + inputs[EXP_INPUT].getPolyVoltageSimd<float_4>(c) / 10.0f, 0.0f, 1.0f);
+            if (simd::movemask(exp_val < 1.0f))
+                cv = simd::ifelse(cv > 0.0f, simd::pow(simd::fmax(cv, 1e-30f), exp_val), 0.0f);
+            if (g == 0)
+                lastCv = cv[0];
+            outputs[OUT_OUTPUT].setVoltageSimd(inputs[IN_INPUT].getPolyVoltageSimd<float_4>(c) * cv, c);
+        }
+        outputs[OUT_OUTPUT].setChannels(channels);
     }
 };
 
@@ -0,0 +1,612 @@
+/*
+PolyShakers - polyphonic stk::Shakers, Perry Cook's PhISEM particle models.
+
+Each channel of the trigger input shakes its own voice, and every Shakers
+instrument is available. A voice runs the same energy model as
+Shakers::tick(), with three changes that make idle voices free:
+
+ - Collisions are events. Rather than rolling rand() against nObjects every
+   sample, the gap to the next collision is drawn from the geometric
+   distribution that rolling would give, so a voice only touches its random
+   numbers when something happens. Per sample noise (the ratchets) comes from
+   a xorshift generator filled a block at a time.
+ - The resonances sit in the lanes of two float_4s (no instrument has more
+   than seven), and the water drop sweep ramps its coefficients across each
+   block instead of calling cos() three times a sample.
+ - Once the shaking has died away the resonances ring out and the voice goes
+   to sleep, skipping everything until the next trigger. Shakers::tick() cuts
+   the output off when the energy runs out, which clicks on the long ringing
+   instruments, so the tails are left to decay here.
+*/
+
+#include "RJModules.hpp"
+#include "UI.hpp"
+#include <iostream>
+#include <cmath>
+
+using simd::float_4;
+
+static const int POLYSHAKERS_VOICES = 16;
+static const int POLYSHAKERS_BLOCK = 32;
+static const int POLYSHAKERS_RESONANCES = 8;
+static const float POLYSHAKERS_MIN_ENERGY = 0.001f;
+static const float POLYSHAKERS_SILENCE = 1e-4f;
+static const float POLYSHAKERS_WATER_SWEEP = 1.0001f;
+static const int POLYSHAKERS_NEVER = 1 << 30;
+
+enum PolyShakersKind {
+    POLYSHAKERS_SHAKE,
+    POLYSHAKERS_RATCHET,
+    POLYSHAKERS_WATER,
+    POLYSHAKERS_TUBES
+};
+
+// The constants from Shakers.cpp, one instrument per entry
+struct PolyShakersType {
+    const char *name;
+    PolyShakersKind kind;
+    float soundDecay;
+    // The ratchet delta for the guiro and wrench, which have no system decay
+    float systemDecay;
+    float gain;
+    float objects;
+    float decayScale;
+    float varyFactor;
+    float equalizer[3];
+    int resonances;
+    float frequencies[7];
+    float radii[7];
+    float gains[7];
+    bool vary[7];
+};
+
+static const PolyShakersType POLYSHAKERS_TYPES[] = {
+    {"Maraca", POLYSHAKERS_SHAKE, 0.95, 0.999, 4.0, 25, 0.97, 0.0, {1.0, -1.0, 0.0},
+        1, {3200}, {0.96}, {1.0}, {false}},
+    {"Cabasa", POLYSHAKERS_SHAKE, 0.96, 0.997, 8.0, 512, 0.97, 0.0, {1.0, -1.0, 0.0},
+        1, {3000}, {0.7}, {1.0}, {false}},
+    {"Sekere", POLYSHAKERS_SHAKE, 0.96, 0.999, 4.0, 64, 0.94, 0.0, {1.0, 0.0, -1.0},
+        1, {5500}, {0.6}, {1.0}, {false}},
+    {"Tambourine", POLYSHAKERS_SHAKE, 0.95, 0.9985, 1.0, 32, 0.95, 0.05, {1.0, 0.0, -1.0},
+        3, {2300, 5600, 8100}, {0.96, 0.99, 0.99}, {0.1, 0.8, 1.0}, {false, true, true}},
+    {"Sleighbells", POLYSHAKERS_SHAKE, 0.97, 0.9994, 1.0, 32, 0.9, 0.03, {1.0, 0.0, -1.0},
+        5, {2500, 5300, 6500, 8300, 9800}, {0.99, 0.99, 0.99, 0.99, 0.99}, {1.0, 1.0, 1.0, 0.5, 0.3}, {true, true, true, true, true}},
+    {"Bamboo", POLYSHAKERS_SHAKE, 0.9, 0.9999, 0.4, 1.2, 0.7, 0.2, {1.0, 0.0, 0.0},
+        3, {2800, 0.8 * 2800, 1.2 * 2800}, {0.995, 0.995, 0.995}, {1.0, 1.0, 1.0}, {true, true, true}},
+    {"Sandpaper", POLYSHAKERS_SHAKE, 0.999, 0.999, 0.5, 128, 0.97, 0.0, {1.0, 0.0, -1.0},
+        1, {4500}, {0.6}, {1.0}, {false}},
+    {"Coke Can", POLYSHAKERS_SHAKE, 0.97, 0.999, 0.5, 48, 0.95, 0.0, {1.0, 0.0, -1.0},
+        5, {370, 1025, 1424, 2149, 3596}, {0.99, 0.992, 0.992, 0.992, 0.992}, {1.0, 1.8, 1.8, 1.8, 1.8}, {false}},
+    {"Sticks", POLYSHAKERS_SHAKE, 0.96, 0.998, 6.0, 2, 0.96, 0.0, {1.0, 0.0, -1.0},
+        1, {5500}, {0.6}, {1.0}, {false}},
+    {"Crunch", POLYSHAKERS_SHAKE, 0.95, 0.99806, 4.0, 7, 0.96, 0.0, {1.0, -1.0, 0.0},
+        1, {800}, {0.95}, {1.0}, {false}},
+    {"Big Rocks", POLYSHAKERS_SHAKE, 0.98, 0.9965, 4.0, 23, 0.95, 0.11, {1.0, 0.0, -1.0},
+        1, {6460}, {0.932}, {1.0}, {true}},
+    {"Little Rocks", POLYSHAKERS_SHAKE, 0.98, 0.99586, 4.0, 1600, 0.95, 0.18, {1.0, 0.0, -1.0},
+        1, {9000}, {0.843}, {1.0}, {true}},
+    {"Mug", POLYSHAKERS_SHAKE, 0.97, 0.9995, 0.8, 3, 0.95, 0.0, {1.0, 0.0, -1.0},
+        4, {2123, 4518, 8856, 10753}, {0.997, 0.997, 0.997, 0.997}, {1.0, 0.8, 0.6, 0.4}, {false}},
+    {"Penny", POLYSHAKERS_SHAKE, 0.97, 0.9995, 0.8, 3, 0.95, 0.0, {1.0, 0.0, -1.0},
+        7, {2123, 4518, 8856, 10753, 11000, 5200, 3835},
+        {0.997, 0.997, 0.997, 0.997, 0.999, 0.999, 0.999},
+        {1.0, 0.8, 0.6, 0.4, 1.0, 0.8, 0.5}, {false}},
+    {"Nickel", POLYSHAKERS_SHAKE, 0.97, 0.9995, 0.8, 3, 0.95, 0.0, {1.0, 0.0, -1.0},
+        7, {2123, 4518, 8856, 10753, 5583, 9255, 9805},
+        {0.997, 0.997, 0.997, 0.997, 0.9992, 0.9992, 0.9992},
+        {1.0, 0.8, 0.6, 0.4, 1.0, 0.8, 0.5}, {false}},
+    {"Dime", POLYSHAKERS_SHAKE, 0.97, 0.9995, 0.8, 3, 0.95, 0.0, {1.0, 0.0, -1.0},
+        7, {2123, 4518, 8856, 10753, 4450, 4974, 9945},
+        {0.997, 0.997, 0.997, 0.997, 0.9993, 0.9993, 0.9993},
+        {1.0, 0.8, 0.6, 0.4, 1.0, 0.8, 0.5}, {false}},
+    {"Quarter", POLYSHAKERS_SHAKE, 0.97, 0.9995, 0.8, 3, 0.95, 0.0, {1.0, 0.0, -1.0},
+        7, {2123, 4518, 8856, 10753, 1708, 8863, 9045},
+        {0.997, 0.997, 0.997, 0.997, 0.9995, 0.9995, 0.9995},
+        {1.0, 0.8, 0.6, 0.4, 1.0, 0.8, 0.5}, {false}},
+    {"Franc", POLYSHAKERS_SHAKE, 0.97, 0.9995, 0.8, 3, 0.95, 0.0, {1.0, 0.0, -1.0},
+        7, {2123, 4518, 8856, 10753, 5583, 11010, 1917},
+        {0.997, 0.997, 0.997, 0.997, 0.9995, 0.9995, 0.9995},
+        {1.0, 0.8, 0.6, 0.4, 0.7, 0.4, 0.3}, {false}},
+    {"Peso", POLYSHAKERS_SHAKE, 0.97, 0.9995, 0.8, 3, 0.95, 0.0, {1.0, 0.0, -1.0},
+        7, {2123, 4518, 8856, 10753, 7250, 8150, 10060},
+        {0.997, 0.997, 0.997, 0.997, 0.9996, 0.9996, 0.9996},
+        {1.0, 0.8, 0.6, 0.4, 1.0, 1.2, 0.7}, {false}},
+    {"Guiro", POLYSHAKERS_RATCHET, 0.95, 0.0001, 0.4, 128, 0.0, 0.0, {1.0, 0.0, -1.0},
+        2, {2500, 4000}, {0.97, 0.97}, {1.0, 1.0}, {false}},
+    {"Wrench", POLYSHAKERS_RATCHET, 0.95, 0.00015, 0.4, 128, 0.0, 0.0, {1.0, 0.0, -1.0},
+        2, {3200, 8000}, {0.99, 0.992}, {1.0, 1.0}, {false}},
+    {"Water", POLYSHAKERS_WATER, 0.95, 0.996, 1.0, 10, 0.8, 0.0, {-1.0, 0.0, 1.0},
+        3, {450, 600, 750}, {0.9985, 0.9985, 0.9985}, {1.0, 1.0, 1.0}, {false}},
+    {"Angklung", POLYSHAKERS_TUBES, 0.95, 0.9999, 0.5, 1.2, 0.7, 0.0, {1.0, 0.0, -1.0},
+        7, {1046.6, 1174.8, 1397.0, 1568, 1760, 2093.3, 2350}, {0.996, 0.996, 0.996, 0.996, 0.996, 0.996, 0.996}, {1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0}, {false}},
+};
+
+static const int POLYSHAKERS_NUM_TYPES = sizeof(POLYSHAKERS_TYPES) / sizeof(POLYSHAKERS_TYPES[0]);
+
+struct PolyShakersRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    PolyShakersRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+struct PolyShakersVoice {
+    const PolyShakersType *type = &POLYSHAKERS_TYPES[0];
+    int typeIndex = -1;
+
+    float shakeEnergy = 0.f;
+    float sndLevel = 0.f;
+    float nObjects = 1.f;
+    float systemDecay = 0.f;
+    float currentGain = 0.f;
+    float ratchetCount = 0.f;
+
+    // y = input * gain - a1 * y[n-1] - a2 * y[n-2], a resonance per lane
+    float_4 a1[2];
+    float_4 a2[2];
+    float_4 gain[2];
+    float_4 radii[2];
+    float_4 y1[2];
+    float_4 y2[2];
+    // Water drop sweep, per block
+    float_4 da1[2];
+    float frequencies[POLYSHAKERS_RESONANCES] = {};
+    float equalizer1 = 0.f;
+    float equalizer2 = 0.f;
+
+    // Collisions happen with this chance each sample, the next one is `untilEvent` away
+    float eventChance = 0.f;
+    int untilEvent = 1;
+    uint32_t rng = 1;
+    float noise[POLYSHAKERS_BLOCK] = {};
+    int position = 0;
+    float peak = 0.f;
+    bool awake = false;
+
+    // Control values the voice was last set up for
+    float decay = -1.f;
+    float objects = -1.f;
+    float resonance = -1.f;
+    float sampleRate = 0.f;
+
+    PolyShakersVoice() {
+        for (int j = 0; j < 2; j++) {
+            a1[j] = 0.f;
+            a2[j] = 0.f;
+            gain[j] = 0.f;
+            radii[j] = 0.f;
+            da1[j] = 0.f;
+        }
+        clear();
+    }
+
+    // Silences the resonances. The energy is left alone: after a ratchet pass
+    // Shakers leaves it at 1, so the next one starts at full strength.
+    void clear() {
+        for (int j = 0; j < 2; j++) {
+            y1[j] = 0.f;
+            y2[j] = 0.f;
+        }
+        equalizer1 = 0.f;
+        equalizer2 = 0.f;
+        peak = 0.f;
+    }
+
+    // xorshift32, in [0, 1)
+    float uniform() {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return (rng >> 8) * (1.f / 16777216.f);
+    }
+
+    int nextEvent() {
+        if (eventChance >= 1.f)
+            return 1;
+        if (eventChance <= 0.f)
+            return POLYSHAKERS_NEVER;
+        // Trials to the first success, for a coin that lands with eventChance
+        float gap = std::log(1.f - uniform()) / std::log1p(-eventChance);
+        return gap < 1e9f ? 1 + (int) gap : POLYSHAKERS_NEVER;
+    }
+
+    void setEventChance(float chance) {
+        if (chance != eventChance) {
+            // The gap is memoryless, so it can be drawn again from here
+            eventChance = chance;
+            untilEvent = nextEvent();
+        }
+    }
+
+    float coefficient(float frequency, float radius) {
+        return -2.f * radius * std::cos(2.f * M_PI * std::min(frequency, 0.49f * sampleRate) / sampleRate);
+    }
+
+    // Shakers::setType()
+    void setType(int index) {
+        typeIndex = index;
+        type = &POLYSHAKERS_TYPES[index];
+        float g[POLYSHAKERS_RESONANCES] = {};
+        float r[POLYSHAKERS_RESONANCES] = {};
+        for (int i = 0; i < type->resonances; i++) {
+            g[i] = type->gains[i];
+            r[i] = type->radii[i];
+        }
+        for (int j = 0; j < 2; j++) {
+            gain[j] = float_4::load(g + 4 * j);
+            radii[j] = float_4::load(r + 4 * j);
+            a2[j] = radii[j] * radii[j];
+        }
+        decay = -1.f;
+        objects = -1.f;
+        resonance = -1.f;
+        shakeEnergy = 0.f;
+        sndLevel = 0.f;
+        ratchetCount = 0.f;
+        clear();
+    }
+
+    // Shakers::controlChange() 4, 11 and 1, each from 0 to 1. The middle of
+    // each is the instrument as it comes.
+    void setControls(float decay, float objects, float resonance, float sampleRate) {
+        if (decay != this->decay) {
+            this->decay = decay;
+            systemDecay = type->systemDecay + 2.f * (decay - 0.5f) * type->decayScale * (1.f - type->systemDecay);
+        }
+        if (objects != this->objects) {
+            this->objects = objects;
+            nObjects = std::max(type->objects * std::pow(4.f, 2.f * objects - 1.f), 1.1f);
+            currentGain = std::log(nObjects) * type->gain / nObjects;
+            float chance = nObjects / 1024.f;
+            if (type->kind == POLYSHAKERS_WATER)
+                chance = nObjects / 32767.f;
+            setEventChance(chance);
+        }
+        if (resonance != this->resonance || sampleRate != this->sampleRate) {
+            this->resonance = resonance;
+            this->sampleRate = sampleRate;
+            float c[POLYSHAKERS_RESONANCES] = {};
+            float scale = std::pow(4.f, resonance - 0.5f);
+            for (int i = 0; i < type->resonances; i++) {
+                frequencies[i] = type->frequencies[i] * scale;
+                c[i] = coefficient(frequencies[i], type->radii[i]);
+            }
+            for (int j = 0; j < 2; j++) {
+                a1[j] = float_4::load(c + 4 * j);
+                da1[j] = 0.f;
+            }
+        }
+    }
+
+    // Shakers::noteOn(), with the amplitude already scaled
+    void shake(float amount) {
+        shakeEnergy = std::min(shakeEnergy + amount, 1.f);
+        if (type->kind == POLYSHAKERS_RATCHET)
+            ratchetCount += 1.f;
+        awake = true;
+    }
+
+    // Per block work: the ratchet noise, the water sweep, and whether the voice can sleep
+    void startBlock() {
+        if (type->kind == POLYSHAKERS_RATCHET) {
+            for (int n = 0; n < POLYSHAKERS_BLOCK; n++)
+                noise[n] = 2.f * uniform() - 1.f;
+        }
+        if (type->kind == POLYSHAKERS_WATER)
+            sweepWater(POLYSHAKERS_BLOCK);
+
+        bool shaking = type->kind == POLYSHAKERS_RATCHET ? ratchetCount > 0.f : shakeEnergy >= POLYSHAKERS_MIN_ENERGY;
+        if (!shaking && peak < POLYSHAKERS_SILENCE && sndLevel < POLYSHAKERS_SILENCE) {
+            awake = false;
+            clear();
+        }
+        peak = 0.f;
+    }
+
+    // Ramps the drops still sounding to where WATER_FREQ_SWEEP takes them in `samples`
+    void sweepWater(int samples) {
+        float g[POLYSHAKERS_RESONANCES], c[POLYSHAKERS_RESONANCES], current[POLYSHAKERS_RESONANCES];
+        for (int j = 0; j < 2; j++) {
+            gain[j].store(g + 4 * j);
+            a1[j].store(current + 4 * j);
+        }
+        float sweep = std::pow(POLYSHAKERS_WATER_SWEEP, (float) samples);
+        for (int i = 0; i < POLYSHAKERS_RESONANCES; i++) {
+            c[i] = 0.f;
+            if (i < 3 && g[i] > 0.f) {
+                frequencies[i] *= sweep;
+                c[i] = (coefficient(frequencies[i], type->radii[i]) - current[i]) / samples;
+            }
+        }
+        for (int j = 0; j < 2; j++)
+            da1[j] = float_4::load(c + 4 * j);
+    }
+
+    // Shakers::waterDrop(), starting a drop in one of the three resonances
+    void waterDrop() {
+        sndLevel = shakeEnergy;
+        int j = std::min((int) (3.f * uniform()), 2);
+        int i = j;
+        float g[POLYSHAKERS_RESONANCES];
+        gain[0].store(g);
+        if (j < 2 && g[i] != 0.f)
+            i = 2;
+        if (g[i] != 0.f)
+            return;
+        static const float offsets[3] = {0.75f, 1.f, 1.25f};
+        float scale = std::pow(4.f, resonance - 0.5f);
+        frequencies[i] = type->frequencies[1] * scale * (offsets[i] + 0.25f * (2.f * uniform() - 1.f));
+        g[i] = std::fabs(2.f * uniform() - 1.f);
+        gain[0] = float_4::load(g);
+        float c[4];
+        a1[0].store(c);
+        c[i] = coefficient(frequencies[i], type->radii[i]);
+        a1[0] = float_4::load(c);
+
+        // Sweep to the end of the block from here
+        float d[4];
+        da1[0].store(d);
+        int remaining = POLYSHAKERS_BLOCK - position;
+        d[i] = (coefficient(frequencies[i] * std::pow(POLYSHAKERS_WATER_SWEEP, (float) remaining), type->radii[i]) - c[i]) / remaining;
+        frequencies[i] *= std::pow(POLYSHAKERS_WATER_SWEEP, (float) remaining);
+        da1[0] = float_4::load(d);
+    }
+
+    float tick() {
+        if (position == 0)
+            startBlock();
+        if (!awake)
+            return 0.f;
+
+        float input = 0.f;
+        float_4 lanes[2] = {1.f, 1.f};
+
+        if (type->kind == POLYSHAKERS_RATCHET) {
+            if (ratchetCount > 0.f) {
+                shakeEnergy -= type->systemDecay + 0.002f * shakeEnergy;
+                if (shakeEnergy < 0.f) {
+                    shakeEnergy = 1.f;
+                    ratchetCount -= 1.f;
+                }
+                if (--untilEvent <= 0) {
+                    sndLevel += shakeEnergy * shakeEnergy;
+                    untilEvent = nextEvent();
+                }
+                input = sndLevel * noise[position] * shakeEnergy;
+            }
+        }
+        else if (shakeEnergy >= POLYSHAKERS_MIN_ENERGY) {
+            shakeEnergy *= systemDecay;
+
+            if (type->kind == POLYSHAKERS_WATER) {
+                if (--untilEvent <= 0) {
+                    waterDrop();
+                    untilEvent = nextEvent();
+                }
+                input = sndLevel;
+            }
+            else if (--untilEvent <= 0) {
+                sndLevel += shakeEnergy;
+                input = sndLevel;
+                untilEvent = nextEvent();
+
+                if (type->varyFactor > 0.f) {
+                    float c[POLYSHAKERS_RESONANCES];
+                    for (int j = 0; j < 2; j++)
+                        a1[j].store(c + 4 * j);
+                    for (int i = 0; i < type->resonances; i++) {
+                        if (type->vary[i])
+                            c[i] = coefficient(frequencies[i] * (1.f + type->varyFactor * (2.f * uniform() - 1.f)), type->radii[i]);
+                    }
+                    for (int j = 0; j < 2; j++)
+                        a1[j] = float_4::load(c + 4 * j);
+                }
+                // The angklung strikes one tube at a time
+                if (type->kind == POLYSHAKERS_TUBES) {
+                    int tube = (int) (7.f * uniform());
+                    float l[POLYSHAKERS_RESONANCES] = {};
+                    l[tube] = 1.f;
+                    lanes[0] = float_4::load(l);
+                    lanes[1] = float_4::load(l + 4);
+                }
+            }
+        }
+        sndLevel *= type->soundDecay;
+
+        // The water drops fade and sweep on their own
+        if (type->kind == POLYSHAKERS_WATER) {
+            gain[0] *= radii[0];
+            gain[0] = simd::ifelse(gain[0] > 0.001f, gain[0], 0.f);
+            a1[0] += da1[0];
+        }
+
+        float_4 x = input * currentGain;
+        float_4 y = 0.f;
+        int groups = type->resonances > 4 ? 2 : 1;
+        for (int j = 0; j < groups; j++) {
+            float_4 yj = x * lanes[j] * gain[j] - a1[j] * y1[j] - a2[j] * y2[j];
+            y2[j] = y1[j];
+            y1[j] = yj;
+            y += yj;
+        }
+        float sum = y[0] + y[1] + y[2] + y[3];
+
+        // Shakers::tickEqualize()
+        float out = type->equalizer[0] * sum + type->equalizer[1] * equalizer1 + type->equalizer[2] * equalizer2;
+        equalizer2 = equalizer1;
+        equalizer1 = sum;
+
+        peak = std::max(peak, std::fabs(sum));
+        if (++position >= POLYSHAKERS_BLOCK)
+            position = 0;
+        return out;
+    }
+};
+
+struct PolyShakers: Module {
+    enum ParamIds {
+        TYPE_PARAM,
+        SHAKE_PARAM,
+        DECAY_PARAM,
+        OBJECTS_PARAM,
+        RESONANCE_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        TRIG_INPUT,
+        VELOCITY_INPUT,
+        TYPE_INPUT,
+        DECAY_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        OUT_OUTPUT,
+        MIX_OUTPUT,
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        ACTIVE_LIGHT,
+        NUM_LIGHTS
+    };
+
+    PolyShakersVoice voices[POLYSHAKERS_VOICES];
+    dsp::SchmittTrigger triggers[POLYSHAKERS_VOICES];
+    dsp::ClockDivider paramDivider;
+    dsp::ClockDivider lightDivider;
+    float decay[POLYSHAKERS_VOICES] = {};
+    float objects = 0.5f;
+    float resonance = 0.5f;
+
+    // Display
+    const char *typeName = POLYSHAKERS_TYPES[0].name;
+
+    PolyShakers() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(PolyShakers::TYPE_PARAM, 0.0, POLYSHAKERS_NUM_TYPES - 1, 0.0, "Instrument");
+        configParam(PolyShakers::SHAKE_PARAM, 0.0, 1.0, 0.5, "Shake", "%", 0, 100);
+        configParam(PolyShakers::DECAY_PARAM, 0.0, 1.0, 0.5, "Decay", "%", 0, 100);
+        configParam(PolyShakers::OBJECTS_PARAM, 0.0, 1.0, 0.5, "Objects", "%", 0, 100);
+        configParam(PolyShakers::RESONANCE_PARAM, 0.0, 1.0, 0.5, "Resonance", "%", 0, 100);
+        paramDivider.setDivision(POLYSHAKERS_BLOCK);
+        lightDivider.setDivision(512);
+        for (int c = 0; c < POLYSHAKERS_VOICES; c++) {
+            voices[c].rng = 0x9E3779B9u * (c + 1);
+            decay[c] = 0.5f;
+        }
+    }
+
+    int typeFor(int c) {
+        // 10V runs through every instrument
+        float type = params[TYPE_PARAM].getValue() + inputs[TYPE_INPUT].getPolyVoltage(c) * ((POLYSHAKERS_NUM_TYPES - 1) / 10.f);
+        return clamp((int) roundf(type), 0, POLYSHAKERS_NUM_TYPES - 1);
+    }
+
+    void process(const ProcessArgs& args) override {
+        int channels = std::max(1, inputs[TRIG_INPUT].getChannels());
+
+        if (paramDivider.process()) {
+            objects = params[OBJECTS_PARAM].getValue();
+            resonance = params[RESONANCE_PARAM].getValue();
+            for (int c = 0; c < channels; c++) {
+                decay[c] = clamp(params[DECAY_PARAM].getValue() + inputs[DECAY_INPUT].getPolyVoltage(c) / 10.f, 0.f, 1.f);
+                if (voices[c].awake)
+                    voices[c].setControls(decay[c], objects, resonance, args.sampleRate);
+            }
+            typeName = POLYSHAKERS_TYPES[typeFor(0)].name;
+        }
+
+        outputs[OUT_OUTPUT].setChannels(channels);
+        float mix = 0.f;
+        int active = 0;
+        for (int c = 0; c < channels; c++) {
+            PolyShakersVoice &voice = voices[c];
+            if (triggers[c].process(inputs[TRIG_INPUT].getPolyVoltage(c))) {
+                // The instrument is latched on each shake, switching starts it afresh
+                int type = typeFor(c);
+                if (type != voice.typeIndex)
+                    voice.setType(type);
+                float velocity = inputs[VELOCITY_INPUT].isConnected() ? clamp(inputs[VELOCITY_INPUT].getPolyVoltage(c) / 10.f, 0.f, 1.f) : 1.f;
+                voice.setControls(decay[c], objects, resonance, args.sampleRate);
+                voice.shake(params[SHAKE_PARAM].getValue() * velocity);
+            }
+
+            float out = 0.f;
+            if (voice.awake) {
+                out = voice.tick() * 5.f;
+                active++;
+            }
+            outputs[OUT_OUTPUT].setVoltage(out, c);
+            mix += out;
+        }
+        outputs[MIX_OUTPUT].setVoltage(mix);
+
+        if (lightDivider.process())
+            lights[ACTIVE_LIGHT].setBrightness((float) active / channels);
+    }
+};
+
+
+struct PolyShakersTypeDisplay : RJValueDisplay<const char *> {
+    PolyShakersTypeDisplay() {
+        fontSize = 16;
+        letterSpacing = 0.5;
+        text = POLYSHAKERS_TYPES[0].name;
+    }
+
+    std::string format(const char * const &v) override {
+        return v;
+    }
+
+    void drawText(NVGcontext *vg) override {
+        nvgTextAlign(vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(vg, box.size.x / 2, box.size.y / 2, text.c_str(), NULL);
+    }
+};
+
+
+struct PolyShakersWidget: ModuleWidget {
+    PolyShakersWidget(PolyShakers *module);
+};
+
+PolyShakersWidget::PolyShakersWidget(PolyShakers *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/PolyShakers.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    {
+        PolyShakersTypeDisplay *display = new PolyShakersTypeDisplay();
+        display->box.pos = Vec(10, 40);
+        display->box.size = Vec(130, 30);
+        display->value = module ? &module->typeName : NULL;
+        addChild(display);
+    }
+
+    addParam(createParam<PolyShakersRoundLargeBlackKnob>(Vec(14, 80), module, PolyShakers::TYPE_PARAM));
+    addParam(createParam<PolyShakersRoundLargeBlackKnob>(Vec(88, 80), module, PolyShakers::SHAKE_PARAM));
+    addParam(createParam<PolyShakersRoundLargeBlackKnob>(Vec(14, 145), module, PolyShakers::DECAY_PARAM));
+    addParam(createParam<PolyShakersRoundLargeBlackKnob>(Vec(88, 145), module, PolyShakers::OBJECTS_PARAM));
+    addParam(createParam<PolyShakersRoundLargeBlackKnob>(Vec(51, 200), module, PolyShakers::RESONANCE_PARAM));
+    addChild(createLight<MediumLight<GreenLight>>(Vec(70, 260), module, PolyShakers::ACTIVE_LIGHT));
+
+    addInput(createInput<PJ301MPort>(Vec(10, 280), module, PolyShakers::TRIG_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(45, 280), module, PolyShakers::VELOCITY_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(80, 280), module, PolyShakers::TYPE_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(112.5, 280), module, PolyShakers::DECAY_INPUT));
+
+    addOutput(createOutput<PJ301MPort>(Vec(45, 320), module, PolyShakers::OUT_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(80, 320), module, PolyShakers::MIX_OUTPUT));
+}
+
+Model *modelPolyShakers = createModel<PolyShakers, PolyShakersWidget>("PolyShakers");
@@ -1,40 +1,152 @@
+/*
+PolySidechain - a polyphonic sidechain compressor.
+
+An RMS or peak envelope follower listens to the key input (or to the signal
+itself when nothing is patched there) and drives a soft-knee gain computer.
+All 16 channels are processed four at a time in float_4 lanes, so one
+instance can duck a whole poly bus.
+*/
+
 #include "RJModules.hpp"
 #include <iostream>
 #include <cmath>
 
+using simd::float_4;
+
+struct PolySidechainRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    PolySidechainRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+struct PolySidechainRoundSmallBlackKnob : RoundSmallBlackKnob
+{
+    PolySidechainRoundSmallBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundSmallBlackKnob.svg")));
+    }
+};
+
+// Levels are measured in dB relative to 5V
+static const float SIDECHAIN_REFERENCE = 5.0f;
+static const float SIDECHAIN_FLOOR = 1e-5f;
+
+struct PolySidechainFollower {
+    float_4 env = 0.f;
+    float_4 gain = 1.f;
+
+    float_4 process(float_4 key, bool rms, float attack, float release, float threshold, float slope, float knee) {
+        // Track either the rectified signal or its square
+        float_4 x = rms ? key * key : simd::fabs(key);
+        float_4 coef = simd::ifelse(x > env, float_4(attack), float_4(release));
+        env += (x - env) * coef;
+
+        float_4 level = rms ? simd::sqrt(env) : env;
+        float_4 levelDb = 20.f * simd::log10(simd::fmax(level / SIDECHAIN_REFERENCE, SIDECHAIN_FLOOR));
+
+        // Soft knee: quadratic over [threshold - knee / 2, threshold + knee / 2]
+        float_4 over = levelDb - threshold;
+        float_4 reduction = slope * over;
+        if (knee > 0.f) {
+            float_4 inKnee = simd::fabs(over) * 2.f <= knee;
+            float_4 k = over + knee * 0.5f;
+            reduction = simd::ifelse(inKnee, slope * k * k / (2.f * knee), reduction);
+            reduction = simd::ifelse(over * 2.f < -knee, 0.f, reduction);
+        } else {
+            reduction = simd::ifelse(over < 0.f, 0.f, reduction);
+        }
+
+        // 10^(dB / 20)
+        gain = simd::exp(reduction * 0.11512925f);
+        return gain;
+    }
+};
+
 struct PolySidechain: Module {
     enum ParamIds {
+        THRESHOLD_PARAM,
         RATIO_PARAM,
-        DECAY_PARAM,
+        ATTACK_PARAM,
+        RELEASE_PARAM,
+        KNEE_PARAM,
+        MODE_PARAM,
         NUM_PARAMS
     };
     enum InputIds {
-        CH1_INPUT,
-        TRIGGER_INPUT,
+        IN_INPUT,
+        KEY_INPUT,
+        THRESHOLD_CV_INPUT,
         RATIO_CV_INPUT,
-        DECAY_CV_INPUT,
         NUM_INPUTS
     };
     enum OutputIds {
-        CH1_OUTPUT,
+        OUT_OUTPUT,
+        GR_OUTPUT,
         NUM_OUTPUTS
     };
 
-    float decayAmount = 0.0;
+    PolySidechainFollower followers[4];
+    dsp::ClockDivider paramDivider;
+
+    float attackCoef = 1.f;
+    float releaseCoef = 1.f;
+    float threshold = -20.f;
+    float slope = 0.f;
+    float knee = 6.f;
+    bool rms = true;
+
     PolySidechain() {
         config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS);
-        configParam(PolySidechain::RATIO_PARAM, 0.0, 1.0, 1.0, "");
-        configParam(PolySidechain::DECAY_PARAM, 0.0, 1.0, 0.3, "");
+        configParam(PolySidechain::THRESHOLD_PARAM, -60.0, 0.0, -20.0, "Threshold", " dB");
+        configParam(PolySidechain::RATIO_PARAM, 1.0, 20.0, 4.0, "Ratio", ":1");
+        configParam(PolySidechain::ATTACK_PARAM, 0.1, 100.0, 5.0, "Attack", " ms");
+        configParam(PolySidechain::RELEASE_PARAM, 10.0, 1000.0, 150.0, "Release", " ms");
+        configParam(PolySidechain::KNEE_PARAM, 0.0, 24.0, 6.0, "Knee", " dB");
+        configParam(PolySidechain::MODE_PARAM, 0.0, 1.0, 1.0, "Detector (Peak / RMS)");
+        paramDivider.setDivision(16);
     }
-    void step() override;
-};
 
+    void updateParams(float sampleRate) {
+        float attack = params[ATTACK_PARAM].getValue() * 0.001f;
+        float release = params[RELEASE_PARAM].getValue() * 0.001f;
+        attackCoef = 1.f - expf(-1.f / (attack * sampleRate));
+        releaseCoef = 1.f - expf(-1.f / (release * sampleRate));
 
-#define ROUND(f) ((float)((f > 0.0) ? floor(f + 0.5) : ceil(f - 0.5)))
+        threshold = params[THRESHOLD_PARAM].getValue() + inputs[THRESHOLD_CV_INPUT].getVoltage() * 6.f;
+        float ratio = clamp(params[RATIO_PARAM].getValue() + inputs[RATIO_CV_INPUT].getVoltage() * 2.f, 1.f, 20.f);
+        slope = 1.f / ratio - 1.f;
+        knee = params[KNEE_PARAM].getValue();
+        rms = params[MODE_PARAM].getValue() > 0.5f;
+    }
 
-void PolySidechain::step() {
+    void process(const ProcessArgs &args) override {
+        if (paramDivider.process()) {
+            updateParams(args.sampleRate);
+        }
 
-}
+        int channels = std::max(1, inputs[IN_INPUT].getChannels());
+        bool keyed = inputs[KEY_INPUT].isConnected();
+        bool monoKey = inputs[KEY_INPUT].getChannels() == 1;
+
+        for (int c = 0; c < channels; c += 4) {
+            float_4 in = inputs[IN_INPUT].getVoltageSimd<float_4>(c);
+            float_4 key = in;
+            if (keyed) {
+                // A mono key ducks every channel, a poly key ducks channel by channel
+                key = monoKey ? float_4(inputs[KEY_INPUT].getVoltage()) : inputs[KEY_INPUT].getPolyVoltageSimd<float_4>(c);
+            }
+
+            float_4 gain = followers[c / 4].process(key, rms, attackCoef, releaseCoef, threshold, slope, knee);
+            outputs[OUT_OUTPUT].setVoltageSimd(in * gain, c);
+            outputs[GR_OUTPUT].setVoltageSimd(10.f * (1.f - gain), c);
+        }
+
+        outputs[OUT_OUTPUT].setChannels(channels);
+        outputs[GR_OUTPUT].setChannels(channels);
+    }
+};
 
 
 struct PolySidechainWidget: ModuleWidget {
@@ -57,15 +169,20 @@ PolySidechainWidget::PolySidechainWidget(PolySidechain *module) {
     addChild(createWidget<ScrewSilver>(Vec(15, 365)));
     addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
 
-    addParam(createParam<RoundBlackKnob>(Vec(57, 159), module, PolySidechain::RATIO_PARAM));
-    addParam(createParam<RoundBlackKnob>(Vec(57, 239), module, PolySidechain::DECAY_PARAM));
+    addParam(createParam<PolySidechainRoundLargeBlackKnob>(Vec(14, 50), module, PolySidechain::THRESHOLD_PARAM));
+    addParam(createParam<PolySidechainRoundLargeBlackKnob>(Vec(88, 50), module, PolySidechain::RATIO_PARAM));
+    addParam(createParam<PolySidechainRoundLargeBlackKnob>(Vec(14, 125), module, PolySidechain::ATTACK_PARAM));
+    addParam(createParam<PolySidechainRoundLargeBlackKnob>(Vec(88, 125), module, PolySidechain::RELEASE_PARAM));
+    addParam(createParam<PolySidechainRoundSmallBlackKnob>(Vec(20, 205), module, PolySidechain::KNEE_PARAM));
+    addParam(createParam<CKSS>(Vec(101, 205), module, PolySidechain::MODE_PARAM));
 
-    addInput(createInput<PJ301MPort>(Vec(22, 100), module, PolySidechain::CH1_INPUT));
-    addInput(createInput<PJ301MPort>(Vec(22, 180), module, PolySidechain::RATIO_CV_INPUT));
-    addInput(createInput<PJ301MPort>(Vec(22, 260), module, PolySidechain::DECAY_CV_INPUT));
-    addInput(createInput<PJ301MPort>(Vec(110, 100), module, PolySidechain::TRIGGER_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(22, 260), module, PolySidechain::THRESHOLD_CV_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(100, 260), module, PolySidechain::RATIO_CV_INPUT));
 
-    addOutput(createOutput<PJ301MPort>(Vec(110, 305), module, PolySidechain::CH1_OUTPUT));
+    addInput(createInput<PJ301MPort>(Vec(10, 320), module, PolySidechain::IN_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(45, 320), module, PolySidechain::KEY_INPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(80, 320), module, PolySidechain::GR_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(112.5, 320), module, PolySidechain::OUT_OUTPUT));
 }
 
 Model *modelPolySidechain = createModel<PolySidechain, PolySidechainWidget>("PolySidechain");
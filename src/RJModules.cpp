@@ -16,12 +16,17 @@ void init(rack::Plugin *p) {
     p->addModel(modelRangeLFO);
     p->addModel(modelAcid);
     p->addModel(modelEssEff);
-    // p->addModel(modelDrumpler);
+    p->addModel(modelDrumpler);
     // p->addModel(modelRiser);
     // p->addModel(modelThreeXOSC);
     p->addModel(modelOcto);
     p->addModel(modelInstro);
     p->addModel(modelGlutenFree);
+    p->addModel(modelMeshDrum);
+    p->addModel(modelBlitOsc);
+    p->addModel(modelFormant);
+    p->addModel(modelPolyShakers);
+    p->addModel(modelStrings);
 
     // VCA
     p->addModel(modelPluck);
@@ -33,12 +38,17 @@ void init(rack::Plugin *p) {
     p->addModel(modelSidechain);
     p->addModel(modelStutter);
     p->addModel(modelGlides);
-    // p->addModel(modelPolySidechain);
+    p->addModel(modelPolySidechain);
     p->addModel(modelPingPong);
     p->addModel(modelBrickwall);
     p->addModel(modelSlapback);
     p->addModel(modelRJChorus);
     p->addModel(modelSubOsc);
+    p->addModel(modelPitchShift);
+    p->addModel(modelReverb);
+    p->addModel(modelResonator);
+    p->addModel(modelCabinet);
+    p->addModel(modelStkFx);
 
     // Filters
     p->addModel(modelFilter);
@@ -77,6 +87,8 @@ void init(rack::Plugin *p) {
     p->addModel(modelDisplays);
     p->addModel(modelRange);
     p->addModel(modelOctaves);
+    p->addModel(modelFFTuner);
+    p->addModel(modelDiskRecorder);
     p->addModel(modelBuffers);
     p->addModel(modelChord);
     p->addModel(modelPlayableChord);
@@ -92,6 +104,7 @@ void init(rack::Plugin *p) {
     p->addModel(modelEuclidian);
     p->addModel(modelGaussian);
     p->addModel(modelMegaDivider);
+    p->addModel(modelMidiPlayer);
 
     // Quantizer
     p->addModel(modeluQuant);
@@ -47,11 +47,11 @@ extern Model *modeluQuant;
 extern Model *modelPluck;
 extern Model *modelAcid;
 extern Model *modelEssEff;
-// extern Model *modelDrumpler;
+extern Model *modelDrumpler;
 extern Model *modelKTF;
 extern Model *modelTriggerSwitch;
 extern Model *modelDryWet;
-// extern Model *modelPolySidechain;
+extern Model *modelPolySidechain;
 extern Model *modelMutateSeq;
 extern Model *modelNotes;
 extern Model *modelSequential;
@@ -71,3 +71,16 @@ extern Model *modelMegaDivider;
 extern Model *modelGravityGlide;
 extern Model *modelSubOsc;
 extern Model *modelGuitarNeck;
+extern Model *modelPitchShift;
+extern Model *modelFFTuner;
+extern Model *modelDiskRecorder;
+extern Model *modelMidiPlayer;
+extern Model *modelReverb;
+extern Model *modelMeshDrum;
+extern Model *modelResonator;
+extern Model *modelBlitOsc;
+extern Model *modelFormant;
+extern Model *modelPolyShakers;
+extern Model *modelStrings;
+extern Model *modelCabinet;
+extern Model *modelStkFx;
@@ -1,4 +1,5 @@
 #include "RJModules.hpp"
+#include "UI.hpp"
 
 #include "dsp/digital.hpp"
 #include "common.hpp"
@@ -48,39 +49,14 @@ struct Range: Module {
     void step() override;
 };
 
-struct SmallNumberDisplayWidgeter : TransparentWidget {
-
-  float *value;
-
-  void draw(NVGcontext *vg) override
-  {
-    // Background
-    NVGcolor backgroundColor = nvgRGB(0xC0, 0xC0, 0xC0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
-    nvgFillColor(vg, backgroundColor);
-    nvgFill(vg);
-
-    // text
-    std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, "res/Segment7Standard.ttf"));
-    if (font) {
-    nvgFontSize(vg, 16);
-    nvgFontFaceId(vg, font->handle);
-    nvgTextLetterSpacing(vg, 0.5);
-    }
-
-    std::stringstream to_display;
-    to_display = format4display(*value);
-
-    Vec textPos = Vec(8.0f, 33.0f);
-    NVGcolor textColor = nvgRGB(0x00, 0x00, 0x00);
-    nvgFillColor(vg, textColor);
-    nvgText(vg, textPos.x, textPos.y, to_display.str().c_str(), NULL);
-
-    nvgFontSize(vg, 8);
-    textPos = Vec(1.0f, (*value<0?28.0f:32.0f));
-    nvgText(vg, textPos.x, textPos.y, (*value<0?"-":"+"), NULL);
-
+struct SmallNumberDisplayWidgeter : RJNumberDisplay {
+  SmallNumberDisplayWidgeter() {
+    fontSize = 16;
+    letterSpacing = 0.5;
+    textPos = Vec(8.0f, 33.0f);
+    signSize = 8;
+    signPos[0] = Vec(1.0f, 28.0f);
+    signPos[1] = Vec(1.0f, 32.0f);
   }
 };
 
@@ -0,0 +1,374 @@
+/*
+Resonator - a bank of up to 64 tuned modes excited by external audio.
+
+Each mode is stk::BiQuad::setResonance() with normalised zeros, as used by
+stk::Modal and stk::BandedWG, but the bank is laid out as structure of
+arrays: four modes share each float_4 of coefficients and state. All modes
+hear the same input, so the zeros reduce to one (x - x[n-2]) per sample.
+
+Coefficients are recomputed once per RESONATOR_BLOCK frames, and only when
+a control moved. Mode groups whose state has died away are skipped until
+new input arrives, and modes past the Nyquist limit are dropped.
+*/
+
+#include "RJModules.hpp"
+#include "UI.hpp"
+#include <iostream>
+#include <cmath>
+
+using simd::float_4;
+
+static const int RESONATOR_BLOCK = 32;
+static const int RESONATOR_MODES = 64;
+static const int RESONATOR_GROUPS = RESONATOR_MODES / 4;
+static const int RESONATOR_VOICES = 16;
+static const float RESONATOR_SILENCE = 1e-6f;
+static const char *RESONATOR_MODELS[] = {"HARMONIC", "ODD", "STRING", "BAR", "TUNED BAR", "GLASS", "BOWL"};
+static const int RESONATOR_NUM_MODELS = 7;
+
+struct ResonatorRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    ResonatorRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+// Mode frequency ratios for each model, the fixed tables are BandedWG's presets
+static int resonatorRatios(int model, float *ratios) {
+    static const float tunedBar[] = {1.0, 4.0198391420, 10.7184986595, 18.0697050938};
+    static const float glass[] = {1.0, 2.32, 4.25, 6.63, 9.38};
+    static const float bowl[] = {0.996108344, 1.0038916562, 2.979178, 2.99329767, 5.704452, 5.704452,
+        8.9982, 9.01549726, 12.83303, 12.807382, 17.2808219, 21.97602739726};
+    // Free-free bar roots, then their (2k + 3) pi / 2 asymptote
+    static const float barRoots[] = {4.7300408, 7.8532046, 10.9956078, 14.1371655};
+
+    switch (model) {
+    case 1:
+        for (int k = 0; k < RESONATOR_MODES; k++)
+            ratios[k] = 2 * k + 1;
+        return RESONATOR_MODES;
+    case 2:
+        // Stiff string partials
+        for (int k = 0; k < RESONATOR_MODES; k++)
+            ratios[k] = (k + 1) * sqrtf(1.f + 0.0004f * (k + 1) * (k + 1)) / sqrtf(1.0004f);
+        return RESONATOR_MODES;
+    case 3:
+        for (int k = 0; k < RESONATOR_MODES; k++) {
+            float root = k < 4 ? barRoots[k] : (2 * k + 3) * M_PI / 2;
+            ratios[k] = (root / barRoots[0]) * (root / barRoots[0]);
+        }
+        return RESONATOR_MODES;
+    case 4:
+        std::copy(tunedBar, tunedBar + 4, ratios);
+        return 4;
+    case 5:
+        std::copy(glass, glass + 5, ratios);
+        return 5;
+    case 6:
+        std::copy(bowl, bowl + 12, ratios);
+        return 12;
+    default:
+        for (int k = 0; k < RESONATOR_MODES; k++)
+            ratios[k] = k + 1;
+        return RESONATOR_MODES;
+    }
+}
+
+struct ResonatorVoice {
+    // y = gain * (x - x[n-2]) - a1 * y[n-1] - a2 * y[n-2], four modes per vector
+    float_4 a1[RESONATOR_GROUPS];
+    float_4 a2[RESONATOR_GROUPS];
+    float_4 gain[RESONATOR_GROUPS];
+    float_4 y1[RESONATOR_GROUPS];
+    float_4 y2[RESONATOR_GROUPS];
+    float x1 = 0.f;
+    float x2 = 0.f;
+    int groups = 0;
+    // One bit per group that is still ringing
+    uint32_t ringing = 0;
+
+    // Control values the coefficients were last computed for
+    float frequency = -1.f;
+    float t60 = -1.f;
+    float damp = -1.f;
+    float bright = -1.f;
+    int model = -1;
+    int modes = -1;
+
+    ResonatorVoice() {
+        for (int g = 0; g < RESONATOR_GROUPS; g++) {
+            a1[g] = 0.f;
+            a2[g] = 0.f;
+            gain[g] = 0.f;
+        }
+        clear();
+    }
+
+    void clear() {
+        for (int g = 0; g < RESONATOR_GROUPS; g++) {
+            y1[g] = 0.f;
+            y2[g] = 0.f;
+        }
+        x1 = 0.f;
+        x2 = 0.f;
+        ringing = 0;
+    }
+
+    void setModes(float frequency, float t60, float damp, float bright, int model, int modes, float sampleRate) {
+        if (frequency == this->frequency && t60 == this->t60 && damp == this->damp && bright == this->bright &&
+            model == this->model && modes == this->modes)
+            return;
+        this->frequency = frequency;
+        this->t60 = t60;
+        this->damp = damp;
+        this->bright = bright;
+        this->model = model;
+        this->modes = modes;
+
+        alignas(16) float ratios[RESONATOR_MODES];
+        int count = std::min(modes, resonatorRatios(model, ratios));
+        for (int k = count; k < RESONATOR_MODES; k++)
+            ratios[k] = 0.f;
+
+        int used = 0;
+        for (int g = 0; g < RESONATOR_GROUPS; g++) {
+            float_4 ratio = float_4::load(&ratios[g * 4]);
+            float_4 f = ratio * frequency;
+            // Silent lanes: unused modes and modes past Nyquist
+            float_4 audible = (ratio > 0.f) & (f < sampleRate * 0.45f);
+            // Higher modes die sooner, by up to the square of their ratio
+            float_4 r = simd::exp(-6.9077553f * simd::pow(simd::fmax(ratio, 1.f), damp * 2.f) / (t60 * sampleRate));
+            a2[g] = r * r;
+            a1[g] = -2.f * r * simd::cos(2.f * M_PI * f / sampleRate);
+            gain[g] = simd::ifelse(audible, (0.5f - 0.5f * a2[g]) * simd::pow(simd::fmax(ratio, 1.f), (bright - 1.f) * 1.5f), 0.f);
+            for (int i = 0; i < 4; i++) {
+                if (gain[g][i] != 0.f)
+                    used = g + 1;
+            }
+        }
+        for (int g = used; g < groups; g++) {
+            y1[g] = 0.f;
+            y2[g] = 0.f;
+        }
+        groups = used;
+    }
+
+    void process(const float *in, float *out) {
+        float dx[RESONATOR_BLOCK];
+        float excited = 0.f;
+        for (int i = 0; i < RESONATOR_BLOCK; i++) {
+            dx[i] = in[i] - x2;
+            x2 = x1;
+            x1 = in[i];
+            excited = std::max(excited, std::fabs(dx[i]));
+        }
+        bool input = excited > RESONATOR_SILENCE;
+
+        float_4 sums[RESONATOR_BLOCK];
+        for (int i = 0; i < RESONATOR_BLOCK; i++)
+            sums[i] = 0.f;
+
+        for (int g = 0; g < groups; g++) {
+            if (!input && !(ringing & (1u << g)))
+                continue;
+            float_4 b = gain[g];
+            float_4 c1 = a1[g];
+            float_4 c2 = a2[g];
+            float_4 s1 = y1[g];
+            float_4 s2 = y2[g];
+            for (int i = 0; i < RESONATOR_BLOCK; i++) {
+                float_4 y = b * dx[i] - c1 * s1 - c2 * s2;
+                s2 = s1;
+                s1 = y;
+                sums[i] += y;
+            }
+            y1[g] = s1;
+            y2[g] = s2;
+
+            float_4 level = simd::fabs(s1) + simd::fabs(s2);
+            if (std::max(std::max(level[0], level[1]), std::max(level[2], level[3])) > RESONATOR_SILENCE)
+                ringing |= 1u << g;
+            else {
+                ringing &= ~(1u << g);
+                y1[g] = 0.f;
+                y2[g] = 0.f;
+            }
+        }
+
+        for (int i = 0; i < RESONATOR_BLOCK; i++)
+            out[i] = sums[i][0] + sums[i][1] + sums[i][2] + sums[i][3];
+    }
+};
+
+struct Resonator: Module {
+    enum ParamIds {
+        FREQ_PARAM,
+        MODES_PARAM,
+        DECAY_PARAM,
+        DAMP_PARAM,
+        BRIGHT_PARAM,
+        MIX_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        IN_INPUT,
+        VOCT_INPUT,
+        DECAY_INPUT,
+        BRIGHT_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        OUT_OUTPUT,
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        NUM_LIGHTS
+    };
+
+    ResonatorVoice voices[RESONATOR_VOICES];
+    float blockIn[RESONATOR_VOICES][RESONATOR_BLOCK] = {};
+    float blockOut[RESONATOR_VOICES][RESONATOR_BLOCK] = {};
+    int blockPos = 0;
+    int channels = 1;
+
+    int model_index = 0;
+    const char *modelName = RESONATOR_MODELS[0];
+
+    Resonator() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(Resonator::FREQ_PARAM, -4.0, 4.0, 0.0, "Frequency", " Hz", 2, dsp::FREQ_C4);
+        configParam(Resonator::MODES_PARAM, 1.0, 64.0, 16.0, "Modes");
+        configParam(Resonator::DECAY_PARAM, 0.0, 1.0, 0.5, "Decay", " s", 400, 0.05);
+        configParam(Resonator::DAMP_PARAM, 0.0, 1.0, 0.3, "High mode damping", "%", 0, 100);
+        configParam(Resonator::BRIGHT_PARAM, 0.0, 1.0, 0.5, "Brightness", "%", 0, 100);
+        configParam(Resonator::MIX_PARAM, 0.0, 1.0, 1.0, "Dry/Wet", "%", 0, 100);
+    }
+
+    json_t *dataToJson() override {
+        json_t *rootJ = json_object();
+        json_object_set_new(rootJ, "model", json_integer(model_index));
+        return rootJ;
+    }
+
+    void dataFromJson(json_t *rootJ) override {
+        json_t *modelJ = json_object_get(rootJ, "model");
+        if (modelJ)
+            model_index = clamp((int) json_integer_value(modelJ), 0, RESONATOR_NUM_MODELS - 1);
+    }
+
+    void processBlock(float sampleRate) {
+        int model = model_index;
+        modelName = RESONATOR_MODELS[model];
+        int modes = (int) roundf(params[MODES_PARAM].getValue());
+        float damp = params[DAMP_PARAM].getValue();
+
+        for (int c = 0; c < channels; c++) {
+            float pitch = params[FREQ_PARAM].getValue() + inputs[VOCT_INPUT].getPolyVoltage(c);
+            float frequency = dsp::FREQ_C4 * dsp::approxExp2_taylor5(clamp(pitch, -6.f, 6.f));
+            float decay = clamp(params[DECAY_PARAM].getValue() + inputs[DECAY_INPUT].getPolyVoltage(c) / 10.f, 0.f, 1.f);
+            float bright = clamp(params[BRIGHT_PARAM].getValue() + inputs[BRIGHT_INPUT].getPolyVoltage(c) / 10.f, 0.f, 1.f);
+            voices[c].setModes(frequency, 0.05f * powf(400.f, decay), damp, bright, model, modes, sampleRate);
+            voices[c].process(blockIn[c], blockOut[c]);
+        }
+    }
+
+    void process(const ProcessArgs& args) override {
+        float mix = params[MIX_PARAM].getValue();
+        outputs[OUT_OUTPUT].setChannels(channels);
+
+        // The wet signal from the last block, then queue this frame for the next
+        for (int c = 0; c < channels; c++) {
+            float in = inputs[IN_INPUT].getPolyVoltage(c);
+            outputs[OUT_OUTPUT].setVoltage(in * (1.f - mix) + blockOut[c][blockPos] * 5.f * mix, c);
+            blockIn[c][blockPos] = in * 0.2f;
+        }
+
+        if (++blockPos >= RESONATOR_BLOCK) {
+            blockPos = 0;
+            processBlock(args.sampleRate);
+            // Channel count changes land on block boundaries
+            int newChannels = std::max(1, std::max(inputs[IN_INPUT].getChannels(), inputs[VOCT_INPUT].getChannels()));
+            for (int c = channels; c < newChannels; c++) {
+                voices[c].clear();
+                memset(blockOut[c], 0, sizeof(blockOut[c]));
+            }
+            channels = newChannels;
+        }
+    }
+};
+
+struct ResonatorModelDisplay : RJValueDisplay<const char *> {
+    ResonatorModelDisplay() {
+        fontSize = 16;
+        letterSpacing = 0.5;
+        text = RESONATOR_MODELS[0];
+    }
+
+    std::string format(const char * const &v) override {
+        return v;
+    }
+
+    void drawText(NVGcontext *vg) override {
+        nvgTextAlign(vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(vg, box.size.x / 2, box.size.y / 2, text.c_str(), NULL);
+    }
+};
+
+
+struct ResonatorWidget: ModuleWidget {
+    ResonatorWidget(Resonator *module);
+    void appendContextMenu(Menu *menu) override;
+};
+
+ResonatorWidget::ResonatorWidget(Resonator *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/Resonator.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    {
+        ResonatorModelDisplay *display = new ResonatorModelDisplay();
+        display->box.pos = Vec(10, 40);
+        display->box.size = Vec(130, 30);
+        display->value = module ? &module->modelName : NULL;
+        addChild(display);
+    }
+
+    addParam(createParam<ResonatorRoundLargeBlackKnob>(Vec(14, 80), module, Resonator::FREQ_PARAM));
+    addParam(createParam<ResonatorRoundLargeBlackKnob>(Vec(88, 80), module, Resonator::MODES_PARAM));
+    addParam(createParam<ResonatorRoundLargeBlackKnob>(Vec(14, 145), module, Resonator::DECAY_PARAM));
+    addParam(createParam<ResonatorRoundLargeBlackKnob>(Vec(88, 145), module, Resonator::DAMP_PARAM));
+    addParam(createParam<ResonatorRoundLargeBlackKnob>(Vec(14, 210), module, Resonator::BRIGHT_PARAM));
+    addParam(createParam<ResonatorRoundLargeBlackKnob>(Vec(88, 210), module, Resonator::MIX_PARAM));
+
+    addInput(createInput<PJ301MPort>(Vec(10, 280), module, Resonator::VOCT_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(45, 280), module, Resonator::DECAY_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(80, 280), module, Resonator::BRIGHT_INPUT));
+
+    addInput(createInput<PJ301MPort>(Vec(10, 320), module, Resonator::IN_INPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(112.5, 320), module, Resonator::OUT_OUTPUT));
+}
+
+void ResonatorWidget::appendContextMenu(Menu *menu) {
+    Resonator *module = dynamic_cast<Resonator *>(this->module);
+
+    menu->addChild(new MenuEntry);
+
+    RJChoiceItem *modelItem = createMenuItem<RJChoiceItem>("Model", ">");
+    modelItem->target = &module->model_index;
+    modelItem->labels = {"Harmonic", "Odd harmonic", "Stiff string", "Free bar", "Tuned bar", "Glass harmonica", "Prayer bowl"};
+    menu->addChild(modelItem);
+}
+
+Model *modelResonator = createModel<Resonator, ResonatorWidget>("Resonator");
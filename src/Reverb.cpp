@@ -0,0 +1,395 @@
+/*
+Reverb - stereo reverb with the four STK algorithms.
+
+FreeVerb is restructured for SIMD: each side's 8 lowpass feedback combs run
+as two float_4 vectors whose lanes read from interleaved float delay memory,
+and the left/right allpass chains share one vector. JCRev, NRev and PRCRev
+use the vendored STK classes.
+
+Audio is processed in blocks of REVERB_BLOCK frames, with parameters updated
+once per block. Only the wet signal sees the block latency, as a little
+extra predelay.
+*/
+
+#include "RJModules.hpp"
+#include "UI.hpp"
+#include "JCRev.h"
+#include "NRev.h"
+#include "PRCRev.h"
+#include <iostream>
+#include <cmath>
+
+using simd::float_4;
+
+static const int REVERB_BLOCK = 32;
+static const int REVERB_SPREAD = 23;
+// FreeVerb's tunings at 44.1kHz
+static const int REVERB_COMB_LENGTHS[8] = {1617, 1557, 1491, 1422, 1356, 1277, 1188, 1116};
+static const int REVERB_ALLPASS_LENGTHS[4] = {225, 556, 441, 341};
+static const char *REVERB_ALGORITHMS[] = {"FREEVERB", "JCREV", "NREV", "PRCREV"};
+
+struct ReverbRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    ReverbRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+// FreeVerb with comb c of the left side in lane c % 4 of bank c / 4, and
+// the right side in banks 2 and 3. Every bank keeps its four delay lines
+// interleaved, so one shared write position stores a whole vector at once
+// and reads gather one float per lane.
+struct ReverbFreeVerb {
+    std::vector<float> combs[4];
+    int combLengths[4][4];
+    unsigned int combMask = 0;
+    float_4 combStates[4];
+
+    // Lane 0 is left, lane 1 right
+    std::vector<float> allpasses[4];
+    int allpassLengths[4][2];
+    unsigned int allpassMask = 0;
+
+    unsigned int position = 0;
+    float feedback = 0.84f;
+    float damp = 0.1f;
+
+    static unsigned int maskFor(int longest) {
+        unsigned int size = 1;
+        while (size <= (unsigned int) longest)
+            size <<= 1;
+        return size - 1;
+    }
+
+    void setSampleRate(float sampleRate) {
+        float scale = sampleRate / 44100.f;
+        int longest = 0;
+        for (int c = 0; c < 8; c++) {
+            int length = (int) floorf(scale * REVERB_COMB_LENGTHS[c]);
+            combLengths[c / 4][c % 4] = length;
+            combLengths[2 + c / 4][c % 4] = length + REVERB_SPREAD;
+            longest = std::max(longest, length + REVERB_SPREAD);
+        }
+        combMask = maskFor(longest);
+
+        longest = 0;
+        for (int a = 0; a < 4; a++) {
+            int length = (int) floorf(scale * REVERB_ALLPASS_LENGTHS[a]);
+            allpassLengths[a][0] = length;
+            allpassLengths[a][1] = length + REVERB_SPREAD;
+            longest = std::max(longest, length + REVERB_SPREAD);
+        }
+        allpassMask = maskFor(longest);
+
+        for (int b = 0; b < 4; b++)
+            combs[b].assign((combMask + 1) * 4, 0.f);
+        for (int a = 0; a < 4; a++)
+            allpasses[a].assign((allpassMask + 1) * 4, 0.f);
+        clear();
+    }
+
+    void clear() {
+        for (int b = 0; b < 4; b++) {
+            std::fill(combs[b].begin(), combs[b].end(), 0.f);
+            combStates[b] = 0.f;
+        }
+        for (int a = 0; a < 4; a++)
+            std::fill(allpasses[a].begin(), allpasses[a].end(), 0.f);
+    }
+
+    // Same ranges as stk::FreeVerb::setRoomSize and setDamping
+    void setParameters(float roomSize, float damping) {
+        feedback = roomSize * 0.28f + 0.7f;
+        damp = damping * 0.4f;
+    }
+
+    // `in` is the summed left and right input
+    void process(const float *in, float *outL, float *outR, int frames) {
+        float_4 fb = feedback;
+        float_4 d = damp;
+        float_4 d1 = 1.f - damp;
+        float_4 states[4] = { combStates[0], combStates[1], combStates[2], combStates[3] };
+
+        for (int i = 0; i < frames; i++, position++) {
+            float_4 x = in[i] * 0.015f;
+            unsigned int write = (position & combMask) * 4;
+            float_4 sums[2] = { 0.f, 0.f };
+
+            for (int b = 0; b < 4; b++) {
+                float *memory = combs[b].data();
+                const int *lengths = combLengths[b];
+                float_4 delayed(
+                    memory[((position - lengths[0]) & combMask) * 4 + 0],
+                    memory[((position - lengths[1]) & combMask) * 4 + 1],
+                    memory[((position - lengths[2]) & combMask) * 4 + 2],
+                    memory[((position - lengths[3]) & combMask) * 4 + 3]);
+                states[b] = delayed * d1 + states[b] * d;
+                float_4 y = x + fb * states[b];
+                y.store(memory + write);
+                sums[b / 2] += y;
+            }
+
+            float_4 v(
+                sums[0][0] + sums[0][1] + sums[0][2] + sums[0][3],
+                sums[1][0] + sums[1][1] + sums[1][2] + sums[1][3],
+                0.f, 0.f);
+
+            write = (position & allpassMask) * 4;
+            for (int a = 0; a < 4; a++) {
+                float *memory = allpasses[a].data();
+                float_4 delayed(
+                    memory[((position - allpassLengths[a][0]) & allpassMask) * 4 + 0],
+                    memory[((position - allpassLengths[a][1]) & allpassMask) * 4 + 1],
+                    0.f, 0.f);
+                float_4 vn = v + 0.5f * delayed;
+                vn.store(memory + write);
+                v = 1.5f * delayed - vn;
+            }
+
+            outL[i] = v[0];
+            outR[i] = v[1];
+        }
+
+        for (int b = 0; b < 4; b++)
+            combStates[b] = states[b];
+    }
+};
+
+struct Reverb: Module {
+    enum ParamIds {
+        SIZE_PARAM,
+        DAMP_PARAM,
+        WIDTH_PARAM,
+        MIX_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        IN_L_INPUT,
+        IN_R_INPUT,
+        SIZE_CV_INPUT,
+        MIX_CV_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        OUT_L_OUTPUT,
+        OUT_R_OUTPUT,
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        NUM_LIGHTS
+    };
+
+    ReverbFreeVerb freeverb;
+    stk::JCRev jcrev;
+    stk::NRev nrev;
+    stk::PRCRev prcrev;
+
+    float blockIn[REVERB_BLOCK] = {};
+    float blockL[REVERB_BLOCK] = {};
+    float blockR[REVERB_BLOCK] = {};
+    int blockPos = 0;
+
+    int algorithm = 0;
+    float t60 = 0.f;
+    float dampL = 0.f;
+    float dampR = 0.f;
+    float wet1 = 1.f;
+    float wet2 = 0.f;
+
+    int algorithm_index = 0;
+    const char *algorithmName = REVERB_ALGORITHMS[0];
+
+    Reverb() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(Reverb::SIZE_PARAM, 0.0, 1.0, 0.5, "Size", "%", 0, 100);
+        configParam(Reverb::DAMP_PARAM, 0.0, 1.0, 0.25, "Damping", "%", 0, 100);
+        configParam(Reverb::WIDTH_PARAM, 0.0, 1.0, 1.0, "Width", "%", 0, 100);
+        configParam(Reverb::MIX_PARAM, 0.0, 1.0, 0.3, "Dry/Wet", "%", 0, 100);
+
+        // Wet only, the dry/wet mix happens in process()
+        jcrev.setEffectMix(1.0);
+        nrev.setEffectMix(1.0);
+        prcrev.setEffectMix(1.0);
+        onSampleRateChange();
+    }
+
+    // Sizes the comb and allpass lines, so it's kept off the audio thread
+    void onSampleRateChange() override {
+        freeverb.setSampleRate(APP->engine->getSampleRate());
+    }
+
+    json_t *dataToJson() override {
+        json_t *rootJ = json_object();
+        json_object_set_new(rootJ, "algorithm", json_integer(algorithm_index));
+        return rootJ;
+    }
+
+    void dataFromJson(json_t *rootJ) override {
+        json_t *algorithmJ = json_object_get(rootJ, "algorithm");
+        if (algorithmJ)
+            algorithm_index = clamp((int) json_integer_value(algorithmJ), 0, 3);
+    }
+
+    void updateBlock() {
+        if (algorithm_index != algorithm) {
+            // Don't let the old tail leak into the new algorithm
+            algorithm = algorithm_index;
+            algorithmName = REVERB_ALGORITHMS[algorithm];
+            freeverb.clear();
+            jcrev.clear();
+            nrev.clear();
+            prcrev.clear();
+            t60 = 0.f;
+        }
+
+        float size = clamp(params[SIZE_PARAM].getValue() + inputs[SIZE_CV_INPUT].getVoltage() / 10.f, 0.f, 1.f);
+        float damping = params[DAMP_PARAM].getValue();
+        float width = params[WIDTH_PARAM].getValue();
+        wet1 = width / 2.f + 0.5f;
+        wet2 = (1.f - width) / 2.f;
+
+        if (algorithm == 0) {
+            freeverb.setParameters(size, damping);
+            return;
+        }
+
+        // 0.3s to 12s, only recomputed when it moves
+        float t = 0.3f * powf(40.f, size);
+        if (fabsf(t - t60) > 0.001f * t) {
+            t60 = t;
+            if (algorithm == 1)
+                jcrev.setT60(t60);
+            else if (algorithm == 2)
+                nrev.setT60(t60);
+            else
+                prcrev.setT60(t60);
+        }
+    }
+
+    template <typename T>
+    void processStk(T &reverb) {
+        // The STK reverbs have no damping, so it is a lowpass on their output
+        float a = params[DAMP_PARAM].getValue() * 0.8f;
+        for (int i = 0; i < REVERB_BLOCK; i++) {
+            reverb.tick(blockIn[i] * 0.5f);
+            dampL = (1.f - a) * reverb.lastOut(0) + a * dampL;
+            dampR = (1.f - a) * reverb.lastOut(1) + a * dampR;
+            blockL[i] = dampL;
+            blockR[i] = dampR;
+        }
+    }
+
+    void processBlock() {
+        updateBlock();
+
+        if (algorithm == 0) {
+            freeverb.process(blockIn, blockL, blockR, REVERB_BLOCK);
+        }
+        else if (algorithm == 1)
+            processStk(jcrev);
+        else if (algorithm == 2)
+            processStk(nrev);
+        else
+            processStk(prcrev);
+
+        for (int i = 0; i < REVERB_BLOCK; i++) {
+            float l = blockL[i];
+            float r = blockR[i];
+            blockL[i] = l * wet1 + r * wet2;
+            blockR[i] = r * wet1 + l * wet2;
+        }
+    }
+
+    void process(const ProcessArgs& args) override {
+        float inL = inputs[IN_L_INPUT].getVoltageSum();
+        float inR = inputs[IN_R_INPUT].isConnected() ? inputs[IN_R_INPUT].getVoltageSum() : inL;
+
+        // The wet signal from the last block, then queue this frame for the next
+        float wetL = blockL[blockPos] * 5.f;
+        float wetR = blockR[blockPos] * 5.f;
+        blockIn[blockPos] = (inL + inR) * 0.2f;
+        if (++blockPos >= REVERB_BLOCK) {
+            blockPos = 0;
+            processBlock();
+        }
+
+        float mix = clamp(params[MIX_PARAM].getValue() + inputs[MIX_CV_INPUT].getVoltage() / 10.f, 0.f, 1.f);
+        outputs[OUT_L_OUTPUT].setVoltage(inL * (1.f - mix) + wetL * mix);
+        outputs[OUT_R_OUTPUT].setVoltage(inR * (1.f - mix) + wetR * mix);
+    }
+};
+
+struct ReverbAlgorithmDisplay : RJValueDisplay<const char *> {
+    ReverbAlgorithmDisplay() {
+        fontSize = 16;
+        letterSpacing = 0.5;
+        text = REVERB_ALGORITHMS[0];
+    }
+
+    std::string format(const char * const &v) override {
+        return v;
+    }
+
+    void drawText(NVGcontext *vg) override {
+        nvgTextAlign(vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(vg, box.size.x / 2, box.size.y / 2, text.c_str(), NULL);
+    }
+};
+
+
+struct ReverbWidget: ModuleWidget {
+    ReverbWidget(Reverb *module);
+    void appendContextMenu(Menu *menu) override;
+};
+
+ReverbWidget::ReverbWidget(Reverb *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/Reverb.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    {
+        ReverbAlgorithmDisplay *display = new ReverbAlgorithmDisplay();
+        display->box.pos = Vec(10, 45);
+        display->box.size = Vec(130, 30);
+        display->value = module ? &module->algorithmName : NULL;
+        addChild(display);
+    }
+
+    addParam(createParam<ReverbRoundLargeBlackKnob>(Vec(14, 90), module, Reverb::SIZE_PARAM));
+    addParam(createParam<ReverbRoundLargeBlackKnob>(Vec(88, 90), module, Reverb::DAMP_PARAM));
+    addParam(createParam<ReverbRoundLargeBlackKnob>(Vec(14, 165), module, Reverb::WIDTH_PARAM));
+    addParam(createParam<ReverbRoundLargeBlackKnob>(Vec(88, 165), module, Reverb::MIX_PARAM));
+
+    addInput(createInput<PJ301MPort>(Vec(22, 240), module, Reverb::SIZE_CV_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(97, 240), module, Reverb::MIX_CV_INPUT));
+
+    addInput(createInput<PJ301MPort>(Vec(10, 320), module, Reverb::IN_L_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(45, 320), module, Reverb::IN_R_INPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(80, 320), module, Reverb::OUT_L_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(112.5, 320), module, Reverb::OUT_R_OUTPUT));
+}
+
+void ReverbWidget::appendContextMenu(Menu *menu) {
+    Reverb *module = dynamic_cast<Reverb *>(this->module);
+
+    menu->addChild(new MenuEntry);
+
+    RJChoiceItem *algorithmItem = createMenuItem<RJChoiceItem>("Algorithm", ">");
+    algorithmItem->target = &module->algorithm_index;
+    algorithmItem->labels = {"FreeVerb", "JCRev", "NRev", "PRCRev"};
+    menu->addChild(algorithmItem);
+}
+
+Model *modelReverb = createModel<Reverb, ReverbWidget>("Reverb");
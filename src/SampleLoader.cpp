@@ -0,0 +1,194 @@
+#include "SampleLoader.hpp"
+
+#include <cstdio>
+#include <cstdint>
+#include <sys/stat.h>
+
+#define DR_WAV_IMPLEMENTATION
+#include "dr_wav.h"
+
+static const size_t SAMPLE_LOADER_CHUNK = 4096;
+
+// STK rawwaves are headerless 16 bit big endian mono at 22050 Hz
+static const unsigned int SAMPLE_LOADER_RAW_RATE = 22050;
+
+// Size and modification time, or a size of -1 if the file can't be read
+static void sampleLoaderStamp(const std::string &path, long long *size, long long *time) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        *size = -1;
+        *time = 0;
+        return;
+    }
+    *size = info.st_size;
+    *time = info.st_mtime;
+}
+
+SampleLoader *SampleLoader::instance() {
+    static SampleLoader loader;
+    return &loader;
+}
+
+SampleLoader::~SampleLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    condition.notify_one();
+    if (worker.joinable())
+        worker.join();
+}
+
+void SampleLoader::load(const std::string &path, std::shared_ptr<SampleSlot> slot) {
+    long long size, time;
+    sampleLoaderStamp(path, &size, &time);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<SampleBuffer> cached = find(path, size, time);
+        if (cached) {
+            publish(slot.get(), cached);
+            return;
+        }
+        requests.push_back({path, slot});
+        if (!running) {
+            running = true;
+            worker = std::thread(&SampleLoader::run, this);
+        }
+    }
+    condition.notify_one();
+}
+
+void SampleLoader::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [this] { return !running || !requests.empty(); });
+        if (!running)
+            return;
+
+        Request request = requests.front();
+        requests.pop_front();
+
+        // Someone may have asked for the same file while it was queued
+        long long size, time;
+        sampleLoaderStamp(request.path, &size, &time);
+        std::shared_ptr<SampleBuffer> buffer = find(request.path, size, time);
+        if (!buffer) {
+            lock.unlock();
+            SampleBuffer *decoded = decode(request.path);
+            lock.lock();
+            if (decoded) {
+                decoded->fileSize = size;
+                decoded->fileTime = time;
+                buffer.reset(decoded);
+                cache[request.path] = buffer;
+            }
+        }
+
+        if (buffer) {
+            publish(request.slot.get(), buffer);
+        }
+        else {
+            request.slot->failed = true;
+        }
+    }
+}
+
+std::shared_ptr<SampleBuffer> SampleLoader::find(const std::string &path, long long size, long long time) {
+    // Forget the files nobody holds any more while we're here
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (it->second.expired())
+            it = cache.erase(it);
+        else
+            ++it;
+    }
+
+    auto cached = cache.find(path);
+    if (cached == cache.end())
+        return NULL;
+    std::shared_ptr<SampleBuffer> buffer = cached->second.lock();
+    if (!buffer || buffer->fileSize != size || buffer->fileTime != time)
+        return NULL;
+    return buffer;
+}
+
+void SampleLoader::publish(SampleSlot *slot, std::shared_ptr<SampleBuffer> buffer) {
+    std::atomic_store(&slot->owner, std::shared_ptr<const SampleBuffer>(buffer));
+    slot->failed = false;
+    slot->buffer.store(buffer.get(), std::memory_order_release);
+}
+
+static SampleBuffer *decodeRaw(const std::string &path) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    long bytes = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    SampleBuffer *buffer = new SampleBuffer();
+    buffer->path = path;
+    buffer->channels = 1;
+    buffer->sampleRate = SAMPLE_LOADER_RAW_RATE;
+    buffer->frames = bytes > 0 ? bytes / 2 : 0;
+    buffer->data[0].resize(buffer->frames);
+
+    uint8_t chunk[SAMPLE_LOADER_CHUNK * 2];
+    size_t frame = 0;
+    while (frame < buffer->frames) {
+        size_t frames = std::min(SAMPLE_LOADER_CHUNK, buffer->frames - frame);
+        size_t read = fread(chunk, 2, frames, file);
+        for (size_t i = 0; i < read; i++) {
+            int16_t value = (int16_t) ((chunk[2 * i] << 8) | chunk[2 * i + 1]);
+            buffer->data[0][frame + i] = value / 32768.f;
+        }
+        frame += read;
+        if (read < frames)
+            break;
+    }
+    buffer->frames = frame;
+
+    fclose(file);
+    if (buffer->frames == 0) {
+        delete buffer;
+        return NULL;
+    }
+    return buffer;
+}
+
+SampleBuffer *SampleLoader::decode(const std::string &path) {
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".raw") == 0)
+        return decodeRaw(path);
+
+    drwav wav;
+    if (!drwav_init_file(&wav, path.c_str()))
+        return NULL;
+
+    SampleBuffer *buffer = new SampleBuffer();
+    buffer->path = path;
+    buffer->channels = wav.channels;
+    buffer->sampleRate = wav.sampleRate;
+    buffer->frames = wav.totalSampleCount / wav.channels;
+
+    // Allocate once, then read interleaved chunks and split them into place
+    int kept = std::min<int>(wav.channels, 2);
+    for (int c = 0; c < kept; c++)
+        buffer->data[c].resize(buffer->frames);
+
+    std::vector<float> chunk(SAMPLE_LOADER_CHUNK * wav.channels);
+    size_t frame = 0;
+    while (frame < buffer->frames) {
+        size_t frames = std::min(SAMPLE_LOADER_CHUNK, buffer->frames - frame);
+        size_t read = drwav_read_f32(&wav, frames * wav.channels, chunk.data()) / wav.channels;
+        for (size_t i = 0; i < read; i++) {
+            for (int c = 0; c < kept; c++)
+                buffer->data[c][frame + i] = chunk[i * wav.channels + c];
+        }
+        frame += read;
+        if (read < frames)
+            break;
+    }
+    buffer->frames = frame;
+
+    drwav_uninit(&wav);
+    return buffer;
+}
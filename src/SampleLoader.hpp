@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+    A decoded WAV file. Samples are deinterleaved, one vector per channel
+    (only the first two channels are kept). Once published a buffer is
+    never modified, and it isn't freed while any slot still holds it, so
+    the audio thread can read it without locking.
+*/
+struct SampleBuffer {
+    std::string path;
+    unsigned int channels = 0;
+    unsigned int sampleRate = 0;
+    size_t frames = 0;
+    std::vector<float> data[2];
+    // The file's size and modification time when it was decoded
+    long long fileSize = -1;
+    long long fileTime = 0;
+};
+
+/*
+    Where a module receives a sample it asked for. The module and the
+    loader both hold a reference, so a module can be deleted while its
+    request is still queued. A slot is only loaded once; ask for another
+    file with a new slot and drop the old one, which releases its buffer.
+*/
+struct SampleSlot {
+    std::atomic<const SampleBuffer *> buffer{nullptr};
+    std::atomic<bool> failed{false};
+    // Keeps the published buffer alive for as long as the slot is. The
+    // worker sets it while other threads may hold the slot, so it's only
+    // touched through std::atomic_store/std::atomic_load; the audio thread
+    // reads `buffer` instead.
+    std::shared_ptr<const SampleBuffer> owner;
+};
+
+/*
+    Decodes WAV files (and STK .raw files) on a worker thread and caches
+    them by path, so every module asking for the same file shares one copy.
+    The cache only holds weak references: a buffer is freed with the last
+    slot holding it. A cached file whose size or modification time has
+    changed on disk is decoded again.
+*/
+struct SampleLoader {
+    static SampleLoader *instance();
+
+    ~SampleLoader();
+
+    // Publishes straight away if the file is cached, otherwise queues it
+    void load(const std::string &path, std::shared_ptr<SampleSlot> slot);
+
+private:
+    struct Request {
+        std::string path;
+        std::shared_ptr<SampleSlot> slot;
+    };
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Request> requests;
+    std::map<std::string, std::weak_ptr<SampleBuffer>> cache;
+    std::thread worker;
+    bool running = false;
+
+    void run();
+    std::shared_ptr<SampleBuffer> find(const std::string &path, long long size, long long time);
+    static void publish(SampleSlot *slot, std::shared_ptr<SampleBuffer> buffer);
+    static SampleBuffer *decode(const std::string &path);
+};
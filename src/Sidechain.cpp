@@ -21,6 +21,7 @@ struct Sidechain: Module {
     };
 
     float decayAmount = 0.0;
+    dsp::SchmittTrigger trigger;
     Sidechain() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS);
         configParam(Sidechain::RATIO_PARAM, 0.0, 1.0, 1.0, "");
@@ -50,11 +51,12 @@ void Sidechain::step() {
     float decay = 1 - (params[DECAY_PARAM].value * clamp(inputs[DECAY_CV_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f)) + .00001;
     float decayLambda = .0001;
 
-    if(inputs[TRIGGER_INPUT].value > 0 || inputs[TRIGGER_INPUT].value > 0){
+    // Re-arm on the rising edge only, so a held gate doesn't pin the duck open
+    if(trigger.process(inputs[TRIGGER_INPUT].value)){
         decayAmount = clamp(inputs[RATIO_CV_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
     }
 
-    outputs[CH1_OUTPUT].value = inputs[CH1_OUTPUT].value * (1 - (ratio * decayAmount));
+    outputs[CH1_OUTPUT].value = inputs[CH1_INPUT].value * (1 - (ratio * decayAmount));
     decayAmount = (decayAmount - (decayLambda * (decay)));
     if(decayAmount < 0){
         decayAmount = 0;
@@ -0,0 +1,309 @@
+/*
+StkFx - stk::Echo, stk::PitShift and stk::Chorus as one polyphonic effect.
+
+All three only ever delay their input, so here they share one input
+history, 16 channels side by side at each time step in float, sized once
+per sample rate for the longest of them (Echo's one second). Switching
+effects is seamless and nothing is allocated while running.
+
+Rack's per-sample process() only fills and empties a STKFX_BLOCK frame
+FIFO; the effect ticks a whole block at a time, with its controls read once
+per block, so the output is STKFX_BLOCK samples late. The delay times are
+shared by every channel, so each tap is one float_4 load per four channels.
+*/
+
+#include "RJModules.hpp"
+#include "UI.hpp"
+#include <iostream>
+#include <cmath>
+
+using simd::float_4;
+
+static const int STKFX_CHANNELS = 16;
+static const int STKFX_GROUPS = STKFX_CHANNELS / 4;
+static const int STKFX_BLOCK = 32;
+// Echo's default maximum delay
+static const float STKFX_MAX_ECHO = 1.f;
+// PitShift's maxDelay, in samples at 44.1kHz
+static const float STKFX_PITSHIFT_DELAY = 5024.f;
+static const float STKFX_PITSHIFT_MARGIN = 12.f;
+// Chorus's default baseDelay, in samples at 44.1kHz, which TIME's default gives
+static const float STKFX_CHORUS_DELAY = 6000.f;
+static const float STKFX_CHORUS_TIME = 0.9f;
+static const char *STKFX_NAMES[] = {"ECHO", "PITSHIFT", "CHORUS"};
+
+struct StkFxRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    StkFxRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+struct StkFx: Module {
+    enum ParamIds {
+        EFFECT_PARAM,
+        TIME_PARAM,
+        SHIFT_PARAM,
+        RATE_PARAM,
+        DEPTH_PARAM,
+        MIX_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        IN_INPUT,
+        TIME_INPUT,
+        SHIFT_INPUT,
+        MIX_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        LEFT_OUTPUT,
+        RIGHT_OUTPUT,
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        NUM_LIGHTS
+    };
+
+    enum Effects {
+        ECHO,
+        PITSHIFT,
+        CHORUS
+    };
+
+    // history[n * STKFX_CHANNELS + c] is channel c's input at time n
+    std::vector<float> history;
+    int mask = 0;
+    int write = 0;
+    float sampleRate = 0.f;
+
+    // The FIFO between process() and tick()
+    alignas(16) float in[STKFX_BLOCK * STKFX_CHANNELS] = {};
+    alignas(16) float left[STKFX_BLOCK * STKFX_CHANNELS] = {};
+    alignas(16) float right[STKFX_BLOCK * STKFX_CHANNELS] = {};
+    int position = 0;
+    int channels = 1;
+
+    // PitShift's sweeping delay, and Chorus's two modulators
+    float pitchDelay = 0.f;
+    float modPhase[2] = {};
+    float lastMod[2] = {};
+
+    const char *effectName = STKFX_NAMES[0];
+
+    StkFx() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(StkFx::EFFECT_PARAM, 0.0, 2.0, 0.0, "Effect")->snapEnabled = true;
+        configParam(StkFx::TIME_PARAM, 0.0, 1.0, STKFX_CHORUS_TIME, "Time", " ms", 1000, 1);
+        configParam(StkFx::SHIFT_PARAM, -12.0, 12.0, 0.0, "Pitch shift", " semitones");
+        configParam(StkFx::RATE_PARAM, -2.0, 1.0, -0.7, "Chorus rate", " Hz", 10, 1);
+        configParam(StkFx::DEPTH_PARAM, 0.0, 1.0, 0.05, "Chorus depth", "%", 0, 100);
+        configParam(StkFx::MIX_PARAM, 0.0, 1.0, 0.5, "Mix", "%", 0, 100);
+        onSampleRateChange();
+    }
+
+    void onSampleRateChange() override {
+        sampleRate = APP->engine->getSampleRate();
+        int length = 1;
+        while (length < STKFX_MAX_ECHO * sampleRate + STKFX_BLOCK + 2)
+            length *= 2;
+        history.assign(length * STKFX_CHANNELS, 0.f);
+        mask = length - 1;
+        write = 0;
+        pitchDelay = pitchWindow() / 2;
+    }
+
+    void onReset() override {
+        std::fill(history.begin(), history.end(), 0.f);
+        modPhase[0] = modPhase[1] = 0.f;
+    }
+
+    // PitShift's delay range, kept the same length in time at any rate
+    float pitchWindow() {
+        return STKFX_PITSHIFT_DELAY * sampleRate / 44100.f;
+    }
+
+    // One group's input d samples back, with DelayL's linear interpolation
+    float_4 tap(int n, int g, float d) {
+        int i = (int) d;
+        float frac = d - i;
+        float_4 a = float_4::load(&history[((n - i) & mask) * STKFX_CHANNELS + 4 * g]);
+        float_4 b = float_4::load(&history[((n - i - 1) & mask) * STKFX_CHANNELS + 4 * g]);
+        return a + (b - a) * frac;
+    }
+
+    // Runs the effect over the block in the FIFO
+    void tick(int effect) {
+        int groups = (channels + 3) / 4;
+        float timeKnob = clamp(params[TIME_PARAM].getValue() + inputs[TIME_INPUT].getVoltage() / 10.f, 0.f, 1.f);
+        float time = 0.001f * std::pow(1000.f, timeKnob);
+        float mix = clamp(params[MIX_PARAM].getValue() + inputs[MIX_INPUT].getVoltage() / 10.f, 0.f, 1.f);
+
+        // Echo::setDelay(), whole samples
+        int echoDelay = clamp((int) std::round(time * sampleRate), 1, (int) (STKFX_MAX_ECHO * sampleRate));
+
+        // PitShift::setShift()
+        float window = pitchWindow();
+        float delayLength = window - 2 * STKFX_PITSHIFT_MARGIN;
+        float halfLength = delayLength / 2;
+        float shift = dsp::approxExp2_taylor5((params[SHIFT_PARAM].getValue() + inputs[SHIFT_INPUT].getVoltage() * 12.f) / 12.f);
+        float rate = 1.f - shift;
+        if (std::fabs(rate) < 1e-6f) {
+            rate = 0.f;
+            pitchDelay = halfLength + STKFX_PITSHIFT_MARGIN;
+        }
+
+        // Chorus has its own range around STK's base delay, about a sixth of it
+        // at the bottom of TIME. Capped so the deepest sweep still fits.
+        float base = STKFX_CHORUS_DELAY * sampleRate / 44100.f * std::pow(8.f, timeKnob - STKFX_CHORUS_TIME);
+        base = std::min(base, 0.7f * STKFX_MAX_ECHO * sampleRate);
+        float depth = params[DEPTH_PARAM].getValue();
+        float modRate = std::pow(10.f, params[RATE_PARAM].getValue()) / sampleRate;
+        float mod[2], dMod[2];
+        for (int m = 0; m < 2; m++) {
+            // Chorus::setModFrequency() runs the second one 1.1111 times faster
+            modPhase[m] += modRate * (m ? 1.1111f : 1.f) * STKFX_BLOCK;
+            modPhase[m] -= std::floor(modPhase[m]);
+            float next = std::sin(2.f * M_PI * modPhase[m]);
+            mod[m] = lastMod[m];
+            dMod[m] = (next - lastMod[m]) / STKFX_BLOCK;
+            lastMod[m] = next;
+        }
+
+        for (int i = 0; i < STKFX_BLOCK; i++) {
+            int n = write;
+            for (int g = 0; g < STKFX_GROUPS; g++)
+                float_4::load(&in[i * STKFX_CHANNELS + 4 * g]).store(&history[n * STKFX_CHANNELS + 4 * g]);
+            write = (write + 1) & mask;
+
+            if (effect == ECHO) {
+                for (int g = 0; g < groups; g++) {
+                    float_4 x = float_4::load(&in[i * STKFX_CHANNELS + 4 * g]);
+                    float_4 d = float_4::load(&history[((n - echoDelay) & mask) * STKFX_CHANNELS + 4 * g]);
+                    float_4 y = mix * (d - x) + x;
+                    y.store(&left[i * STKFX_CHANNELS + 4 * g]);
+                    y.store(&right[i * STKFX_CHANNELS + 4 * g]);
+                }
+            }
+            else if (effect == PITSHIFT) {
+                // PitShift::tick(): two taps half a window apart, crossfaded
+                pitchDelay += rate;
+                while (pitchDelay > window - STKFX_PITSHIFT_MARGIN)
+                    pitchDelay -= delayLength;
+                while (pitchDelay < STKFX_PITSHIFT_MARGIN)
+                    pitchDelay += delayLength;
+                float other = pitchDelay + halfLength;
+                while (other > window - STKFX_PITSHIFT_MARGIN)
+                    other -= delayLength;
+                float env1 = std::fabs((pitchDelay - halfLength + STKFX_PITSHIFT_MARGIN) / (halfLength + STKFX_PITSHIFT_MARGIN));
+                float env0 = 1.f - env1;
+                for (int g = 0; g < groups; g++) {
+                    float_4 x = float_4::load(&in[i * STKFX_CHANNELS + 4 * g]);
+                    float_4 y = env0 * tap(n, g, pitchDelay) + env1 * tap(n, g, other);
+                    y = mix * y + (1.f - mix) * x;
+                    y.store(&left[i * STKFX_CHANNELS + 4 * g]);
+                    y.store(&right[i * STKFX_CHANNELS + 4 * g]);
+                }
+            }
+            else {
+                // Chorus::tick(), one swept line per side
+                float d0 = std::max(base * 0.707f * (1.f + depth * mod[0]), 1.f);
+                float d1 = std::max(base * 0.5f * (1.f - depth * mod[1]), 1.f);
+                mod[0] += dMod[0];
+                mod[1] += dMod[1];
+                for (int g = 0; g < groups; g++) {
+                    float_4 x = float_4::load(&in[i * STKFX_CHANNELS + 4 * g]);
+                    (mix * (tap(n, g, d0) - x) + x).store(&left[i * STKFX_CHANNELS + 4 * g]);
+                    (mix * (tap(n, g, d1) - x) + x).store(&right[i * STKFX_CHANNELS + 4 * g]);
+                }
+            }
+        }
+    }
+
+    void process(const ProcessArgs& args) override {
+        for (int c = 0; c < channels; c++) {
+            outputs[LEFT_OUTPUT].setVoltage(left[position * STKFX_CHANNELS + c], c);
+            outputs[RIGHT_OUTPUT].setVoltage(right[position * STKFX_CHANNELS + c], c);
+        }
+        outputs[LEFT_OUTPUT].setChannels(channels);
+        outputs[RIGHT_OUTPUT].setChannels(channels);
+
+        int inputChannels = inputs[IN_INPUT].getChannels();
+        for (int c = 0; c < STKFX_CHANNELS; c++)
+            in[position * STKFX_CHANNELS + c] = c < inputChannels ? inputs[IN_INPUT].getVoltage(c) : 0.f;
+
+        if (++position >= STKFX_BLOCK) {
+            position = 0;
+            int effect = (int) roundf(params[EFFECT_PARAM].getValue());
+            effectName = STKFX_NAMES[effect];
+            channels = std::max(1, inputChannels);
+            tick(effect);
+        }
+    }
+};
+
+
+struct StkFxEffectDisplay : RJValueDisplay<const char *> {
+    StkFxEffectDisplay() {
+        fontSize = 16;
+        letterSpacing = 0.5;
+        text = "ECHO";
+    }
+
+    std::string format(const char * const &v) override {
+        return v;
+    }
+
+    void drawText(NVGcontext *vg) override {
+        nvgTextAlign(vg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+        nvgText(vg, box.size.x / 2, box.size.y / 2, text.c_str(), NULL);
+    }
+};
+
+
+struct StkFxWidget: ModuleWidget {
+    StkFxWidget(StkFx *module);
+};
+
+StkFxWidget::StkFxWidget(StkFx *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/StkFx.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    {
+        StkFxEffectDisplay *display = new StkFxEffectDisplay();
+        display->box.pos = Vec(10, 40);
+        display->box.size = Vec(130, 30);
+        display->value = module ? &module->effectName : NULL;
+        addChild(display);
+    }
+
+    addParam(createParam<StkFxRoundLargeBlackKnob>(Vec(14, 80), module, StkFx::EFFECT_PARAM));
+    addParam(createParam<StkFxRoundLargeBlackKnob>(Vec(88, 80), module, StkFx::TIME_PARAM));
+    addParam(createParam<StkFxRoundLargeBlackKnob>(Vec(14, 145), module, StkFx::SHIFT_PARAM));
+    addParam(createParam<StkFxRoundLargeBlackKnob>(Vec(88, 145), module, StkFx::MIX_PARAM));
+    addParam(createParam<StkFxRoundLargeBlackKnob>(Vec(14, 210), module, StkFx::RATE_PARAM));
+    addParam(createParam<StkFxRoundLargeBlackKnob>(Vec(88, 210), module, StkFx::DEPTH_PARAM));
+
+    addInput(createInput<PJ301MPort>(Vec(10, 280), module, StkFx::IN_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(45, 280), module, StkFx::TIME_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(80, 280), module, StkFx::SHIFT_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(112.5, 280), module, StkFx::MIX_INPUT));
+
+    addOutput(createOutput<PJ301MPort>(Vec(45, 320), module, StkFx::LEFT_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(80, 320), module, StkFx::RIGHT_OUTPUT));
+}
+
+Model *modelStkFx = createModel<StkFx, StkFxWidget>("StkFx");
@@ -0,0 +1,344 @@
+/*
+Strings - up to 16 plucked strings after stk::Plucked and stk::StifKarp.
+
+Each string is the StifKarp loop: a delay line tuned by a first order
+allpass (DelayA), the loop gain and the one zero averaging filter, an
+optional chain of four allpass biquads for stiffness, and the pickup
+position comb on the way out. The excitation is Plucked's, noise through
+a one pole pick filter whose brightness follows the velocity.
+
+The strings run four to a float_4. Their delay lines share one buffer with
+the 16 strings side by side at each time step, so a group's write is a
+single vector store and only the reads, which sit at a different delay
+in each lane, are done lane by lane. Tuning is only worked out when a
+string's pitch or the controls move. Unlike StifKarp, the phase delay of
+the stiffness allpasses is taken off the loop, so stiff strings stay in
+tune.
+*/
+
+#include "RJModules.hpp"
+#include "UI.hpp"
+#include <iostream>
+#include <cmath>
+
+using simd::float_4;
+
+static const int STRINGS_VOICES = 16;
+static const int STRINGS_GROUPS = STRINGS_VOICES / 4;
+static const int STRINGS_BLOCK = 16;
+static const float STRINGS_LOWEST = 20.f;
+static const float STRINGS_SILENCE = 1e-6f;
+
+struct StringsRoundLargeBlackKnob : RoundLargeBlackKnob
+{
+    StringsRoundLargeBlackKnob()
+    {
+        setSVG(APP->window->loadSvg(asset::plugin(pluginInstance, "res/KTFRoundLargeBlackKnob.svg")));
+    }
+};
+
+struct Strings: Module {
+    enum ParamIds {
+        FREQ_PARAM,
+        DECAY_PARAM,
+        STIFFNESS_PARAM,
+        POSITION_PARAM,
+        NUM_PARAMS
+    };
+    enum InputIds {
+        VOCT_INPUT,
+        TRIG_INPUT,
+        VELOCITY_INPUT,
+        DECAY_INPUT,
+        NUM_INPUTS
+    };
+    enum OutputIds {
+        OUT_OUTPUT,
+        MIX_OUTPUT,
+        NUM_OUTPUTS
+    };
+    enum LightIds {
+        NUM_LIGHTS
+    };
+
+    // buffer[n * STRINGS_VOICES + c] is string c's delay line at time n
+    std::vector<float> buffer;
+    int mask = 0;
+    int position = 0;
+
+    // Per string tuning, lane c % 4 of group c / 4
+    int delays[STRINGS_VOICES] = {};
+    float combDelays[STRINGS_VOICES] = {};
+    float_4 allpass[STRINGS_GROUPS];
+    float_4 loopGain[STRINGS_GROUPS];
+
+    // Allpass and loop filter states
+    float_4 apInput[STRINGS_GROUPS];
+    float_4 apOutput[STRINGS_GROUPS];
+    float_4 lastLoop[STRINGS_GROUPS];
+
+    // StifKarp's four stretch biquads, b0 = a2, b1 = a1 and b2 = 1
+    float_4 stretchA1[STRINGS_GROUPS][4];
+    float_4 stretchA2[STRINGS_GROUPS][4];
+    float_4 stretchX1[STRINGS_GROUPS][4];
+    float_4 stretchX2[STRINGS_GROUPS][4];
+    float_4 stretchY1[STRINGS_GROUPS][4];
+    float_4 stretchY2[STRINGS_GROUPS][4];
+
+    // What each string was tuned for
+    float frequencies[STRINGS_VOICES] = {};
+    float decays[STRINGS_VOICES] = {};
+    float stiffness = -1.f;
+    float pickup = -1.f;
+    float sampleRate = 0.f;
+
+    dsp::SchmittTrigger triggers[STRINGS_VOICES];
+    bool awake[STRINGS_GROUPS] = {};
+    float_4 peak[STRINGS_GROUPS];
+    alignas(16) float out[STRINGS_VOICES] = {};
+    int counter = 0;
+    int channels = 1;
+
+    Strings() {
+        config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
+        configParam(Strings::FREQ_PARAM, -4.0, 4.0, -1.0, "Frequency", " Hz", 2, dsp::FREQ_C4);
+        configParam(Strings::DECAY_PARAM, 0.0, 1.0, 0.83, "Decay", "%", 0, 100);
+        configParam(Strings::STIFFNESS_PARAM, 0.0, 1.0, 0.0, "Stiffness", "%", 0, 100);
+        configParam(Strings::POSITION_PARAM, 0.02, 1.0, 0.4, "Pickup position", "%", 0, 100);
+        for (int g = 0; g < STRINGS_GROUPS; g++) {
+            allpass[g] = 0.f;
+            loopGain[g] = 0.f;
+            for (int i = 0; i < 4; i++) {
+                stretchA1[g][i] = 0.f;
+                stretchA2[g][i] = 0.f;
+            }
+        }
+        onSampleRateChange();
+    }
+
+    void onSampleRateChange() override {
+        sampleRate = APP->engine->getSampleRate();
+        // The longest string, plus half of it again for the pickup comb
+        int length = 1;
+        while (length < 1.5f * sampleRate / STRINGS_LOWEST + 8)
+            length *= 2;
+        buffer.assign(length * STRINGS_VOICES, 0.f);
+        mask = length - 1;
+        position = 0;
+        for (int c = 0; c < STRINGS_VOICES; c++)
+            frequencies[c] = 0.f;
+        clear();
+    }
+
+    void onReset() override {
+        std::fill(buffer.begin(), buffer.end(), 0.f);
+        clear();
+    }
+
+    void clear() {
+        for (int g = 0; g < STRINGS_GROUPS; g++) {
+            apInput[g] = 0.f;
+            apOutput[g] = 0.f;
+            lastLoop[g] = 0.f;
+            peak[g] = 0.f;
+            for (int i = 0; i < 4; i++) {
+                stretchX1[g][i] = 0.f;
+                stretchX2[g][i] = 0.f;
+                stretchY1[g][i] = 0.f;
+                stretchY2[g][i] = 0.f;
+            }
+            awake[g] = false;
+        }
+    }
+
+    // StifKarp::setFrequency(), setStretch() and setPickupPosition() for one string
+    void tune(int c, float frequency, float decay) {
+        frequencies[c] = frequency;
+        decays[c] = decay;
+        int g = c / 4;
+        int l = c % 4;
+        double length = sampleRate / frequency;
+        double w = 2 * M_PI * frequency / sampleRate;
+
+        // The stretch biquads sit from 2f up to Nyquist, and delay the loop by
+        // 2 + 2 arg(D(w)) / w samples each, where D is the denominator
+        double filterDelay = 0.5;
+        double stretch = 0.9 + 0.1 * (1.0 - stiffness);
+        double r = std::min(0.5 + stretch * 0.5, 0.99999);
+        double f = 2.0 * frequency;
+        double df = (0.5 * sampleRate - f) * 0.25;
+        for (int i = 0; i < 4; i++) {
+            double a1 = -2.0 * r * std::cos(2 * M_PI * f / sampleRate);
+            double a2 = r * r;
+            stretchA1[g][i][l] = stiffness > 0.f ? a1 : 0.f;
+            stretchA2[g][i][l] = stiffness > 0.f ? a2 : 0.f;
+            if (stiffness > 0.f) {
+                double re = 1.0 + a1 * std::cos(w) + a2 * std::cos(2 * w);
+                double im = -a1 * std::sin(w) - a2 * std::sin(2 * w);
+                filterDelay += 2.0 + 2.0 * std::atan2(im, re) / w;
+            }
+            f += df;
+        }
+
+        // DelayA, keeping the allpass's alpha in [0.5, 1.5)
+        double delay = std::max(length - filterDelay, 2.5);
+        int integer = (int) delay;
+        double alpha = delay - integer;
+        if (alpha < 0.5) {
+            integer -= 1;
+            alpha += 1.0;
+        }
+        delays[c] = integer;
+        allpass[g][l] = (1.0 - alpha) / (1.0 + alpha);
+
+        // Plucked's loop gain, on StifKarp's controlChange(11) base
+        loopGain[g][l] = std::min(0.97f + 0.03f * decay + frequency * 0.000005f, 0.99999f);
+        combDelays[c] = 0.5f * pickup * length;
+    }
+
+    // Plucked::pluck(), noise through the pick filter added over the next
+    // loop's worth of the line
+    void pluck(int c, float amplitude) {
+        float pole = 0.999f - amplitude * 0.15f;
+        float gain = amplitude * 0.5f;
+        float state = 0.f;
+        for (int k = delays[c]; k >= 1; k--) {
+            float &sample = buffer[((position - k) & mask) * STRINGS_VOICES + c];
+            state = gain * (1.f - pole) * (2.f * random::uniform() - 1.f) + pole * state;
+            sample = 0.6f * sample + state;
+        }
+        awake[c / 4] = true;
+    }
+
+    void process(const ProcessArgs& args) override {
+        if (counter == 0) {
+            channels = std::max(1, std::max(inputs[VOCT_INPUT].getChannels(), inputs[TRIG_INPUT].getChannels()));
+            float newStiffness = params[STIFFNESS_PARAM].getValue();
+            float newPickup = params[POSITION_PARAM].getValue();
+            bool retune = newStiffness != stiffness || newPickup != pickup;
+            stiffness = newStiffness;
+            pickup = newPickup;
+            float pitch = params[FREQ_PARAM].getValue();
+            for (int c = 0; c < channels; c++) {
+                float frequency = clamp(dsp::FREQ_C4 * dsp::approxExp2_taylor5(pitch + inputs[VOCT_INPUT].getPolyVoltage(c)), STRINGS_LOWEST, sampleRate * 0.3f);
+                float decay = clamp(params[DECAY_PARAM].getValue() + inputs[DECAY_INPUT].getPolyVoltage(c) / 10.f, 0.f, 1.f);
+                if (retune || frequency != frequencies[c] || decay != decays[c])
+                    tune(c, frequency, decay);
+            }
+        }
+        if (++counter >= STRINGS_BLOCK)
+            counter = 0;
+
+        bool velocityConnected = inputs[VELOCITY_INPUT].isConnected();
+        for (int c = 0; c < channels; c++) {
+            if (triggers[c].process(inputs[TRIG_INPUT].getPolyVoltage(c))) {
+                float velocity = velocityConnected ? clamp(inputs[VELOCITY_INPUT].getPolyVoltage(c) / 10.f, 0.f, 1.f) : 1.f;
+                pluck(c, velocity);
+            }
+        }
+
+        bool stiff = stiffness > 0.f;
+        float *now = &buffer[position * STRINGS_VOICES];
+        for (int g = 0; g < STRINGS_GROUPS; g++) {
+            if (!awake[g] || 4 * g >= channels) {
+                float_4(0.f).store(now + 4 * g);
+                float_4(0.f).store(out + 4 * g);
+                continue;
+            }
+
+            // The lanes read at their own delays
+            float_4 x, comb;
+            for (int l = 0; l < 4; l++) {
+                int c = 4 * g + l;
+                x[l] = buffer[((position - delays[c]) & mask) * STRINGS_VOICES + c];
+                float tap = delays[c] + combDelays[c];
+                int i = (int) tap;
+                float frac = tap - i;
+                float a = buffer[((position - i) & mask) * STRINGS_VOICES + c];
+                float b = buffer[((position - i - 1) & mask) * STRINGS_VOICES + c];
+                comb[l] = a + (b - a) * frac;
+            }
+
+            // DelayA's allpass, then the string's output less the pickup comb
+            float_4 y = allpass[g] * (x - apOutput[g]) + apInput[g];
+            apInput[g] = x;
+            apOutput[g] = y;
+            float_4 string = y - comb;
+            string.store(out + 4 * g);
+            peak[g] = simd::fmax(peak[g], simd::fabs(y));
+
+            float_4 loop = y * loopGain[g];
+            if (stiff) {
+                for (int i = 0; i < 4; i++) {
+                    float_4 s = stretchA2[g][i] * (loop - stretchY2[g][i]) + stretchA1[g][i] * (stretchX1[g][i] - stretchY1[g][i]) + stretchX2[g][i];
+                    stretchX2[g][i] = stretchX1[g][i];
+                    stretchX1[g][i] = loop;
+                    stretchY2[g][i] = stretchY1[g][i];
+                    stretchY1[g][i] = s;
+                    loop = s;
+                }
+            }
+            // The one zero averaging filter
+            float_4 filtered = 0.5f * (loop + lastLoop[g]);
+            lastLoop[g] = loop;
+            filtered.store(now + 4 * g);
+        }
+        position = (position + 1) & mask;
+
+        // Groups that have rung out stop until they are plucked again
+        if (counter == 0) {
+            for (int g = 0; g < STRINGS_GROUPS; g++) {
+                if (awake[g] && simd::movemask(peak[g] > STRINGS_SILENCE) == 0)
+                    awake[g] = false;
+                peak[g] = 0.f;
+            }
+        }
+
+        outputs[OUT_OUTPUT].setChannels(channels);
+        float mix = 0.f;
+        for (int c = 0; c < channels; c++) {
+            // Plucked's output gain of 3, at 5V
+            float v = out[c] * 15.f;
+            outputs[OUT_OUTPUT].setVoltage(v, c);
+            mix += v;
+        }
+        outputs[MIX_OUTPUT].setVoltage(mix);
+    }
+};
+
+
+struct StringsWidget: ModuleWidget {
+    StringsWidget(Strings *module);
+};
+
+StringsWidget::StringsWidget(Strings *module) {
+        setModule(module);
+    box.size = Vec(15*10, 380);
+
+    {
+        SVGPanel *panel = new SVGPanel();
+        panel->box.size = box.size;
+        panel->setBackground(APP->window->loadSvg(asset::plugin(pluginInstance, "res/Strings.svg")));
+        addChild(panel);
+    }
+
+    addChild(createWidget<ScrewSilver>(Vec(15, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 0)));
+    addChild(createWidget<ScrewSilver>(Vec(15, 365)));
+    addChild(createWidget<ScrewSilver>(Vec(box.size.x-30, 365)));
+
+    addParam(createParam<StringsRoundLargeBlackKnob>(Vec(14, 60), module, Strings::FREQ_PARAM));
+    addParam(createParam<StringsRoundLargeBlackKnob>(Vec(88, 60), module, Strings::DECAY_PARAM));
+    addParam(createParam<StringsRoundLargeBlackKnob>(Vec(14, 140), module, Strings::STIFFNESS_PARAM));
+    addParam(createParam<StringsRoundLargeBlackKnob>(Vec(88, 140), module, Strings::POSITION_PARAM));
+
+    addInput(createInput<PJ301MPort>(Vec(10, 280), module, Strings::VOCT_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(45, 280), module, Strings::TRIG_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(80, 280), module, Strings::VELOCITY_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(112.5, 280), module, Strings::DECAY_INPUT));
+
+    addOutput(createOutput<PJ301MPort>(Vec(45, 320), module, Strings::OUT_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(80, 320), module, Strings::MIX_OUTPUT));
+}
+
+Model *modelStrings = createModel<Strings, StringsWidget>("Strings");
@@ -1,5 +1,8 @@
 #include <iostream>
 #include "RJModules.hpp"
+#include "UI.hpp"
+
+using simd::float_4;
 
 struct LowFrequencyOscillator {
     float phase = 0.0;
@@ -44,6 +47,51 @@ struct LowFrequencyOscillator {
     }
 };
 
+// Supersaw mode: up to 16 detuned, band-limited saws per poly channel, four voices per float_4
+static const int SUPERSAW_MAX_VOICES = 16;
+static const int SUPERSAW_GROUPS = SUPERSAW_MAX_VOICES / 4;
+
+// PolyBLEP residual for a rising saw, phase p and phase increment dt in [0, 0.5]
+static inline float_4 supersawBlep(float_4 p, float_4 dt) {
+    float_4 x = p / dt;
+    float_4 start = 2.f * x - x * x - 1.f;
+    float_4 y = (p - 1.f) / dt;
+    float_4 end = y * y + 2.f * y + 1.f;
+    float_4 out = simd::ifelse(p < dt, start, 0.f);
+    return simd::ifelse(p > 1.f - dt, end, out);
+}
+
+struct SupersawVoices {
+    float_4 phase[SUPERSAW_GROUPS];
+
+    void randomize() {
+        for (int g = 0; g < SUPERSAW_GROUPS; g++) {
+            phase[g] = float_4(random::uniform(), random::uniform(), random::uniform(), random::uniform());
+        }
+    }
+
+    // Advance every voice and write the weighted mono, left and right sums
+    void process(float freq, float sampleTime, int groups, const float_4 *ratio, const float_4 *gain, const float_4 *panLeft, const float_4 *panRight, float *mono, float *left, float *right) {
+        float_4 sumMono = 0.f;
+        float_4 sumLeft = 0.f;
+        float_4 sumRight = 0.f;
+        for (int g = 0; g < groups; g++) {
+            float_4 dt = simd::fmin(freq * sampleTime * ratio[g], 0.5f);
+            float_4 p = phase[g] + dt;
+            p -= simd::floor(p);
+            phase[g] = p;
+
+            float_4 saw = (2.f * p - 1.f - supersawBlep(p, dt)) * gain[g];
+            sumMono += saw;
+            sumLeft += saw * panLeft[g];
+            sumRight += saw * panRight[g];
+        }
+        *mono = sumMono[0] + sumMono[1] + sumMono[2] + sumMono[3];
+        *left = sumLeft[0] + sumLeft[1] + sumLeft[2] + sumLeft[3];
+        *right = sumRight[0] + sumRight[1] + sumRight[2] + sumRight[3];
+    }
+};
+
 struct Supersaw : Module {
     enum ParamIds {
         OFFSET_PARAM,
@@ -61,10 +109,13 @@ struct Supersaw : Module {
         MIX_CV_INPUT,
         RESET_INPUT,
         PW_INPUT,
+        VOCT_INPUT,
         NUM_INPUTS
     };
     enum OutputIds {
         SAW_OUTPUT,
+        LEFT_OUTPUT,
+        RIGHT_OUTPUT,
         NUM_OUTPUTS
     };
     enum LightIds {
@@ -79,6 +130,39 @@ struct Supersaw : Module {
 
     float DETUNE_STEP = .075;
 
+    // Supersaw mode
+    int supersaw_mode_index = 0;
+    int voices_index = 6;
+    int spread_index = 2;
+    int last_voices = -1;
+    SupersawVoices voices[16];
+    float_4 ratio[SUPERSAW_GROUPS];
+    float_4 gain[SUPERSAW_GROUPS];
+    float_4 panLeft[SUPERSAW_GROUPS];
+    float_4 panRight[SUPERSAW_GROUPS];
+    dsp::ClockDivider paramDivider;
+    dsp::SchmittTrigger supersawReset;
+
+    json_t *dataToJson() override {
+        json_t *rootJ = json_object();
+        json_object_set_new(rootJ, "supersaw", json_integer(supersaw_mode_index));
+        json_object_set_new(rootJ, "voices", json_integer(voices_index));
+        json_object_set_new(rootJ, "spread", json_integer(spread_index));
+        return rootJ;
+    }
+
+    void dataFromJson(json_t *rootJ) override {
+        json_t *supersawJ = json_object_get(rootJ, "supersaw");
+        if (supersawJ)
+            supersaw_mode_index = clamp((int) json_integer_value(supersawJ), 0, 1);
+        json_t *voicesJ = json_object_get(rootJ, "voices");
+        if (voicesJ)
+            voices_index = clamp((int) json_integer_value(voicesJ), 0, SUPERSAW_MAX_VOICES - 1);
+        json_t *spreadJ = json_object_get(rootJ, "spread");
+        if (spreadJ)
+            spread_index = clamp((int) json_integer_value(spreadJ), 0, 2);
+    }
+
     Supersaw() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
         configParam(Supersaw::OFFSET_PARAM, 0.0, 1.0, 1.0, "");
@@ -87,29 +171,111 @@ struct Supersaw : Module {
         configParam(Supersaw::FREQ_PARAM, 0.0, 8.0, 5.0, "");
         configParam(Supersaw::DETUNE_PARAM, 0.0, 1.0, 0.1, "");
         configParam(Supersaw::MIX_PARAM, 0.0, 1.0, 1.0, "");
+        paramDivider.setDivision(16);
+        for (int c = 0; c < 16; c++) {
+            voices[c].randomize();
+        }
     }
-    void step() override;
+
+    // Per-voice detune ratios, levels and pans only change with the knobs,
+    // so they are refreshed at control rate rather than every sample.
+    void updateVoices(int count) {
+        float detune = params[DETUNE_PARAM].value * clamp(inputs[DETUNE_CV_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
+        float mix = params[MIX_PARAM].value * clamp(inputs[MIX_CV_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
+        float spread = spread_index * 0.5f;
+
+        float power = 0.f;
+        float g[SUPERSAW_MAX_VOICES];
+        for (int i = 0; i < SUPERSAW_MAX_VOICES; i++) {
+            // Voices spaced evenly across +/- one semitone at full detune
+            float offset = (count > 1) ? (2.f * i / (count - 1) - 1.f) : 0.f;
+            bool center = (count % 2 == 1) && (i == count / 2);
+            g[i] = (i >= count) ? 0.f : (center || count == 1) ? 1.f : mix;
+            power += g[i] * g[i];
+
+            ratio[i / 4][i % 4] = powf(2.f, offset * detune / 12.f);
+            panLeft[i / 4][i % 4] = 0.5f * (1.f - offset * spread);
+            panRight[i / 4][i % 4] = 0.5f * (1.f + offset * spread);
+        }
+
+        // Random phases add in power, so scale by the RMS of the voice levels
+        float norm = 5.f / sqrtf(fmaxf(power, 1.f));
+        for (int i = 0; i < SUPERSAW_MAX_VOICES; i++) {
+            gain[i / 4][i % 4] = g[i] * norm;
+        }
+    }
+
+    void processSupersaw(const ProcessArgs &args) {
+        int count = voices_index + 1;
+        if (count != last_voices) {
+            last_voices = count;
+            updateVoices(count);
+        }
+        else if (paramDivider.process()) {
+            updateVoices(count);
+        }
+
+        if (supersawReset.process(inputs[RESET_INPUT].value)) {
+            for (int c = 0; c < 16; c++) {
+                voices[c].randomize();
+            }
+        }
+
+        int channels = std::max(1, inputs[VOCT_INPUT].getChannels());
+        int groups = (count + 3) / 4;
+
+        // FREQ is an octave offset around C4 in this mode, FREQ CV scales it as in Classic
+        float octave = params[FREQ_PARAM].value * clamp(inputs[FREQ_CV_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f) - 5.0f;
+        for (int c = 0; c < channels; c += 4) {
+            float_4 pitch = octave + inputs[VOCT_INPUT].getPolyVoltageSimd<float_4>(c);
+            float_4 freq = dsp::FREQ_C4 * dsp::approxExp2_taylor5(simd::clamp(pitch, -6.f, 6.f));
+
+            for (int i = 0; i < 4 && c + i < channels; i++) {
+                float mono, left, right;
+                voices[c + i].process(freq[i], args.sampleTime, groups, ratio, gain, panLeft, panRight, &mono, &left, &right);
+                outputs[SAW_OUTPUT].setVoltage(mono, c + i);
+                outputs[LEFT_OUTPUT].setVoltage(left * 2.f, c + i);
+                outputs[RIGHT_OUTPUT].setVoltage(right * 2.f, c + i);
+            }
+        }
+
+        outputs[SAW_OUTPUT].setChannels(channels);
+        outputs[LEFT_OUTPUT].setChannels(channels);
+        outputs[RIGHT_OUTPUT].setChannels(channels);
+    }
+
+    void process(const ProcessArgs &args) override;
 };
 
-void Supersaw::step() {
+void Supersaw::process(const ProcessArgs &args) {
+
+    if (supersaw_mode_index != 0) {
+        processSupersaw(args);
+        return;
+    }
+    // The stereo pair is Supersaw mode only, so it doesn't hold its last
+    // voltages after switching back
+    outputs[SAW_OUTPUT].setChannels(1);
+    outputs[LEFT_OUTPUT].setChannels(0);
+    outputs[RIGHT_OUTPUT].setChannels(0);
 
     float root_pitch = params[FREQ_PARAM].value * clamp(inputs[FREQ_CV_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f);
     oscillator.setPitch(root_pitch);
     oscillator.offset = (params[OFFSET_PARAM].value > 0.0);
     oscillator.invert = (params[INVERT_PARAM].value <= 0.0);
-    oscillator.step(1.0 / APP->engine->getSampleRate());
+    oscillator.step(args.sampleTime);
     oscillator.setReset(inputs[RESET_INPUT].value);
 
     oscillator2.setPitch(root_pitch + (params[DETUNE_PARAM].value * DETUNE_STEP * clamp(inputs[DETUNE_CV_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f)));
     oscillator2.offset = (params[OFFSET_PARAM].value > 0.0);
     oscillator2.invert = (params[INVERT_PARAM].value <= 0.0);
-    oscillator2.step(1.0 / APP->engine->getSampleRate());
+    oscillator2.step(args.sampleTime);
     oscillator2.setReset(inputs[RESET_INPUT].value);
 
     oscillator3.setPitch(root_pitch - (params[DETUNE_PARAM].value * DETUNE_STEP * clamp(inputs[DETUNE_CV_INPUT].normalize(10.0f) / 10.0f, 0.0f, 1.0f)));
     oscillator3.offset = (params[OFFSET_PARAM].value > 0.0);
     oscillator3.invert = (params[INVERT_PARAM].value <= 0.0);
-    oscillator3.step(1.0 / APP->engine->getSampleRate());
+    oscillator3.step(args.sampleTime);
     oscillator3.setReset(inputs[RESET_INPUT].value);
 
     float osc3_saw = oscillator3.saw();
@@ -128,6 +294,29 @@ void Supersaw::step() {
 
 struct SupersawWidget: ModuleWidget {
     SupersawWidget(Supersaw *module);
+
+    void appendContextMenu(Menu *menu) override
+    {
+        Supersaw *module = dynamic_cast<Supersaw *>(this->module);
+
+        menu->addChild(new MenuEntry);
+
+        RJChoiceItem *modeItem = createMenuItem<RJChoiceItem>("Mode", ">");
+        modeItem->target = &module->supersaw_mode_index;
+        modeItem->labels = {"Classic", "Supersaw"};
+        menu->addChild(modeItem);
+
+        RJChoiceItem *voicesItem = createMenuItem<RJChoiceItem>("Supersaw Voices", ">");
+        voicesItem->target = &module->voices_index;
+        for (int i = 1; i <= SUPERSAW_MAX_VOICES; i++)
+            voicesItem->labels.push_back(std::to_string(i));
+        menu->addChild(voicesItem);
+
+        RJChoiceItem *spreadItem = createMenuItem<RJChoiceItem>("Stereo Spread", ">");
+        spreadItem->target = &module->spread_index;
+        spreadItem->labels = {"0%", "50%", "100%"};
+        menu->addChild(spreadItem);
+    }
 };
 
 SupersawWidget::SupersawWidget(Supersaw *module) {
@@ -157,9 +346,12 @@ SupersawWidget::SupersawWidget(Supersaw *module) {
     addInput(createInput<PJ301MPort>(Vec(22, 100), module, Supersaw::FREQ_CV_INPUT));
     addInput(createInput<PJ301MPort>(Vec(22, 190), module, Supersaw::DETUNE_CV_INPUT));
     addInput(createInput<PJ301MPort>(Vec(22, 270), module, Supersaw::MIX_CV_INPUT));
-    addInput(createInput<PJ301MPort>(Vec(38, 310), module, Supersaw::RESET_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(4.5, 320), module, Supersaw::VOCT_INPUT));
+    addInput(createInput<PJ301MPort>(Vec(33.5, 320), module, Supersaw::RESET_INPUT));
 
-    addOutput(createOutput<PJ301MPort>(Vec(100, 310), module, Supersaw::SAW_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(62.5, 320), module, Supersaw::SAW_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(91.5, 320), module, Supersaw::LEFT_OUTPUT));
+    addOutput(createOutput<PJ301MPort>(Vec(120.5, 320), module, Supersaw::RIGHT_OUTPUT));
 
     addChild(createLight<SmallLight<GreenRedLight>>(Vec(99, 60), module, Supersaw::PHASE_POS_LIGHT));
 }
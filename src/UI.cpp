@@ -74,3 +74,55 @@ Vec UI::getPosition(int type, int xSlot, int ySlot, bool xDense, bool yDense) {
 	return Vec(xArray[0] + xArray[1] * xSlot, yArray[0] + yArray[1] * ySlot);
 
 }
+
+struct RJTextDisplay::Face : TransparentWidget {
+	RJTextDisplay *display;
+
+	void draw(const DrawArgs &args) override {
+		display->drawDisplay(args.vg);
+	}
+};
+
+RJTextDisplay::RJTextDisplay() {
+	face = new Face();
+	face->display = this;
+	addChild(face);
+}
+
+void RJTextDisplay::step() {
+	// The face covers the shadow too, so the framebuffer grows with it
+	face->box.size = Vec(box.size.x, box.size.y + (shadow ? 2.0 : 0.0));
+	if (update())
+		setDirty();
+	FramebufferWidget::step();
+}
+
+void RJTextDisplay::drawText(NVGcontext *vg) {
+	nvgText(vg, textPos.x, textPos.y, text.c_str(), NULL);
+}
+
+void RJTextDisplay::drawDisplay(NVGcontext *vg) {
+	if (shadow) {
+		nvgBeginPath(vg);
+		nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y + 2.0, 4.0);
+		nvgFillColor(vg, nvgRGB(0xA0, 0xA0, 0xA0));
+		nvgFill(vg);
+	}
+
+	// Background
+	nvgBeginPath(vg);
+	nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
+	nvgFillColor(vg, nvgRGB(0xC0, 0xC0, 0xC0));
+	nvgFill(vg);
+
+	// Fonts aren't held across frames in v2, loadFont() keeps its own cache
+	std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, fontPath));
+	if (!font || text.empty())
+		return;
+
+	nvgFontSize(vg, fontSize);
+	nvgFontFaceId(vg, font->handle);
+	nvgTextLetterSpacing(vg, letterSpacing);
+	nvgFillColor(vg, nvgRGB(0x00, 0x00, 0x00));
+	drawText(vg);
+}
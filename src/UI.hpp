@@ -1,8 +1,12 @@
 #pragma once
 
 #include <iostream>
+#include <atomic>
+#include <sstream>
+#include <iomanip>
 
 #include "AH.hpp"
+#include "common.hpp"
 #include "componentlibrary.hpp"
 
 struct ParamEvent {
@@ -358,6 +362,8 @@ struct RJ_PadSvgSwitch : SvgSwitch {
 	int btnId = -1;
 	// Group id (to match guys that should respond to mouse down drag).
 	int groupId = -1;
+	// Bumped whenever the pad sets its value, so the module can skip scanning its pads until something changed
+	std::atomic<uint32_t> *changes = NULL;
 	RJ_PadSvgSwitch() : SvgSwitch() {
 		momentary = false;
 
@@ -369,10 +375,15 @@ struct RJ_PadSvgSwitch : SvgSwitch {
 		box.size = size;
 		return;
 	}
+	void padChanged() {
+		if (changes)
+			(*changes)++;
+	}
 	void setValue(float val) {
 		if (getParamQuantity())
 		{
 			getParamQuantity()->setValue(val);
+			padChanged();
 		}
 		return;
 	}
@@ -383,6 +394,7 @@ struct RJ_PadSvgSwitch : SvgSwitch {
 		{
 			float newVal = (getParamQuantity()->getValue() < getParamQuantity()->maxValue) ? getParamQuantity()->maxValue : getParamQuantity()->minValue;
 			getParamQuantity()->setValue(newVal); // Toggle Value
+			padChanged();
 		}
 		return;
 	}
@@ -413,6 +425,7 @@ struct RJ_PadSvgSwitch : SvgSwitch {
 			float newVal = (getParamQuantity()->getValue() < getParamQuantity()->maxValue) ? getParamQuantity()->maxValue : getParamQuantity()->minValue;
 			DEBUG("RJ_PadSvgSwitch onDragStart(%d) - Set Value to %3.1f.", btnId, newVal);
 			getParamQuantity()->setValue(1.0); // Toggle Value
+			padChanged();
 
 		}
 		return;
@@ -440,6 +453,7 @@ struct RJ_PadSvgSwitch : SvgSwitch {
 			float newVal = (getParamQuantity()->getValue() < getParamQuantity()->maxValue) ? getParamQuantity()->maxValue : getParamQuantity()->minValue;
 			DEBUG("RJ_PadSvgSwitch onDragEnter(%d) - Set Value to %3.1f.", btnId, newVal);
 			getParamQuantity()->setValue(1.0); // Toggle Value
+			padChanged();
 		}
 		return;
 	}
@@ -448,8 +462,14 @@ struct RJ_PadSvgSwitch : SvgSwitch {
 			return;
 		SvgSwitch::onDragLeave(e);
 		getParamQuantity()->setValue(0);
+		padChanged();
 		return;
 	}
+	void onDragEnd(const event::DragEnd &e) override {
+		// Momentary pads are released by Switch
+		SvgSwitch::onDragEnd(e);
+		padChanged();
+	}
 	void onButton(const event::Button &e) override
 	{
 		this->ParamWidget::onButton(e); // Need to call this base method to be set as the touchedParam for MIDI mapping to work.
@@ -551,3 +571,109 @@ ColorValueLight * RJ_createColorValueLight(Vec pos, Module *module, int lightId,
 	light->bgColor = backColor;
 	return light;
 }
+
+//--------------------------------------------------------------
+// RJTextDisplay
+// The grey text displays used across the plugin. The text is only
+// formatted again when the bound value changes, and the drawing is
+// kept in a framebuffer that is only re-rendered then.
+//--------------------------------------------------------------
+struct RJTextDisplay : FramebufferWidget {
+	std::string fontPath = "res/Pokemon.ttf";
+	float fontSize = 20.0;
+	float letterSpacing = 0.4;
+	Vec textPos = Vec(12.0, 28.0);
+	// Darker strip under the bottom edge
+	bool shadow = false;
+
+	std::string text;
+
+	RJTextDisplay();
+	void step() override;
+	// Refreshes `text` from the bound value, returns true if it changed
+	virtual bool update() { return false; }
+	virtual void drawText(NVGcontext *vg);
+	void drawDisplay(NVGcontext *vg);
+
+private:
+	struct Face;
+	Face *face;
+};
+
+// Shows `*value` padded to `width` characters, like the old stringstream displays
+template <typename T>
+struct RJValueDisplay : RJTextDisplay {
+	T *value = NULL;
+	int width = 3;
+	T shown = T();
+	bool formatted = false;
+
+	bool update() override {
+		if (!value || (formatted && *value == shown))
+			return false;
+		shown = *value;
+		formatted = true;
+		text = format(shown);
+		return true;
+	}
+
+	virtual std::string format(const T &v) {
+		std::ostringstream to_display;
+		to_display << std::setw(width) << v;
+		return to_display.str();
+	}
+};
+
+typedef RJValueDisplay<std::string> RJStringDisplay;
+typedef RJValueDisplay<int> RJIntegerDisplay;
+
+// A float through format4display, with a smaller +/- drawn in front
+struct RJNumberDisplay : RJValueDisplay<float> {
+	float signSize = 16.0;
+	// Where the sign goes for negative and for positive values
+	Vec signPos[2] = {Vec(1.0, 20.0), Vec(1.0, 30.0)};
+
+	RJNumberDisplay() {
+		fontPath = "res/Segment7Standard.ttf";
+	}
+
+	std::string format(const float &v) override {
+		return format4display(v).str();
+	}
+
+	void drawText(NVGcontext *vg) override {
+		RJTextDisplay::drawText(vg);
+		bool negative = shown < 0;
+		nvgFontSize(vg, signSize);
+		Vec pos = signPos[negative ? 0 : 1];
+		nvgText(vg, pos.x, pos.y, negative ? "-" : "+", NULL);
+	}
+};
+
+//--------------------------------------------------------------
+// RJChoiceItem
+// A context menu entry whose submenu picks one of `labels` and
+// stores its index in `*target`, with the current one checked.
+//--------------------------------------------------------------
+struct RJIndexItem : MenuItem {
+	int *target;
+	int index;
+	void onAction(const event::Action &e) override {
+		*target = index;
+	}
+};
+
+struct RJChoiceItem : MenuItem {
+	int *target;
+	std::vector<std::string> labels;
+	Menu *createChildMenu() override {
+		Menu *menu = new Menu();
+		for (int i = 0; i < (int)labels.size(); i++) {
+			RJIndexItem *item = createMenuItem<RJIndexItem>(labels[i], CHECKMARK(*target == i));
+			item->target = target;
+			item->index = i;
+			menu->addChild(item);
+		}
+		return menu;
+	}
+};
@@ -1,17 +0,0 @@
-/* libfft.h - include file for fast Fourier transform library
-**
-** Copyright (C) 1989 by Jef Poskanzer.
-**
-** Permission to use, copy, modify, and distribute this software and its
-** documentation for any purpose and without fee is hereby granted, provided
-** that the above copyright notice appear in all copies and that both that
-** copyright notice and this permission notice appear in supporting
-** documentation.  This software is provided "as is" without express or
-** implied warranty.
-*/
-
-#include <stdbool.h>
-
-void *initfft(int bits);
-void destroyfft( void *fft );
-void applyfft( void * fft, float *xr, float *xi, bool inv );
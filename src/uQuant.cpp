@@ -15,34 +15,11 @@ https://github.com/jhoar/AmalgamatedHarmonics
 #include <iomanip>
 
 // Displays
-struct TinyStringDisplayWidget : TransparentWidget {
-
-  std::string *value;
-
-  void draw(NVGcontext *vg) override
-  {
-    // Background
-    NVGcolor backgroundColor = nvgRGB(0xC0, 0xC0, 0xC0);
-    nvgBeginPath(vg);
-    nvgRoundedRect(vg, 0.0, 0.0, box.size.x, box.size.y, 4.0);
-    nvgFillColor(vg, backgroundColor);
-    nvgFill(vg);
-
-    // text
-    std::shared_ptr<Font> font = APP->window->loadFont(asset::plugin(pluginInstance, "res/Pokemon.ttf"));
-    if (font) {
-    nvgFontSize(vg, 15);
-    nvgFontFaceId(vg, font->handle);
-    nvgTextLetterSpacing(vg, 2);
-    }
-
-    std::stringstream to_display;
-    to_display << std::setw(3) << *value;
-
-    Vec textPos = Vec(2.0f, 17.0f);
-    NVGcolor textColor = nvgRGB(0x00, 0x00, 0x00);
-    nvgFillColor(vg, textColor);
-    nvgText(vg, textPos.x, textPos.y, to_display.str().c_str(), NULL);
+struct TinyStringDisplayWidget : RJStringDisplay {
+  TinyStringDisplayWidget() {
+    fontSize = 15;
+    letterSpacing = 2;
+    textPos = Vec(2.0f, 17.0f);
   }
 };
 